@@ -0,0 +1,164 @@
+/******************************************************************************\
+*                                                                              *
+*    Mewa. Math EWAluator.                                                     *
+*    Copyright (C) 2024 Mark Mandriota                                         *
+*                                                                              *
+*    This program is free software: you can redistribute it and/or modify      *
+*    it under the terms of the GNU General Public License as published by      *
+*    the Free Software Foundation, either version 3 of the License, or         *
+*    (at your option) any later version.                                       *
+*                                                                              *
+*    This program is distributed in the hope that it will be useful,           *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*    GNU General Public License for more details.                              *
+*                                                                              *
+*    You should have received a copy of the GNU General Public License         *
+*    along with this program.  If not, see <https://www.gnu.org/licenses/>.    *
+*                                                                              *
+\******************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <sys/mman.h>
+#include <unistd.h>
+#define ARENA_MMAP
+#endif
+
+// Arena - contiguous memory which never moves. Address space is reserved once
+// and pages are committed on demand, so pointers into arena stay valid while
+// it grows.
+typedef struct {
+  char *base;
+  size_t reserved;  // bytes of reserved address space
+  size_t committed; // bytes accessible from base
+  bool huge;        // whether to advise transparent hugepages
+} Arena;
+
+#define ARENA_PAGE_SIZE ((size_t)1 << 12)
+#define ARENA_HUGEPAGE_SIZE ((size_t)1 << 21)
+
+//=:arena:reserve
+
+// arena_init - reserves up to reserve bytes of address space. Halves
+// reservation while system refuses it. Returns false if nothing reserved.
+static inline bool arena_init(Arena *a, size_t reserve, bool huge) {
+  *a = (Arena){.huge = huge};
+
+#ifdef ARENA_MMAP
+  for (; reserve >= ARENA_HUGEPAGE_SIZE; reserve /= 2) {
+    // one extra hugepage to align base for transparent hugepages
+    size_t len = reserve + ARENA_HUGEPAGE_SIZE;
+    char *p = mmap(NULL, len, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      continue;
+
+    size_t off = -(uintptr_t)p & (ARENA_HUGEPAGE_SIZE - 1);
+    if (off != 0)
+      munmap(p, off);
+    munmap(p + off + reserve, ARENA_HUGEPAGE_SIZE - off);
+
+    a->base = p + off;
+    a->reserved = reserve;
+    return true;
+  }
+
+  return false;
+#else
+  for (; reserve >= ARENA_HUGEPAGE_SIZE; reserve /= 2) {
+    a->base = malloc(reserve);
+    if (a->base == NULL)
+      continue;
+
+    a->reserved = reserve;
+    a->committed = reserve;
+    return true;
+  }
+
+  return false;
+#endif
+}
+
+//=:arena:commit
+
+// arena_commit - makes at least len first bytes of arena accessible. Commits
+// geometrically to keep number of system calls logarithmic.
+static inline bool arena_commit(Arena *a, size_t len) {
+  if (len <= a->committed)
+    return true;
+  if (len > a->reserved)
+    return false;
+
+#ifdef ARENA_MMAP
+  size_t step = a->huge && len > ARENA_HUGEPAGE_SIZE ? ARENA_HUGEPAGE_SIZE
+                                                     : ARENA_PAGE_SIZE;
+  size_t want = len > a->committed * 2 ? len : a->committed * 2;
+  want = (want + step - 1) & ~(step - 1);
+  if (want > a->reserved)
+    want = a->reserved;
+
+  char *p = a->base + a->committed;
+  if (mprotect(p, want - a->committed, PROT_READ | PROT_WRITE) != 0)
+    return false;
+
+#ifdef MADV_HUGEPAGE
+  if (step == ARENA_HUGEPAGE_SIZE)
+    madvise(p, want - a->committed, MADV_HUGEPAGE);
+#endif
+
+  a->committed = want;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// arena_grow - commits room for at least len items of item_sz bytes. Returns
+// new capacity in items, or 0 if arena is exhausted.
+static inline size_t arena_grow(Arena *a, size_t len, size_t item_sz) {
+  if (!arena_commit(a, len * item_sz))
+    return 0;
+
+  return a->committed / item_sz;
+}
+
+//=:arena:reset
+
+// arena_reset - releases committed memory above keep bytes back to system.
+// Kept pages retain their contents.
+static inline void arena_reset(Arena *a, size_t keep) {
+#ifdef ARENA_MMAP
+  keep = (keep + ARENA_PAGE_SIZE - 1) & ~(ARENA_PAGE_SIZE - 1);
+  if (keep >= a->committed)
+    return;
+
+  char *p = a->base + keep;
+  size_t len = a->committed - keep;
+  madvise(p, len, MADV_DONTNEED);
+  mprotect(p, len, PROT_NONE);
+  a->committed = keep;
+#else
+  (void)a;
+  (void)keep;
+#endif
+}
+
+static inline void arena_free(Arena *a) {
+#ifdef ARENA_MMAP
+  if (a->base != NULL)
+    munmap(a->base, a->reserved);
+#else
+  free(a->base);
+#endif
+  *a = (Arena){0};
+}
+
+#endif
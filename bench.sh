@@ -0,0 +1,652 @@
+#!/bin/sh
+#
+# bench.sh - throughput benchmarks for Mewa.
+#
+# usage: ./bench.sh [case...]
+#
+# Each case generates its workload into $BENCH_DIR, runs $MEWA on it
+# $BENCH_RUNS times and reports the best wall time. Set MEWA to compare
+# against another build, e.g. MEWA=/tmp/old/bin/mewa ./bench.sh reader.
+# The dispatch case also runs MEWA_SWITCH, built by make build-switch, and
+# reads hardware counters with perf(1) when it is available. The jit case
+# compares interpreter with machine code of --jit on formulas run many times.
+# The columns case compares --columns on rows of bindings with batch mode on
+# same formula written out for every row. The errors case compares modes of
+# --errors on formulas run many times and on columns. The batch case compares
+# batch mode on one thread with -j on BATCH_THREADS, all CPUs by default, and
+# with -j 8 where assignments to many globals start new rounds.
+# The operators case times every operator on its own, summing its results.
+# The calls case times builtins, folded for constants and called in lanes.
+# The functions case times calls of user functions in batch mode, recursive
+# and dispatched among many ranged clauses. The scope case times assignment
+# and lookup of many symbols in global scope, lookups in formulas run many
+# times, and intermediate results kept in globals or in locals of sequences.
+# The compiled case compares scripts run from text with them compiled by
+# --compile and cached in MEWA_CACHE. The session case compares restoring
+# many globals by replaying their assignments with loading them by --session.
+# The output case counts results formatted per second, of numbers of every
+# magnitude and with their errors, in batch and columns modes.
+
+MEWA=${MEWA:-./bin/mewa}
+MEWA_SWITCH=${MEWA_SWITCH:-./bin/mewa-switch}
+BENCH_DIR=${BENCH_DIR:-/tmp/mewa-bench}
+BENCH_RUNS=${BENCH_RUNS:-5}
+
+mkdir -p "$BENCH_DIR"
+
+now() { date +%s%N; }
+
+# best_of cmd... - prints the best wall time of cmd in nanoseconds
+best_of() {
+  best=
+  i=0
+  while [ $i -lt "$BENCH_RUNS" ]; do
+    t0=$(now)
+    "$@" >/dev/null 2>&1
+    t1=$(now)
+    t=$((t1 - t0))
+    if [ -z "$best" ] || [ $t -lt "$best" ]; then best=$t; fi
+    i=$((i + 1))
+  done
+  echo "$best"
+}
+
+# report name bytes ns
+report() {
+  awk -v n="$1" -v b="$2" -v t="$3" 'BEGIN {
+    printf "%-28s %10.3f ms %10.2f MB/s\n", n, t / 1e6, b / (t / 1e9) / 1e6
+  }'
+}
+
+# report_ops name ops ns
+report_ops() {
+  awk -v n="$1" -v o="$2" -v t="$3" 'BEGIN {
+    printf "%-28s %10.3f ms %10.2f Mops/s\n", n, t / 1e6, o / (t / 1e9) / 1e6
+  }'
+}
+
+gen_sum() {
+  [ -f "$BENCH_DIR/sum.mw" ] && return
+  awk 'BEGIN { printf "1"; for (i = 0; i < 400000; ++i) printf " + %d", i % 1000; print "" }' \
+    >"$BENCH_DIR/sum.mw"
+}
+
+gen_indented() {
+  [ -f "$BENCH_DIR/indented.mw" ] && return
+  awk 'BEGIN {
+    for (i = 0; i < 200000; ++i)
+      printf "                %d%09d +\n", 100000 + i % 900000, i
+    print "                pi"
+  }' >"$BENCH_DIR/indented.mw"
+}
+
+gen_decimals() {
+  [ -f "$BENCH_DIR/decimals.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 300000; ++i)
+      printf " + %.12f", rand() * 1000
+    print ""
+  }' >"$BENCH_DIR/decimals.mw"
+}
+
+gen_scientific() {
+  [ -f "$BENCH_DIR/scientific.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 300000; ++i)
+      printf " + %.15e", rand() * 10 ^ int(rand() * 40 - 20)
+    print ""
+  }' >"$BENCH_DIR/scientific.mw"
+}
+
+gen_nested() {
+  [ -f "$BENCH_DIR/nested.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 80000; ++i)
+      printf " + (%d * -(pi %% %d) ^ 2)", int(rand() * 1000), int(rand() * 1000) + 1
+    print ""
+  }' >"$BENCH_DIR/nested.mw"
+}
+
+gen_deep() {
+  [ -f "$BENCH_DIR/deep.mw" ] && return
+  awk 'BEGIN {
+    for (i = 0; i < 1000000; ++i) printf "("
+    printf "1"
+    for (i = 0; i < 1000000; ++i) printf ")"
+    print ""
+  }' >"$BENCH_DIR/deep.mw"
+}
+
+gen_mixed() {
+  [ -f "$BENCH_DIR/mixed.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "1"
+    for (i = 0; i < 1000000; ++i)
+      printf " %s %d", substr("+-*", int(rand() * 3) + 1, 1), int(rand() * 100) + 1
+    print ""
+  }' >"$BENCH_DIR/mixed.mw"
+}
+
+bench_reader() {
+  gen_sum
+  f="$BENCH_DIR/sum.mw"
+  sz=$(wc -c <"$f")
+
+  report "reader: -f file" "$sz" "$(best_of "$MEWA" -f "$f")"
+  report "reader: stdin pipe" "$sz" "$(best_of sh -c "cat '$f' | '$MEWA'")"
+}
+
+bench_lexer() {
+  gen_indented
+  f="$BENCH_DIR/indented.mw"
+  sz=$(wc -c <"$f")
+
+  report "lexer: indented literals" "$sz" "$(best_of "$MEWA" -f "$f")"
+}
+
+bench_float() {
+  gen_decimals
+  f="$BENCH_DIR/decimals.mw"
+  report "float: decimals" "$(wc -c <"$f")" "$(best_of "$MEWA" -f "$f")"
+
+  gen_scientific
+  f="$BENCH_DIR/scientific.mw"
+  report "float: scientific" "$(wc -c <"$f")" "$(best_of "$MEWA" -f "$f")"
+}
+
+bench_parser() {
+  gen_nested
+  f="$BENCH_DIR/nested.mw"
+  report "parser: nested terms" "$(wc -c <"$f")" "$(best_of "$MEWA" -f "$f")"
+
+  gen_deep
+  f="$BENCH_DIR/deep.mw"
+  report "parser: deep parens" "$(wc -c <"$f")" "$(best_of "$MEWA" -f "$f")"
+}
+
+gen_hot() {
+  [ -f "$BENCH_DIR/hot.mw" ] && return
+  echo "(3 * 4 + 2) * (7 - 1) * -(5 + 6) - 8 * 9 + sqrt(2) * 3" >"$BENCH_DIR/hot.mw"
+}
+
+gen_formula_mixed() {
+  [ -f "$BENCH_DIR/formula-mixed.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "1"
+    for (i = 0; i < 10000; ++i)
+      printf " %s %d", substr("+-*", int(rand() * 3) + 1, 1), int(rand() * 100) + 1
+    print ""
+  }' >"$BENCH_DIR/formula-mixed.mw"
+}
+
+gen_formula_real() {
+  [ -f "$BENCH_DIR/formula-real.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 1000; ++i)
+      printf " + %.3f / %.3f * %.3f - sqrt(%.3f)", rand() * 100, rand() * 100 + 1,
+        rand() * 10, rand() * 100
+    print ""
+  }' >"$BENCH_DIR/formula-real.mw"
+}
+
+gen_formula_nested() {
+  [ -f "$BENCH_DIR/formula-nested.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 1000; ++i)
+      printf " + (%d * -(pi %% %d) ^ 2)", int(rand() * 1000), int(rand() * 1000) + 1
+    print ""
+  }' >"$BENCH_DIR/formula-nested.mw"
+}
+
+# bench_vm_case name file ops [flag...] - times VM_RUNS extra runs of compiled
+# code, so parsing is excluded from reported throughput.
+bench_vm_case() {
+  n=$1 f=$2 o=$3
+  shift 3
+  t1=$(best_of "$MEWA" "$@" -n 1 -f "$f")
+  tn=$(best_of "$MEWA" "$@" -n $((VM_RUNS + 1)) -f "$f")
+  report_ops "$n" "$((o * VM_RUNS))" "$((tn - t1))"
+}
+
+bench_vm() {
+  VM_RUNS=${VM_RUNS:-10}
+
+  gen_mixed
+  bench_vm_case "vm: mixed operators" "$BENCH_DIR/mixed.mw" 1000000
+
+  # 5 operators and one symbol lookup per term
+  gen_nested
+  bench_vm_case "vm: nested terms" "$BENCH_DIR/nested.mw" 480000
+
+  # decimals without imaginary parts, 5 operations per term
+  VM_RUNS=$((VM_RUNS * 100))
+  gen_formula_real
+  bench_vm_case "vm: real terms" "$BENCH_DIR/formula-real.mw" 5000
+  bench_vm_case "vm: real terms, jit" "$BENCH_DIR/formula-real.mw" 5000 --jit
+  VM_RUNS=$((VM_RUNS / 100))
+}
+
+# perf_counts cmd... - prints cycles, branches and branch misses of cmd
+perf_counts() {
+  perf stat -x, -e cycles,branches,branch-misses -o "$BENCH_DIR/perf.csv" \
+    "$@" >/dev/null 2>&1
+  awk -F, '
+    $3 ~ /^cycles/ { c = $1 }
+    $3 ~ /^branches/ { b = $1 }
+    $3 ~ /^branch-misses/ { m = $1 }
+    END { print c + 0, b + 0, m + 0 }' "$BENCH_DIR/perf.csv"
+}
+
+# bench_dispatch_case name mewa file ops
+bench_dispatch_case() {
+  if ! command -v perf >/dev/null 2>&1; then
+    MEWA="$2" bench_vm_case "$1" "$3" "$4"
+    return
+  fi
+
+  set -- "$1" "$4" $(perf_counts "$2" -n 1 -f "$3") \
+    $(perf_counts "$2" -n $((VM_RUNS + 1)) -f "$3")
+  awk -v n="$1" -v o="$(($2 * VM_RUNS))" \
+    -v c="$(($6 - $3))" -v b="$(($7 - $4))" -v m="$(($8 - $5))" 'BEGIN {
+    printf "%-28s %10.2f cycles/op %7.2f%% branch misses\n", n, c / o,
+      (b > 0 ? 100 * m / b : 0)
+  }'
+}
+
+bench_dispatch() {
+  VM_RUNS=${VM_RUNS:-10}
+
+  command -v perf >/dev/null 2>&1 ||
+    echo "perf not found, reporting wall time only" >&2
+
+  gen_mixed
+  f="$BENCH_DIR/mixed.mw"
+  bench_dispatch_case "dispatch: threaded" "$MEWA" "$f" 1000000
+  bench_dispatch_case "dispatch: switch" "$MEWA_SWITCH" "$f" 1000000
+}
+
+bench_jit() {
+  VM_RUNS=${VM_RUNS:-10}
+
+  # short formula evaluated many times, 12 operations per run
+  gen_hot
+  f="$BENCH_DIR/hot.mw"
+  VM_RUNS=$((VM_RUNS * 100000))
+  bench_vm_case "jit: hot, interpreter" "$f" 12
+  bench_vm_case "jit: hot, machine code" "$f" 12 --jit
+  VM_RUNS=$((VM_RUNS / 100000))
+
+  VM_RUNS=$((VM_RUNS * 100))
+  gen_formula_mixed
+  f="$BENCH_DIR/formula-mixed.mw"
+  bench_vm_case "jit: mixed, interpreter" "$f" 10000
+  bench_vm_case "jit: mixed, machine code" "$f" 10000 --jit
+
+  gen_formula_nested
+  f="$BENCH_DIR/formula-nested.mw"
+  bench_vm_case "jit: nested, interpreter" "$f" 6000
+  bench_vm_case "jit: nested, machine code" "$f" 6000 --jit
+  VM_RUNS=$((VM_RUNS / 100))
+}
+
+# gen_columns name format - writes rows of x and y with printf format, and
+# formula of bench_columns with them substituted for batch mode
+gen_columns() {
+  [ -f "$BENCH_DIR/columns-$1.txt" ] && return
+  awk -v fmt="$2" 'BEGIN {
+    srand(1)
+    print "x y"
+    for (i = 0; i < 1000000; ++i)
+      printf fmt " " fmt "\n", rand() * 1000, rand() * 100 - 50
+  }' >"$BENCH_DIR/columns-$1.txt"
+  awk 'NR > 1 { printf "(%s) * (%s) + (%s) - (%s) * 3\n", $1, $2, $1, $2 }' \
+    "$BENCH_DIR/columns-$1.txt" >"$BENCH_DIR/columns-$1.mw"
+}
+
+bench_columns() {
+  # integers are exact and decimals are real, so sums of both stay in lanes
+  for c in integers:%d decimals:%.6f; do
+    gen_columns "${c%%:*}" "${c#*:}"
+    f="$BENCH_DIR/columns-${c%%:*}"
+    report_ops "columns: ${c%%:*}, batch" 1000000 "$(best_of "$MEWA" -b -f "$f.mw")"
+    report_ops "columns: ${c%%:*}, lanes" 1000000 \
+      "$(best_of "$MEWA" --columns "x * y + x - y * 3" -f "$f.txt")"
+  done
+}
+
+bench_errors() {
+  VM_RUNS=${VM_RUNS:-10}
+
+  VM_RUNS=$((VM_RUNS * 100))
+  gen_formula_mixed
+  f="$BENCH_DIR/formula-mixed.mw"
+  for m in off linear interval; do
+    bench_vm_case "errors: mixed, $m" "$f" 10000 --errors=$m
+    bench_vm_case "errors: mixed, $m, jit" "$f" 10000 --errors=$m --jit
+  done
+  VM_RUNS=$((VM_RUNS / 100))
+
+  gen_columns decimals %.6f
+  f="$BENCH_DIR/columns-decimals.txt"
+  for m in off linear interval; do
+    report_ops "errors: columns, $m" 1000000 \
+      "$(best_of "$MEWA" --errors=$m --columns "x * y + x - y * 3" -f "$f")"
+  done
+}
+
+# gen_operator name term - writes sum of 1000 terms printed by awk expression
+# term of random r in [0, 1)
+gen_operator() {
+  [ -f "$BENCH_DIR/operator-$1.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    printf "0"
+    for (i = 0; i < 1000; ++i) {
+      r = rand()
+      printf " + (%s)", '"$2"'
+    }
+    print ""
+  }' >"$BENCH_DIR/operator-$1.mw"
+}
+
+bench_operators() {
+  VM_RUNS=${VM_RUNS:-10}
+  VM_RUNS=$((VM_RUNS * 100))
+
+  while read -r n t; do
+    gen_operator "$n" "$t"
+    bench_vm_case "operators: $n" "$BENCH_DIR/operator-$n.mw" 1000
+  done <<EOF
+add sprintf("%.3f + %.3f", r * 100, rand() * 100)
+sub sprintf("%.3f - %.3f", r * 100, rand() * 100)
+mul sprintf("%.3f * %.3f", r * 100, rand() * 100)
+quo sprintf("%.3f / %.3f", r * 100, rand() * 100 + 1)
+mod sprintf("%d %% %d", r * 1000, rand() * 100 + 1)
+pow sprintf("%.3f ^ %.3f", r * 10, rand() * 4)
+complex-mul sprintf("(%.1f + %.1fi) * %.1fi", r * 10, rand() * 10, rand() * 10)
+abs sprintf("|%.3f - 50|", r * 100)
+factorial sprintf("%d!", r * 20)
+multifactorial sprintf("%d!!!!", r * 40)
+multifactorial-real sprintf("%.1f!!!!", r * 20)
+subfactorial sprintf("!%d", r * 20)
+subfactorial-real sprintf("!%.1f", r * 20)
+EOF
+  VM_RUNS=$((VM_RUNS / 100))
+}
+
+bench_calls() {
+  VM_RUNS=${VM_RUNS:-10}
+
+  # calls of constants are folded, so runs only sum their results
+  VM_RUNS=$((VM_RUNS * 100))
+  gen_operator sin 'sprintf("sin(%.3f)", r * 100)'
+  bench_vm_case "calls: sin of constants" "$BENCH_DIR/operator-sin.mw" 1000
+  VM_RUNS=$((VM_RUNS / 100))
+
+  gen_columns decimals %.6f
+  f="$BENCH_DIR/columns-decimals.txt"
+  for t in "sqrt(x) * y" "sqrt(x * x + y * y)" "hypot(x, y)" "max(x, y)"; do
+    report_ops "calls: $t, lanes" 1000000 \
+      "$(best_of "$MEWA" --columns "$t" -f "$f")"
+  done
+}
+
+# gen_piecewise clauses calls - writes step function of clauses ranged
+# clauses, then calls of it on random arguments, one per line
+gen_piecewise() {
+  [ -f "$BENCH_DIR/piecewise-$1.mw" ] && return
+  awk -v m="$1" -v n="$2" 'BEGIN {
+    srand(1)
+    for (i = 0; i < m; ++i)
+      printf "p(x) -> x >= %d -> x < %d = %d\n", i, i + 1, i
+    for (i = 0; i < n; ++i)
+      printf "p(%.3f)\n", rand() * m
+  }' >"$BENCH_DIR/piecewise-$1.mw"
+}
+
+bench_functions() {
+  f="$BENCH_DIR/fib.mw"
+  printf 'fib(0) = 0\nfib(1) = 1\nfib(n) = fib(n - 1) + fib(n - 2)\nfib(24)\n' >"$f"
+  # 2 fib(25) - 1 calls
+  report_ops "functions: fib(24)" 150049 "$(best_of "$MEWA" -b -f "$f")"
+  report_ops "functions: fib(24), jit" 150049 \
+    "$(best_of "$MEWA" -b --jit -f "$f")"
+
+  for m in 10 1000; do
+    gen_piecewise $m 100000
+    report_ops "functions: $m clauses" 100000 \
+      "$(best_of "$MEWA" -b -f "$BENCH_DIR/piecewise-$m.mw")"
+  done
+}
+
+# gen_scope symbols - writes assignments of symbols, then a line summing 100
+# of them per symbol, half of which are not assigned
+gen_scope() {
+  [ -f "$BENCH_DIR/scope-$1.mw" ] && return
+  awk -v n="$1" 'BEGIN {
+    srand(1)
+    for (i = 0; i < n; ++i)
+      printf "v%d = %d\n", i, i
+    for (i = 0; i < n; ++i) {
+      printf "v%d", int(rand() * n)
+      for (j = 1; j < 100; ++j)
+        printf " + v%d", int(rand() * n)
+      print ""
+      printf "u%d\n", i
+    }
+  }' >"$BENCH_DIR/scope-$1.mw"
+}
+
+# gen_scope_hot - writes assignments of 100 symbols and a formula summing
+# products of 1000 pairs of them
+gen_scope_hot() {
+  [ -f "$BENCH_DIR/scope-hot.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 100; ++i)
+      printf "v%d = %d\n", i, i
+    printf "v0"
+    for (i = 0; i < 1000; ++i)
+      printf " + v%d * v%d", int(rand() * 100), int(rand() * 100)
+    print ""
+  }' >"$BENCH_DIR/scope-hot.mw"
+}
+
+# gen_scope_locals - writes the same steps on values of 100000 symbols with
+# intermediate results assigned to globals on lines of their own, then to
+# locals of sequences
+gen_scope_locals() {
+  [ -f "$BENCH_DIR/scope-globals.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 100000; ++i) {
+      x = rand() * 100
+      printf "a = %.6f * %.6f\nb = a + %.6f\na * b - b\n", x, x, x >"'"$BENCH_DIR/scope-globals.mw"'"
+      printf "(a = %.6f * %.6f; b = a + %.6f; a * b - b)\n", x, x, x >"'"$BENCH_DIR/scope-locals.mw"'"
+    }
+  }'
+}
+
+bench_scope() {
+  for n in 200 20000; do
+    gen_scope $n
+    report_ops "scope: $n symbols" $((n * 101)) \
+      "$(best_of "$MEWA" -b -f "$BENCH_DIR/scope-$n.mw")"
+  done
+
+  # 100000 results per run, without time of parsing
+  VM_RUNS=${VM_RUNS:-10}
+  VM_RUNS=$((VM_RUNS * 10))
+  gen_scope_locals
+  for k in globals locals; do
+    bench_vm_case "scope: $k of steps" "$BENCH_DIR/scope-$k.mw" 100000 -b
+  done
+
+  # 100 assignments, 2001 lookups and 2000 operators per run
+  VM_RUNS=$((VM_RUNS * 10))
+  gen_scope_hot
+  f="$BENCH_DIR/scope-hot.mw"
+  bench_vm_case "scope: lookups, interpreter" "$f" 4101 -b
+  bench_vm_case "scope: lookups, machine code" "$f" 4101 -b --jit
+  VM_RUNS=$((VM_RUNS / 100))
+}
+
+# gen_batch_scope - writes assignments of 200000 symbols, then 200 of them
+# again, each followed by 1000 formulas reading them
+gen_batch_scope() {
+  [ -f "$BENCH_DIR/batch-scope.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 200000; ++i)
+      printf "v%d = %d\n", i, i
+    for (i = 0; i < 200; ++i) {
+      printf "v%d = %d\n", int(rand() * 200000), i
+      for (j = 0; j < 1000; ++j)
+        printf "v%d * v%d + v%d\n", int(rand() * 200000), int(rand() * 200000),
+          int(rand() * 200000)
+    }
+  }' >"$BENCH_DIR/batch-scope.mw"
+}
+
+bench_batch() {
+  BATCH_THREADS=${BATCH_THREADS:-0}
+
+  # a million short formulas, one per line
+  gen_columns decimals %.6f
+  f="$BENCH_DIR/columns-decimals.mw"
+  report_ops "batch: formulas, 1 thread" 1000000 \
+    "$(best_of "$MEWA" -b -f "$f")"
+  report_ops "batch: formulas, -j $BATCH_THREADS" 1000000 \
+    "$(best_of "$MEWA" -b -j "$BATCH_THREADS" -f "$f")"
+  report_ops "batch: formulas, -j $BATCH_THREADS, pipe" 1000000 \
+    "$(best_of sh -c "\"\$0\" -b -j $BATCH_THREADS <\"\$1\"" "$MEWA" "$f")"
+
+  # every assignment starts round, in which workers see new globals
+  gen_batch_scope
+  f="$BENCH_DIR/batch-scope.mw"
+  report_ops "batch: globals, 1 thread" 400200 "$(best_of "$MEWA" -b -f "$f")"
+  report_ops "batch: globals, -j 8" 400200 "$(best_of "$MEWA" -b -j 8 -f "$f")"
+}
+
+# gen_script - writes script of 100000 lines of formulas
+gen_script() {
+  [ -f "$BENCH_DIR/script.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 100000; ++i)
+      printf "%.3f / %.3f * %.3f - sqrt(%.3f) + (%d * -(pi %% %d) ^ 2)\n",
+        rand() * 100, rand() * 100 + 1, rand() * 10, rand() * 100,
+        int(rand() * 1000), int(rand() * 1000) + 1
+  }' >"$BENCH_DIR/script.mw"
+}
+
+bench_compiled() {
+  cache="$BENCH_DIR/cache"
+  rm -rf "$cache"
+
+  # first cached run compiles script, the best one is run from cache
+  gen_script
+  f="$BENCH_DIR/script"
+  "$MEWA" -b --compile "$f.mw" -o "$f.mwc"
+  report_ops "compiled: script, text" 100000 "$(best_of "$MEWA" -b -f "$f.mw")"
+  report_ops "compiled: script, mwc" 100000 "$(best_of "$MEWA" -b -f "$f.mwc")"
+  report_ops "compiled: script, cached" 100000 \
+    "$(best_of env MEWA_CACHE="$cache" "$MEWA" -b -f "$f.mw")"
+
+  gen_nested
+  f="$BENCH_DIR/nested"
+  "$MEWA" --compile "$f.mw" -o "$f.mwc"
+  report "compiled: nested terms, text" "$(wc -c <"$f.mw")" \
+    "$(best_of "$MEWA" -f "$f.mw")"
+  report "compiled: nested terms, mwc" "$(wc -c <"$f.mw")" \
+    "$(best_of "$MEWA" -f "$f.mwc")"
+}
+
+# gen_session - writes assignments of 200000 symbols, then a line reading two
+gen_session() {
+  [ -f "$BENCH_DIR/session.mw" ] && return
+  awk 'BEGIN {
+    for (i = 0; i < 200000; ++i)
+      printf "v%d = %d.5\n", i, i
+    print "v1 + v199999"
+  }' >"$BENCH_DIR/session.mw"
+}
+
+bench_session() {
+  gen_session
+  f="$BENCH_DIR/session"
+  rm -f "$f.mws"
+  { cat "$f.mw"; echo :save; } | "$MEWA" -b --session "$f.mws" >/dev/null
+  report_ops "session: 200000 globals, replayed" 200000 \
+    "$(best_of "$MEWA" -b -f "$f.mw")"
+  report_ops "session: 200000 globals, loaded" 200000 \
+    "$(best_of "$MEWA" --session "$f.mws" "v1 + v199999")"
+}
+
+# gen_results - writes a million numbers of random magnitude and 1 to 17
+# significant digits, one per line
+gen_results() {
+  [ -f "$BENCH_DIR/results.mw" ] && return
+  awk 'BEGIN {
+    srand(1)
+    for (i = 0; i < 1000000; ++i)
+      printf "%.*g\n", 1 + int(rand() * 17), rand() * 10 ^ int(rand() * 40 - 20)
+  }' >"$BENCH_DIR/results.mw"
+}
+
+bench_output() {
+  BATCH_THREADS=${BATCH_THREADS:-0}
+
+  gen_results
+  f="$BENCH_DIR/results.mw"
+  report_ops "output: numbers" 1000000 "$(best_of "$MEWA" -b -f "$f")"
+  report_ops "output: numbers, errors" 1000000 \
+    "$(best_of "$MEWA" -b --errors=interval -f "$f")"
+  report_ops "output: numbers, -j $BATCH_THREADS" 1000000 \
+    "$(best_of "$MEWA" -b -j "$BATCH_THREADS" -f "$f")"
+
+  gen_columns decimals %.6f
+  report_ops "output: columns" 1000000 \
+    "$(best_of "$MEWA" --columns "x * y" -f "$BENCH_DIR/columns-decimals.txt")"
+}
+
+[ $# -eq 0 ] && set -- reader lexer float parser vm dispatch jit columns errors \
+  batch operators calls functions scope compiled session output
+
+for c in "$@"; do
+  case "$c" in
+  reader) bench_reader ;;
+  lexer) bench_lexer ;;
+  float) bench_float ;;
+  parser) bench_parser ;;
+  vm) bench_vm ;;
+  dispatch) bench_dispatch ;;
+  jit) bench_jit ;;
+  columns) bench_columns ;;
+  errors) bench_errors ;;
+  batch) bench_batch ;;
+  operators) bench_operators ;;
+  calls) bench_calls ;;
+  functions) bench_functions ;;
+  scope) bench_scope ;;
+  compiled) bench_compiled ;;
+  session) bench_session ;;
+  output) bench_output ;;
+  *)
+    echo "unknown benchmark: $c" >&2
+    exit 1
+    ;;
+  esac
+done
@@ -0,0 +1,351 @@
+#!/bin/sh
+#
+# check.sh - differential checks for Mewa.
+#
+# usage: ./check.sh [case...]
+#
+# Each case generates random inputs into $CHECK_DIR from $CHECK_SEED, runs
+# $MEWA on them and compares its results with a reference, printing inputs
+# whose results differ. Exit status is that of failure if any case failed.
+# Set CHECK_SEED to try other inputs, CHECK_COUNT to try more of them.
+# The format case reads results of batch mode back with strtod(3) of awk(1),
+# which must give numbers read from input, and prints them again, which must
+# change nothing.
+# The exact case reads decimals held exactly by a double, which must have no
+# error, and decimals that are not, which must have one, along with limits of
+# range.
+# The jit case evaluates formulas on infinities, zeros and NaNs with --jit in
+# every errors mode, which must print what interpreter prints.
+# The compiled case edits trees of compiled script, fixing its checksum as
+# anyone can, which must be refused as corrupt, read directly or from cache.
+# The batch case runs scripts assigning globals seldom and often with -j on
+# CHECK_THREADS threads, from file and pipe, which must print what one thread
+# prints, in the same order.
+
+MEWA=${MEWA:-./bin/mewa}
+CHECK_DIR=${CHECK_DIR:-/tmp/mewa-check}
+CHECK_SEED=${CHECK_SEED:-1}
+CHECK_COUNT=${CHECK_COUNT:-100000}
+CHECK_THREADS=${CHECK_THREADS:-3}
+
+mkdir -p "$CHECK_DIR"
+
+failed=0
+
+# pass name, fail name - report result of case
+pass() { printf "%-28s ok\n" "$1"; }
+fail() {
+  printf "%-28s FAILED\n" "$1"
+  failed=1
+}
+
+# gen_numbers - decimals of every magnitude, normal and subnormal, with up to
+# 25 digits, around boundaries of overflow and underflow too
+gen_numbers() {
+  awk -v seed="$CHECK_SEED" -v n="$CHECK_COUNT" 'BEGIN {
+    srand(seed)
+    for (i = 0; i < n; ++i) {
+      len = int(rand() * 25) + 1
+      s = ""
+      for (k = 0; k < len; ++k)
+        s = s int(rand() * 10)
+      r = rand()
+      if (r < 0.3)
+        e = int(rand() * 60) - 30
+      else if (r < 0.5)
+        e = int(rand() * 40) + 290
+      else if (r < 0.7)
+        e = -int(rand() * 40) - 310
+      else
+        e = int(rand() * 660) - 340
+      printf "%s%s.%se%d\n", rand() < 0.5 ? "-" : "", substr(s, 1, 1), substr(s, 2), e
+    }
+  }' >"$CHECK_DIR/numbers.mw"
+}
+
+check_format() {
+  gen_numbers
+  f="$CHECK_DIR/numbers"
+  "$MEWA" -b -f "$f.mw" | cut -d' ' -f1 >"$f.out"
+
+  # negative zero is printed as zero
+  paste -d' ' "$f.mw" "$f.out" | awk '
+    { x = $1 + 0; y = $2 == "inf" || $2 == "-inf" ? $2 ":" : $2 + 0 }
+    x != 0 && x == 2 * x { x = (x > 0 ? "" : "-") "inf:" }
+    x != y {
+      print "format: " $1 " printed as " $2; bad = 1
+    }
+    END { exit bad }' || { fail "format: read back"; return; }
+  pass "format: read back"
+
+  grep -v inf "$f.out" >"$f.fin"
+  "$MEWA" -b -f "$f.fin" | cut -d' ' -f1 >"$f.again"
+  if cmp -s "$f.fin" "$f.again"; then
+    pass "format: printed again"
+  else
+    diff "$f.fin" "$f.again" | head
+    fail "format: printed again"
+  fi
+}
+
+# gen_exact - decimals w*10^q that doubles hold exactly, followed by tab and
+# 0, and ones they do not, followed by 1: odd part of w*5^q fits 53 bits for
+# q >= 0, and w*10^q is a dyadic fraction for q < 0 when 5^-q divides w
+gen_exact() {
+  awk -v seed="$CHECK_SEED" -v n="$CHECK_COUNT" 'BEGIN {
+    srand(seed)
+    print "100000000000000000000\t0"
+    print "1e22\t0"
+    print "1.7976931348623157e308\t1"
+    for (i = 0; i < n; ++i) {
+      r = rand()
+      q = int(rand() * 23)
+      if (r < 0.25) {
+        a = int(rand() * int((2 ^ 53 - 1) / 5 ^ q)) + 1
+        while (a * 2 < 2 ^ 53 && rand() < 0.5)
+          a *= 2
+        printf "%.0fe%d\t0\n", a, q
+      } else if (r < 0.5) {
+        q = q == 0 ? 1 : q
+        m = int(rand() * int((2 ^ 53 - 1) / 5 ^ q / 2)) * 2 + 1
+        printf "%.0fe-%d\t0\n", m * 5 ^ q, q
+      } else if (r < 0.75) {
+        printf "%.0fe%d\t1\n", int(rand() * 2 ^ 53) + 1, q + 23
+      } else {
+        w = int(rand() * 2 ^ 53) + 1
+        w += w % 5 == 0
+        printf "%.0fe-%d\t1\n", w, q == 0 ? 1 : q
+      }
+    }
+  }' >"$CHECK_DIR/exact.exp"
+  cut -f1 "$CHECK_DIR/exact.exp" >"$CHECK_DIR/exact.mw"
+}
+
+check_exact() {
+  gen_exact
+  f="$CHECK_DIR/exact"
+  "$MEWA" -b -f "$f.mw" >"$f.out"
+
+  if paste "$f.exp" "$f.out" | awk -F '\t' '
+    (index($3, "+/-") != 0) != $2 {
+      print "exact: " $1 ($2 ? " has no error: " : " has error: ") $3; bad = 1
+    }
+    END { exit bad }'; then
+    pass "exact: errors of literals"
+  else
+    fail "exact: errors of literals"
+  fi
+
+  printf '1e-400\n1e309\n' | "$MEWA" -b >"$f.range"
+  if printf '0\ninf\n' | cmp -s - "$f.range"; then
+    pass "exact: underflow, overflow"
+  else
+    fail "exact: underflow, overflow"
+  fi
+}
+
+# gen_formulas - nested formulas of operators and builtins on operands giving
+# infinities, signed zeros, NaNs and complex numbers
+gen_formulas() {
+  awk -v seed="$CHECK_SEED" -v n="$CHECK_COUNT" '
+    function operand(  r) {
+      r = int(rand() * 12)
+      return r == 0 ? "1e308" : r == 1 ? "0" : r == 2 ? "(1e308 * 10)" : \
+        r == 3 ? "2.5" : r == 4 ? "3i" : r == 5 ? "0.5" : r == 6 ? "7" : \
+        r == 7 ? "(0 * 1e308 * 10)" : r == 8 ? "1e-300" : \
+        r == 9 ? "(-(1e308 * 10))" : r == 10 ? "13" : "1"
+    }
+    function formula(d,  r) {
+      r = rand()
+      if (d > 3 || r < 0.3)
+        return operand()
+      if (r < 0.4)
+        return "-(" formula(d + 1) ")"
+      if (r < 0.5)
+        return substr("sin sqrtln  exp ", int(rand() * 4) * 4 + 1, 4) "(" formula(d + 1) ")"
+      return "(" formula(d + 1) " " substr("+-*/^", int(rand() * 5) + 1, 1) " " formula(d + 1) ")"
+    }
+    BEGIN {
+      srand(seed)
+      for (i = 0; i < n; ++i)
+        print formula(0)
+    }' >"$CHECK_DIR/formulas.mw"
+}
+
+check_jit() {
+  gen_formulas
+  f="$CHECK_DIR/formulas"
+  for e in off linear interval; do
+    "$MEWA" -b --errors=$e -f "$f.mw" >"$f.out" 2>"$f.err"
+    "$MEWA" -b --errors=$e --jit -f "$f.mw" >"$f.jout" 2>"$f.jerr"
+    if cmp -s "$f.out" "$f.jout" && cmp -s "$f.err" "$f.jerr"; then
+      pass "jit: errors $e"
+    else
+      paste -d'|' "$f.mw" "$f.out" "$f.jout" | awk -F'|' '$2 != $3' | head
+      fail "jit: errors $e"
+    fi
+  done
+}
+
+# 64-bit words are kept as four 16-bit limbs, lowest first, so that shell
+# arithmetic never overflows.
+
+# mul_limbs a0 a1 a2 a3 b0 b1 b2 b3 - sets h0..h3 to low 64 bits of a * b
+mul_limbs() {
+  c=$(($1 * $5))
+  h0=$((c & 65535))
+  c=$(((c >> 16) + $1 * $6 + $2 * $5))
+  h1=$((c & 65535))
+  c=$(((c >> 16) + $1 * $7 + $2 * $6 + $3 * $5))
+  h2=$((c & 65535))
+  c=$(((c >> 16) + $1 * $8 + $2 * $7 + $3 * $6 + $4 * $5))
+  h3=$((c & 65535))
+}
+
+# xor_shr33 - sets h0..h3 to h ^ h >> 33
+xor_shr33() {
+  h0=$((h0 ^ (h2 >> 1) ^ (h3 & 1) << 15))
+  h1=$((h1 ^ h3 >> 1))
+}
+
+# mwc_sum file - prints checksum of records of compiled script, hashed word
+# by word as mewa does, as bytes in format of printf(1)
+mwc_sum() {
+  version=$(od -An -v -tu4 -j4 -N4 "$1")
+  len=$(($(wc -c <"$1") - 48))
+  h0=$(((version ^ len) & 65535))
+  h1=$((len >> 16 & 65535))
+  h2=$((len >> 32 & 65535))
+  h3=$((len >> 48 & 65535))
+
+  # records fill whole words, so last word hashed is zero
+  set -- $(od -An -v -tu2 -j48 "$1") 0 0 0 0
+  while [ $# -gt 4 ]; do
+    mul_limbs $((h0 ^ $1)) $((h1 ^ $2)) $((h2 ^ $3)) $((h3 ^ $4)) \
+      31765 32586 31161 40503
+    h0=$((h0 ^ h2))
+    h1=$((h1 ^ h3))
+    shift 4
+  done
+  mul_limbs $h0 $h1 $h2 $h3 31765 32586 31161 40503
+
+  xor_shr33
+  mul_limbs $h0 $h1 $h2 $h3 36045 60757 45015 65361
+  xor_shr33
+
+  for l in $h0 $h1 $h2 $h3; do
+    printf '\\%o\\%o' $((l & 255)) $((l >> 8))
+  done
+}
+
+# forge file offset bytes - overwrites bytes, in format of printf(1), at
+# offset of compiled script and fixes its checksum, as anyone can
+forge() {
+  printf "$3" | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+  sum=$(mwc_sum "$1")
+  printf "$sum" | dd of="$1" bs=1 seek=40 conv=notrunc 2>/dev/null
+}
+
+check_compiled() {
+  f="$CHECK_DIR/compiled"
+  printf '1 + 2\n' >"$f.mw"
+  "$MEWA" -b --compile "$f.mw" -o "$f.mwc"
+
+  forge "$f.mwc" 0 '\177'
+  if [ "$("$MEWA" -b -f "$f.mwc" 2>&1)" = 3 ]; then
+    pass "compiled: checksum"
+  else
+    fail "compiled: checksum"
+    return
+  fi
+
+  # nodes 1, 2 and their sum follow header, record and two constants
+  nodes=$((48 + 16 + 2 * 20))
+  for edit in "constant $((nodes + 16)) \\0\\0\\0\\20" \
+    "operand $((nodes + 32)) \\0\\20" \
+    "shared $((nodes + 32)) \\0" \
+    "cycle $((nodes + 28)) \\2" \
+    "type $((nodes + 24)) \\167\\167"; do
+    set -- $edit
+    cp "$f.mwc" "$f-$1.mwc"
+    forge "$f-$1.mwc" "$2" "$3"
+
+    "$MEWA" -b -f "$f-$1.mwc" >"$f.out" 2>"$f.err"
+    status=$?
+    if [ $status -eq 1 ] && grep -q "corrupt record" "$f.err"; then
+      pass "compiled: forged $1"
+    else
+      fail "compiled: forged $1, status $status"
+    fi
+  done
+
+  # forged script in cache is compiled again from text
+  rm -rf "$f.cache"
+  mkdir "$f.cache"
+  MEWA_CACHE="$f.cache" "$MEWA" -b -f "$f.mw" >/dev/null
+  forge "$(ls "$f.cache"/*.mwc)" $((nodes + 16)) '\0\0\0\20'
+  if [ "$(MEWA_CACHE="$f.cache" "$MEWA" -b -f "$f.mw" 2>&1)" = 3 ] &&
+    [ "$(MEWA_CACHE="$f.cache" "$MEWA" -b -f "$f.mw" 2>&1)" = 3 ]; then
+    pass "compiled: forged cache"
+  else
+    fail "compiled: forged cache"
+  fi
+}
+
+# gen_script name p - formulas on globals, of which fraction p are assignments
+# to them, with commands, empty lines and errors among them
+gen_script() {
+  awk -v seed="$CHECK_SEED" -v n="$CHECK_COUNT" -v p="$2" 'BEGIN {
+    srand(seed)
+    print "x = 1"
+    print "y = 2"
+    for (i = 0; i < n; ++i) {
+      r = rand()
+      if (r < p)
+        printf "%s = %d * %s + %d\n", rand() < 0.5 ? "x" : "y", i % 7, rand() < 0.5 ? "x" : "y", i
+      else if (r < p + 0.001)
+        print ":load /nonexistent"
+      else if (r < p + 0.01)
+        print ""
+      else if (r < p + 0.02)
+        print "2 * (" i
+      else
+        printf "x * %d + y / %d - sin(%d)\n", i % 100, i % 13 + 1, i
+    }
+  }' >"$CHECK_DIR/$1.mw"
+}
+
+check_batch() {
+  for p in 0 0.001 0.3; do
+    gen_script "script-$p" $p
+    f="$CHECK_DIR/script-$p"
+    "$MEWA" -b -f "$f.mw" >"$f.out" 2>"$f.err"
+
+    "$MEWA" -b -j "$CHECK_THREADS" -f "$f.mw" >"$f.jout" 2>"$f.jerr"
+    "$MEWA" -b -j "$CHECK_THREADS" <"$f.mw" >"$f.pout" 2>"$f.perr"
+    if cmp -s "$f.out" "$f.jout" && cmp -s "$f.err" "$f.jerr" &&
+      cmp -s "$f.out" "$f.pout" && cmp -s "$f.err" "$f.perr"; then
+      pass "batch: assigning $p"
+    else
+      fail "batch: assigning $p"
+    fi
+  done
+}
+
+[ $# -eq 0 ] && set -- format exact jit compiled batch
+
+for c in "$@"; do
+  case "$c" in
+  format) check_format ;;
+  exact) check_exact ;;
+  jit) check_jit ;;
+  compiled) check_compiled ;;
+  batch) check_batch ;;
+  *)
+    echo "unknown check: $c" >&2
+    exit 1
+    ;;
+  esac
+done
+
+exit $failed
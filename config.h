@@ -74,6 +74,10 @@
 // result tree max depth
 #define RESULT_MAX_DEPTH (50)
 
+// buffer of results of batch and columns modes written to file or pipe, which
+// is written out once full
+#define RESULT_BUFFER_SIZE (1 << 20)
+
 //=:config:pipe
 #define PIPE_RESULT_PREFIX "= "
 
@@ -88,6 +92,53 @@
 
 #define REPL_RESULT_SUFFIX "\n"
 
+//=:config:interpreter
+// uncomment to dispatch bytecode with portable switch instead of computed goto
+// #define IR_DISPATCH_SWITCH
+
+// address space reserved for machine code of --jit, pages are committed on
+// demand; must stay below 2 GiB for 32 bit jumps
+#define JIT_CODE_RESERVE ((size_t)1 << 30)
+
+// longest bytecode run as machine code, longer one is interpreted since its
+// machine code no longer fits into cache and runs slower than bytecode
+#define JIT_MAX_INSTRS (1 << 15)
+
+// error propagation used unless --errors is passed: ERRORS_OFF skips it,
+// ERRORS_LINEAR estimates relative errors to first order and ERRORS_INTERVAL
+// bounds them rigorously
+#define ERRORS_DEFAULT ERRORS_LINEAR
+
+// lanes evaluated at once by --columns, halved while registers of expression
+// across them do not fit into LANES_MEMORY bytes
+#define LANES_WIDTH (256)
+
+#define LANES_MEMORY ((size_t)1 << 26)
+
+// input bytes of one chunk of lines evaluated by a worker of batch mode with
+// -j; smaller chunks balance better, bigger ones cost less to hand out
+#define BATCH_CHUNK_SIZE ((size_t)1 << 16)
+
+// chunks read ahead per worker of batch mode with -j, bounding memory taken
+// by input and results waiting to be printed in order
+#define BATCH_CHUNKS_PER_WORKER (8)
+
+// lines without assignments that batch mode with -j evaluates in order after
+// one assigning symbols before handing the rest of its chunk back to workers;
+// lines assigning often are cheaper to evaluate in order than in rounds
+#define BATCH_SERIAL_LINES (64)
+
+// workers of batch mode per online CPU that -j may ask for; more of them only
+// take memory and switch contexts
+#define BATCH_WORKERS_PER_CPU (4)
+
+// environment variable naming directory where scripts run by -f are cached
+// compiled, keyed by hash of their text; they are not cached unless it is set
+#define MWC_CACHE_ENV "MEWA_CACHE"
+// bytes of native stack nested calls of user functions may take, well below
+// stack of any thread; deeper recursion fails with IR_ERR_STACK_OVERFLOW
+#define FN_STACK_MAX ((size_t)1 << 21)
+
 //=:config:math
 #define MAX_DIFF_ULPS (4096)
 
@@ -95,11 +146,23 @@
 
 #define MAX_DIFF_ABS (0.00000000001)
 
+// accuracy of libm functions in ulps assumed by bounds of --errors=interval
+#define INTERVAL_LIBM_ULPS (4)
+
 //=:config:internal
 // must be at least 1
-#define INTERNAL_READING_BUF_SIZE (512)
+#define INTERNAL_READING_BUF_SIZE (1 << 16)
+
+// address space reserved for parser nodes, bytecode and registers each,
+// pages are committed on demand
+#define NODE_ARENA_RESERVE ((size_t)1 << 36)
+
+// committed node memory kept between expressions
+#define NODE_ARENA_RETAIN ((size_t)1 << 20)
 
-#define NODE_BUF_SIZE (1 << 20)
+// whether to advise transparent hugepages for big node arenas
+#define NODE_ARENA_HUGEPAGES true
 
-// must be not 2^n
-#define GLOBAL_SCOPE_CAPACITY (255)
+// initial slots of global scope, which grows as symbols are assigned; must be
+// power of 2
+#define GLOBAL_SCOPE_CAPACITY (256)
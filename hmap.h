@@ -26,7 +26,10 @@
 #include <stdlib.h>
 #include <string.h>
 
-// NOTE: after removing hash function, size must be not equal to 2^n
+#if defined(__GNUC__) && defined(__SSE2__)
+#define HMAP_SSE2
+#include <emmintrin.h>
+#endif
 
 //=:util:memory
 
@@ -49,139 +52,290 @@ typedef struct {
   uint64_t val[];
 } Map_Entry;
 
-//=:hmap:get:acsl
-//@ ghost size_t entry_last = sizeof(Map_Entry) - 1;
-//@ logic integer entry_len(size_t val_sz) = 1 + ((val_sz + entry_last) & ~entry_last) / (entry_last + 1);
+// control bytes of slots which hold no entry; ones of full slots are 7 bits
+// of hash of their keys, so only these two have high bit set
+#define MAP_EMPTY ((int8_t)-128)
+#define MAP_DELETED ((int8_t)-2)
 
-/*@ predicate is_key_match_or_empty(Map_Entry *entries, integer entry_len, integer i, uint64_t key) =
-  @   entries[i * entry_len].key == key || entries[i * entry_len].key == 0;
-*/
+// slots whose control bytes are compared at once
+#define MAP_GROUP 16
+
+// Map - open addressing table of entries, every one followed by value of
+// val_sz bytes. Keys are never 0. Key is probed for in groups of MAP_GROUP
+// slots, comparing their control bytes with 7 bits of its hash by one SIMD
+// instruction; probe stops at group with empty slot. Removed entries leave
+// tombstones, which are reused by insertion and dropped by rehash.
+typedef struct {
+  int8_t *ctrl;       // control byte of every slot
+  Map_Entry *entries; // slots, in the same allocation as ctrl
+  size_t cap;         // power of 2, at least MAP_GROUP
+  size_t len;         // of entries
+  size_t growth;      // empty slots left to fill before rehash
+} Map;
+
+static inline size_t map_entry_len(size_t val_sz) {
+  return align(sizeof(Map_Entry) + val_sz, sizeof(Map_Entry)) /
+         sizeof(Map_Entry);
+}
+
+static inline Map_Entry *map_entry(const Map *m, size_t i, size_t val_sz) {
+  return &m->entries[i * map_entry_len(val_sz)];
+}
+
+static inline uint64_t map_hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDull;
+  return key ^ key >> 33;
+}
+
+static inline int8_t map_h2(uint64_t hash) { return (int8_t)(hash >> 57); }
+
+//=:hmap:group
+
+// map_match - returns mask of slots of group at ctrl whose control byte is c.
+static inline uint32_t map_match(const int8_t *ctrl, int8_t c) {
+#ifdef HMAP_SSE2
+  __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+  uint32_t mask = 0;
+  for (unsigned i = 0; i < MAP_GROUP; ++i)
+    mask |= (uint32_t)(ctrl[i] == c) << i;
+  return mask;
+#endif
+}
+
+// map_match_free - returns mask of slots of group at ctrl which are empty or
+// deleted, by high bits of their control bytes.
+static inline uint32_t map_match_free(const int8_t *ctrl) {
+#ifdef HMAP_SSE2
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+  uint32_t mask = 0;
+  for (unsigned i = 0; i < MAP_GROUP; ++i)
+    mask |= (uint32_t)(ctrl[i] < 0) << i;
+  return mask;
+#endif
+}
+
+// map_next - returns start of group probed after one at pos on step, so that
+// triangular steps visit every group once.
+static inline size_t map_next(const Map *m, size_t pos, size_t step) {
+  return (pos + step * MAP_GROUP) & (m->cap - 1);
+}
+
+static inline size_t map_start(const Map *m, uint64_t hash) {
+  return hash & (m->cap - 1) & ~(size_t)(MAP_GROUP - 1);
+}
+
+//=:hmap:init
+
+// map_init - allocates map of cap slots, power of 2 at least MAP_GROUP.
+// Returns false if allocation failed.
+/*@ requires \valid(m);
+  @ requires cap >= MAP_GROUP && (cap & (cap - 1)) == 0;
+  @ assigns *m;
+ */
+static inline bool map_init(Map *m, size_t cap, size_t val_sz) {
+  size_t entry_sz = map_entry_len(val_sz) * sizeof(Map_Entry);
+  char *p = malloc(cap + cap * entry_sz);
+  if (p == NULL)
+    return false;
+
+  memset(p, MAP_EMPTY, cap);
+  *m = (Map){
+      .ctrl = (int8_t *)p,
+      .entries = (Map_Entry *)(p + cap),
+      .cap = cap,
+      .growth = cap - cap / 8,
+  };
+  return true;
+}
+
+static inline void map_free(Map *m) {
+  free(m->ctrl);
+  *m = (Map){0};
+}
+
+// map_copy - sets dst to copy of src, reusing memory of dst if it is of the
+// same capacity. Returns false if allocation failed.
+/*@ requires \valid(dst) && \valid_read(src);
+  @ requires \separated(dst, src);
+  @ assigns *dst;
+ */
+static inline bool map_copy(Map *dst, const Map *src, size_t val_sz) {
+  if (dst->cap != src->cap) {
+    map_free(dst);
+    if (!map_init(dst, src->cap, val_sz))
+      return false;
+  }
+
+  size_t entry_sz = map_entry_len(val_sz) * sizeof(Map_Entry);
+  memcpy(dst->ctrl, src->ctrl, src->cap + src->cap * entry_sz);
+  dst->len = src->len;
+  dst->growth = src->growth;
+  return true;
+}
 
-// map_get - sets \*val to \*entries.val where key = entries.key;
-/*@ requires entries_cap != 0;
-	@ requires \valid(entries + (0 .. entries_cap*entry_len(val_sz) - 1));
-  @ requires key != 0;
-  @ requires \valid((char*) val + (0..val_sz-1));
-  @ behavior key_found:
-  @   assumes \exists integer i;
-  @     0 <= i < entries_cap && entries[i * entry_len(val_sz)].key == key;
-  @   ensures \result == true;
-  @   assigns ((char*)val)[0 .. val_sz-1];
-  @ behavior key_not_found:
-  @   assumes \forall integer i;
-  @     0 <= i < entries_cap ==> entries[i * entry_len(val_sz)].key != key;
-  @   ensures \result == false;
-  @   assigns \nothing;
-  @ complete behaviors;
-	@ disjoint behaviors;
-*/
 //=:hmap:get
-static inline bool map_get(Map_Entry *restrict entries, size_t entries_cap,
-                           uint64_t key, void *restrict val, size_t val_sz) {
-  size_t index = key % entries_cap;
-  size_t steps = 0;
 
-  size_t entry_len =
-      align(sizeof(Map_Entry) + val_sz, sizeof(Map_Entry)) / sizeof(Map_Entry);
+// map_find - returns slot of entry of key, or cap if there is none.
+static inline size_t map_find(const Map *m, uint64_t key, size_t val_sz) {
+  uint64_t hash = map_hash(key);
+  size_t pos = map_start(m, hash);
 
-  do {
-    Map_Entry *entry = &entries[index * entry_len];
+  for (size_t step = 1; step <= m->cap / MAP_GROUP; ++step) {
+    const int8_t *g = &m->ctrl[pos];
 
-    if (entry->key == key) {
-      memcpy(val, entry->val, val_sz);
-      return true;
+    for (uint32_t bits = map_match(g, map_h2(hash)); bits != 0;
+         bits &= bits - 1) {
+      size_t i = pos + __builtin_ctz(bits);
+      if (map_entry(m, i, val_sz)->key == key)
+        return i;
     }
 
-    index = (index + 1) % entries_cap;
-    ++steps;
-  } while (steps < entries_cap);
+    if (map_match(g, MAP_EMPTY) != 0)
+      break;
+
+    pos = map_next(m, pos, step);
+  }
 
-  return false;
+  return m->cap;
 }
 
-#define MAP_GET(entries, cap, key, val) \
-  map_get(entries, cap, key, val, sizeof(*val))
+// map_get - sets \*val to value of key. Returns false if there is none.
+/*@ requires \valid_read(m);
+  @ requires key != 0;
+  @ requires \valid((char*) val + (0..val_sz-1));
+  @ assigns ((char*)val)[0 .. val_sz-1];
+ */
+static inline bool map_get(const Map *restrict m, uint64_t key,
+                           void *restrict val, size_t val_sz) {
+  size_t i = map_find(m, key, val_sz);
+  if (i == m->cap)
+    return false;
+
+  if (val_sz != 0)
+    memcpy(val, map_entry(m, i, val_sz)->val, val_sz);
+  return true;
+}
 
-#define SET_GET(entries, cap, key) map_get(entries, cap, key, NULL, 0)
+#define MAP_GET(m, key, val) map_get(m, key, val, sizeof(*val))
+
+#define SET_GET(m, key) map_get(m, key, NULL, 0)
 
-//=:hmap:set:acsl
-// map_set - sets \*entries.val to \*val where key = entries.key;
-/*@ requires entries_cap != 0;
-	@ requires \valid(entries + (0 .. entries_cap*entry_len(val_sz) - 1));
-  @ requires key != 0;
-  @ requires \valid((char*) val + (0 .. val_sz-1));
-  @ behavior key_found:
-  @   assumes \exists integer i;
-  @      0 <= i < entries_cap && is_key_match_or_empty(entries, entry_len(val_sz), i, key);
-  @   ensures \result;
-  @   assigns ((char*) entries[0 .. entries_cap*entry_len(val_sz) - 1].val)[0..val_sz-1];
-  @ behavior key_not_found:
-  @   assumes \forall integer i;
-  @     0 <= i < entries_cap ==> !is_key_match_or_empty(entries, entry_len(val_sz), i, key);
-  @   ensures !\result;
-  @   assigns \nothing;
-  @ complete behaviors;
-	@ disjoint behaviors;
-*/
 //=:hmap:set
-static inline bool map_set(Map_Entry *restrict entries, size_t entries_cap,
-                           uint64_t key, void *restrict val, size_t val_sz) {
-  size_t index = key % entries_cap;
-  size_t steps = 0;
 
-  size_t entry_len =
-      align(sizeof(Map_Entry) + val_sz, sizeof(Map_Entry)) / sizeof(Map_Entry);
+// map_slot - returns free slot to insert entry of hash into.
+static inline size_t map_slot(const Map *m, uint64_t hash) {
+  size_t pos = map_start(m, hash);
+  uint32_t bits;
 
-  do {
-    Map_Entry *entry = &entries[index * entry_len];
+  for (size_t step = 1; (bits = map_match_free(&m->ctrl[pos])) == 0; ++step)
+    pos = map_next(m, pos, step);
 
-    if (entry->key == key || entry->key == 0) {
-      entry->key = key;
-      memcpy(entry->val, val, val_sz);
-      return true;
-    }
-
-    index = (index + 1) % entries_cap;
-    ++steps;
-  } while (steps < entries_cap);
+  return pos + __builtin_ctz(bits);
+}
 
-  return false;
+// map_rehash - moves entries of m into new table of cap slots, leaving
+// tombstones behind. Returns false if allocation failed.
+static inline bool map_rehash(Map *m, size_t cap, size_t val_sz) {
+  size_t entry_sz = map_entry_len(val_sz) * sizeof(Map_Entry);
+  Map g;
+
+  if (!map_init(&g, cap, val_sz))
+    return false;
+
+  for (size_t i = 0; i < m->cap; ++i) {
+    if (m->ctrl[i] < 0)
+      continue;
+
+    size_t j = map_slot(&g, map_hash(map_entry(m, i, val_sz)->key));
+    g.ctrl[j] = m->ctrl[i];
+    memcpy(map_entry(&g, j, val_sz), map_entry(m, i, val_sz), entry_sz);
+  }
+
+  g.len = m->len;
+  g.growth -= m->len;
+  map_free(m);
+  *m = g;
+  return true;
 }
 
-#define MAP_SET(entries, cap, key, val) \
-  map_set(entries, cap, key, val, sizeof(*val))
+// map_reserve - makes room for len more entries, so adding them does not
+// rehash. Returns false if allocation failed.
+static inline bool map_reserve(Map *m, size_t len, size_t val_sz) {
+  if (m->growth >= len)
+    return true;
 
-#define SET_SET(entries, cap, key) map_set(entries, cap, key, NULL, 0)
+  size_t cap = m->cap;
+  while (cap - cap / 8 < m->len + len)
+    cap *= 2;
 
-//=:hmap:pop:acsl
-// map_pop - sets \*entries.key to 0 where key = entries.key;
-// must be called in reversed order of corresponding keys setting.
-/* TODO: add ACSL annotation
-*/
-//=:hmap:pop
-static inline bool map_pop(Map_Entry *restrict entries, size_t entries_cap,
-                           uint64_t key, size_t val_sz) {
-  size_t index = key % entries_cap;
-  size_t steps = 0;
+  return map_rehash(m, cap, val_sz);
+}
 
-  size_t entry_len =
-      align(sizeof(Map_Entry) + val_sz, sizeof(Map_Entry)) / sizeof(Map_Entry);
+// map_set - sets value of key to \*val, adding entry if there is none. Map
+// grows twice once 7/8 of it is taken, tombstones count as taken. Returns
+// false if allocation failed.
+/*@ requires \valid(m);
+  @ requires key != 0;
+  @ requires \valid_read((char*) val + (0 .. val_sz-1));
+ */
+static inline bool map_set(Map *restrict m, uint64_t key,
+                           const void *restrict val, size_t val_sz) {
+  size_t i = map_find(m, key, val_sz);
+
+  if (i == m->cap) {
+    if (m->growth == 0 &&
+        !map_rehash(m, m->len + 1 > m->cap / 2 ? m->cap * 2 : m->cap, val_sz))
+      return false;
+
+    uint64_t hash = map_hash(key);
+    i = map_slot(m, hash);
+    m->growth -= m->ctrl[i] == MAP_EMPTY;
+    m->ctrl[i] = map_h2(hash);
+    map_entry(m, i, val_sz)->key = key;
+    ++m->len;
+  }
+
+  if (val_sz != 0)
+    memcpy(map_entry(m, i, val_sz)->val, val, val_sz);
+  return true;
+}
 
-  do {
-    Map_Entry *entry = &entries[index * entry_len];
+#define MAP_SET(m, key, val) map_set(m, key, val, sizeof(*val))
 
-    if (entry->key == key) {
-      entry->key = 0;
-      return true;
-    }
+#define SET_SET(m, key) map_set(m, key, NULL, 0)
 
-    index = (index + 1) % entries_cap;
-    ++steps;
-  } while (steps < entries_cap);
+//=:hmap:pop
 
-  return false;
+// map_pop - removes entry of key. Returns false if there is none. Slot is
+// emptied when its group has empty slot, as no probe went past the group then,
+// and becomes tombstone otherwise.
+/*@ requires \valid(m);
+  @ requires key != 0;
+  @ assigns m->len, m->growth, m->ctrl[0 .. m->cap-1];
+ */
+static inline bool map_pop(Map *m, uint64_t key, size_t val_sz) {
+  size_t i = map_find(m, key, val_sz);
+  if (i == m->cap)
+    return false;
+
+  size_t pos = i & ~(size_t)(MAP_GROUP - 1);
+  if (map_match(&m->ctrl[pos], MAP_EMPTY) != 0) {
+    m->ctrl[i] = MAP_EMPTY;
+    ++m->growth;
+  } else {
+    m->ctrl[i] = MAP_DELETED;
+  }
+
+  --m->len;
+  return true;
 }
 
-#define SET_POP(entries, cap, key) map_pop(entries, cap, key, 0)
+#define MAP_POP(m, key, val) map_pop(m, key, sizeof(*val))
+
+#define SET_POP(m, key) map_pop(m, key, 0)
 
 #endif
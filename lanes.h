@@ -0,0 +1,534 @@
+/******************************************************************************\
+*                                                                              *
+*    Mewa. Math EWAluator.                                                     *
+*    Copyright (C) 2024 Mark Mandriota                                         *
+*                                                                              *
+*    This program is free software: you can redistribute it and/or modify      *
+*    it under the terms of the GNU General Public License as published by      *
+*    the Free Software Foundation, either version 3 of the License, or         *
+*    (at your option) any later version.                                       *
+*                                                                              *
+*    This program is distributed in the hope that it will be useful,           *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*    GNU General Public License for more details.                              *
+*                                                                              *
+*    You should have received a copy of the GNU General Public License         *
+*    along with this program.  If not, see <https://www.gnu.org/licenses/>.    *
+*                                                                              *
+\******************************************************************************/
+
+#ifndef LANES_H
+#define LANES_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LANES_X86
+#include <immintrin.h>
+#endif
+
+// Lane_Reg - one register of bytecode across lanes, stored column-wise.
+typedef struct {
+  double *re;
+  double *im;
+  float *rel_err;
+  int32_t *type;
+} Lane_Reg;
+
+// Lane_Fn - computes n lanes of d from a and b, setting bit of every lane in
+// slow whose result must be recomputed by scalar executor. Returns number of
+// such lanes. d never aliases a or b.
+typedef size_t (*Lane_Fn)(Lane_Reg d, Lane_Reg a, Lane_Reg b, uint64_t *slow,
+                          size_t n);
+
+static inline size_t lanes_slow(uint64_t *slow, size_t i, uint64_t bits) {
+  slow[i / 64] |= bits << (i % 64);
+  return __builtin_popcountll(bits);
+}
+
+//=:lanes:scalar
+
+// Sum of exact operands is exact, so its relative error is zero, unless it
+// is zero itself or not finite.
+static inline bool lanes_add_exact(double ra, double rb, double x, double y) {
+  return ra == 0 && rb == 0 && isfinite(x) && isfinite(y) &&
+         (x != 0 || y != 0);
+}
+
+// lanes_add_real - relative error of sum x of real operands, computed as
+// ir_biop_exec_real does. NaN error is left to scalar executor, as its sign
+// depends on order of operations.
+static inline double lanes_add_real(double ra, double rb, double ar, double br,
+                                    double x) {
+  double l = ra * ar, r = rb * br;
+  return sqrt(l * l + r * r) / fabs(x);
+}
+
+#define LANES_DEFINE_ADD_SCALAR(name, op)                                     \
+  static inline size_t name##_scalar_from(Lane_Reg d, Lane_Reg a, Lane_Reg b, \
+                                          uint64_t *slow, size_t i,           \
+                                          size_t n) {                         \
+    size_t slow_len = 0;                                                      \
+    for (; i < n; ++i) {                                                      \
+      double x = a.re[i] op b.re[i];                                          \
+      double y = a.im[i] op b.im[i];                                          \
+      d.re[i] = x;                                                            \
+      d.im[i] = y;                                                            \
+      d.rel_err[i] = 0;                                                       \
+      if (a.im[i] == 0 && b.im[i] == 0) {                                     \
+        float e = lanes_add_real(a.rel_err[i], b.rel_err[i], a.re[i],         \
+                                 b.re[i], x);                                 \
+        d.rel_err[i] = e;                                                     \
+        if (!isnan(e))                                                        \
+          continue;                                                           \
+      } else if (lanes_add_exact(a.rel_err[i], b.rel_err[i], x, y))           \
+        continue;                                                             \
+      slow_len += lanes_slow(slow, i, 1);                                     \
+    }                                                                         \
+    return slow_len;                                                          \
+  }                                                                           \
+  static size_t name##_scalar(Lane_Reg d, Lane_Reg a, Lane_Reg b,             \
+                              uint64_t *slow, size_t n) {                     \
+    return name##_scalar_from(d, a, b, slow, 0, n);                           \
+  }
+
+LANES_DEFINE_ADD_SCALAR(lanes_add, +)
+LANES_DEFINE_ADD_SCALAR(lanes_sub, -)
+
+// Product is computed as compiler does for complex numbers, lanes which need
+// recovery of infinities are left to scalar executor. Relative error is hypot
+// of operands' ones when errors is true and zero otherwise.
+#define LANES_DEFINE_MUL_SCALAR(name, errors)                                 \
+  static inline size_t name##_scalar_from(Lane_Reg d, Lane_Reg a, Lane_Reg b, \
+                                          uint64_t *slow, size_t i,           \
+                                          size_t n) {                         \
+    size_t slow_len = 0;                                                      \
+    for (; i < n; ++i) {                                                      \
+      double x = a.re[i] * b.re[i] - a.im[i] * b.im[i];                       \
+      double y = a.im[i] * b.re[i] + a.re[i] * b.im[i];                       \
+      double ra = a.rel_err[i], rb = b.rel_err[i];                            \
+      d.re[i] = x;                                                            \
+      d.im[i] = y;                                                            \
+      d.rel_err[i] = (errors) ? (float)sqrt(ra * ra + rb * rb) : 0;           \
+      if (isnan(x) || isnan(y))                                               \
+        slow_len += lanes_slow(slow, i, 1);                                   \
+    }                                                                         \
+    return slow_len;                                                          \
+  }                                                                           \
+  static size_t name##_scalar(Lane_Reg d, Lane_Reg a, Lane_Reg b,             \
+                              uint64_t *slow, size_t n) {                     \
+    return name##_scalar_from(d, a, b, slow, 0, n);                           \
+  }
+
+LANES_DEFINE_MUL_SCALAR(lanes_mul, true)
+LANES_DEFINE_MUL_SCALAR(lanes_mul_plain, false)
+
+// Plain sums leave relative errors zero, for evaluation without them.
+#define LANES_DEFINE_PLAIN_SCALAR(name, op)                                   \
+  static inline size_t name##_scalar_from(Lane_Reg d, Lane_Reg a, Lane_Reg b, \
+                                          uint64_t *slow, size_t i,           \
+                                          size_t n) {                         \
+    (void)slow;                                                               \
+    for (; i < n; ++i) {                                                      \
+      d.re[i] = a.re[i] op b.re[i];                                           \
+      d.im[i] = a.im[i] op b.im[i];                                           \
+      d.rel_err[i] = 0;                                                       \
+    }                                                                         \
+    return 0;                                                                 \
+  }                                                                           \
+  static size_t name##_scalar(Lane_Reg d, Lane_Reg a, Lane_Reg b,             \
+                              uint64_t *slow, size_t n) {                     \
+    return name##_scalar_from(d, a, b, slow, 0, n);                           \
+  }
+
+LANES_DEFINE_PLAIN_SCALAR(lanes_add_plain, +)
+LANES_DEFINE_PLAIN_SCALAR(lanes_sub_plain, -)
+
+static inline size_t lanes_neg_scalar_from(Lane_Reg d, Lane_Reg a, size_t i,
+                                           size_t n) {
+  for (; i < n; ++i) {
+    d.re[i] = -a.re[i];
+    d.im[i] = -a.im[i];
+    d.rel_err[i] = a.rel_err[i];
+  }
+
+  return 0;
+}
+
+static size_t lanes_neg_scalar(Lane_Reg d, Lane_Reg a, Lane_Reg b,
+                               uint64_t *slow, size_t n) {
+  (void)b, (void)slow;
+  return lanes_neg_scalar_from(d, a, 0, n);
+}
+
+#ifdef LANES_X86
+
+//=:lanes:sse2
+
+#define LANES_SSE2 __attribute__((target("sse2")))
+
+#define LANES_DEFINE_ADD_SSE2(name, op)                                    \
+  LANES_SSE2 static size_t name##_sse2(Lane_Reg d, Lane_Reg a, Lane_Reg b, \
+                                       uint64_t *slow, size_t n) {         \
+    const __m128d zero = _mm_setzero_pd(), sign = _mm_set1_pd(-0.0);       \
+    size_t i = 0, slow_len = 0;                                            \
+    for (; i + 2 <= n; i += 2) {                                           \
+      __m128d ar = _mm_loadu_pd(a.re + i), ai = _mm_loadu_pd(a.im + i);    \
+      __m128d br = _mm_loadu_pd(b.re + i), bi = _mm_loadu_pd(b.im + i);    \
+      __m128d x = op(ar, br), y = op(ai, bi);                              \
+      __m128d ra = _mm_cvtps_pd(lanes_load2_ps(a.rel_err + i));            \
+      __m128d rb = _mm_cvtps_pd(lanes_load2_ps(b.rel_err + i));            \
+      __m128d l = _mm_mul_pd(ra, ar), r = _mm_mul_pd(rb, br);              \
+      __m128d e = _mm_div_pd(                                              \
+          _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(l, l), _mm_mul_pd(r, r))),     \
+          _mm_andnot_pd(sign, x));                                         \
+      __m128d real = _mm_and_pd(_mm_cmpeq_pd(ai, zero), _mm_cmpeq_pd(bi, zero)); \
+      __m128d ok = _mm_and_pd(_mm_cmpeq_pd(ra, zero), _mm_cmpeq_pd(rb, zero)); \
+      ok = _mm_and_pd(ok, _mm_cmpeq_pd(_mm_sub_pd(x, x), zero));           \
+      ok = _mm_and_pd(ok, _mm_cmpeq_pd(_mm_sub_pd(y, y), zero));           \
+      ok = _mm_and_pd(ok, _mm_or_pd(_mm_cmpneq_pd(x, zero),                \
+                                    _mm_cmpneq_pd(y, zero)));              \
+      e = _mm_and_pd(real, e);                                             \
+      ok = _mm_or_pd(_mm_andnot_pd(real, ok),                              \
+                     _mm_and_pd(real, _mm_cmpord_pd(e, e)));               \
+      _mm_storeu_pd(d.re + i, x);                                          \
+      _mm_storeu_pd(d.im + i, y);                                          \
+      lanes_store2_ps(d.rel_err + i, _mm_cvtpd_ps(e));                     \
+      unsigned m = ~_mm_movemask_pd(ok) & 0x3;                             \
+      if (m != 0)                                                          \
+        slow_len += lanes_slow(slow, i, m);                                \
+    }                                                                      \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);             \
+  }
+
+LANES_SSE2 static inline __m128 lanes_load2_ps(const float *p) {
+  return _mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)p));
+}
+
+LANES_SSE2 static inline void lanes_store2_ps(float *p, __m128 v) {
+  _mm_storel_epi64((__m128i *)p, _mm_castps_si128(v));
+}
+
+LANES_DEFINE_ADD_SSE2(lanes_add, _mm_add_pd)
+LANES_DEFINE_ADD_SSE2(lanes_sub, _mm_sub_pd)
+
+#define LANES_DEFINE_MUL_SSE2(name, errors)                                          \
+  LANES_SSE2 static size_t name##_sse2(Lane_Reg d, Lane_Reg a, Lane_Reg b,           \
+                                       uint64_t *slow, size_t n) {                   \
+    size_t i = 0, slow_len = 0;                                                      \
+    for (; i + 2 <= n; i += 2) {                                                     \
+      __m128d ar = _mm_loadu_pd(a.re + i), ai = _mm_loadu_pd(a.im + i);              \
+      __m128d br = _mm_loadu_pd(b.re + i), bi = _mm_loadu_pd(b.im + i);              \
+      __m128d x = _mm_sub_pd(_mm_mul_pd(ar, br), _mm_mul_pd(ai, bi));                \
+      __m128d y = _mm_add_pd(_mm_mul_pd(ai, br), _mm_mul_pd(ar, bi));                \
+      _mm_storeu_pd(d.re + i, x);                                                    \
+      _mm_storeu_pd(d.im + i, y);                                                    \
+      if (errors) {                                                                  \
+        __m128d ra = _mm_cvtps_pd(lanes_load2_ps(a.rel_err + i));                    \
+        __m128d rb = _mm_cvtps_pd(lanes_load2_ps(b.rel_err + i));                    \
+        __m128d r = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(ra, ra), _mm_mul_pd(rb, rb))); \
+        lanes_store2_ps(d.rel_err + i, _mm_cvtpd_ps(r));                             \
+      } else {                                                                       \
+        lanes_store2_ps(d.rel_err + i, _mm_setzero_ps());                            \
+      }                                                                              \
+      unsigned m = _mm_movemask_pd(_mm_cmpunord_pd(x, y));                           \
+      if (m != 0)                                                                    \
+        slow_len += lanes_slow(slow, i, m);                                          \
+    }                                                                                \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);                       \
+  }
+
+LANES_DEFINE_MUL_SSE2(lanes_mul, true)
+LANES_DEFINE_MUL_SSE2(lanes_mul_plain, false)
+
+#define LANES_DEFINE_PLAIN_SSE2(name, op)                                          \
+  LANES_SSE2 static size_t name##_sse2(Lane_Reg d, Lane_Reg a, Lane_Reg b,         \
+                                       uint64_t *slow, size_t n) {                 \
+    size_t i = 0;                                                                  \
+    for (; i + 2 <= n; i += 2) {                                                   \
+      _mm_storeu_pd(d.re + i, op(_mm_loadu_pd(a.re + i), _mm_loadu_pd(b.re + i))); \
+      _mm_storeu_pd(d.im + i, op(_mm_loadu_pd(a.im + i), _mm_loadu_pd(b.im + i))); \
+      lanes_store2_ps(d.rel_err + i, _mm_setzero_ps());                            \
+    }                                                                              \
+    return name##_scalar_from(d, a, b, slow, i, n);                                \
+  }
+
+LANES_DEFINE_PLAIN_SSE2(lanes_add_plain, _mm_add_pd)
+LANES_DEFINE_PLAIN_SSE2(lanes_sub_plain, _mm_sub_pd)
+
+LANES_SSE2 static size_t lanes_neg_sse2(Lane_Reg d, Lane_Reg a, Lane_Reg b,
+                                        uint64_t *slow, size_t n) {
+  (void)b, (void)slow;
+  const __m128d sign = _mm_set1_pd(-0.0);
+  size_t i = 0;
+
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(d.re + i, _mm_xor_pd(_mm_loadu_pd(a.re + i), sign));
+    _mm_storeu_pd(d.im + i, _mm_xor_pd(_mm_loadu_pd(a.im + i), sign));
+  }
+  memcpy(d.rel_err, a.rel_err, i * sizeof(float));
+
+  return lanes_neg_scalar_from(d, a, i, n);
+}
+
+//=:lanes:avx2
+
+#define LANES_AVX2 __attribute__((target("avx2")))
+
+#define LANES_DEFINE_ADD_AVX2(name, op)                                    \
+  LANES_AVX2 static size_t name##_avx2(Lane_Reg d, Lane_Reg a, Lane_Reg b, \
+                                       uint64_t *slow, size_t n) {         \
+    const __m256d zero = _mm256_setzero_pd(), sign = _mm256_set1_pd(-0.0); \
+    size_t i = 0, slow_len = 0;                                            \
+    for (; i + 4 <= n; i += 4) {                                           \
+      __m256d ar = _mm256_loadu_pd(a.re + i), ai = _mm256_loadu_pd(a.im + i); \
+      __m256d br = _mm256_loadu_pd(b.re + i), bi = _mm256_loadu_pd(b.im + i); \
+      __m256d x = op(ar, br), y = op(ai, bi);                              \
+      __m256d ra = _mm256_cvtps_pd(_mm_loadu_ps(a.rel_err + i));           \
+      __m256d rb = _mm256_cvtps_pd(_mm_loadu_ps(b.rel_err + i));           \
+      __m256d l = _mm256_mul_pd(ra, ar), r = _mm256_mul_pd(rb, br);        \
+      __m256d e = _mm256_div_pd(                                           \
+          _mm256_sqrt_pd(                                                  \
+              _mm256_add_pd(_mm256_mul_pd(l, l), _mm256_mul_pd(r, r))),    \
+          _mm256_andnot_pd(sign, x));                                      \
+      __m256d real = _mm256_and_pd(_mm256_cmp_pd(ai, zero, _CMP_EQ_OQ),    \
+                                   _mm256_cmp_pd(bi, zero, _CMP_EQ_OQ));   \
+      __m256d ok = _mm256_and_pd(_mm256_cmp_pd(ra, zero, _CMP_EQ_OQ),      \
+                                 _mm256_cmp_pd(rb, zero, _CMP_EQ_OQ));     \
+      ok = _mm256_and_pd(                                                  \
+          ok, _mm256_cmp_pd(_mm256_sub_pd(x, x), zero, _CMP_EQ_OQ));       \
+      ok = _mm256_and_pd(                                                  \
+          ok, _mm256_cmp_pd(_mm256_sub_pd(y, y), zero, _CMP_EQ_OQ));       \
+      ok = _mm256_and_pd(ok,                                               \
+                         _mm256_or_pd(_mm256_cmp_pd(x, zero, _CMP_NEQ_UQ), \
+                                      _mm256_cmp_pd(y, zero, _CMP_NEQ_UQ))); \
+      e = _mm256_and_pd(real, e);                                          \
+      ok = _mm256_or_pd(_mm256_andnot_pd(real, ok),                        \
+                        _mm256_and_pd(real, _mm256_cmp_pd(e, e, _CMP_ORD_Q))); \
+      _mm256_storeu_pd(d.re + i, x);                                       \
+      _mm256_storeu_pd(d.im + i, y);                                       \
+      _mm_storeu_ps(d.rel_err + i, _mm256_cvtpd_ps(e));                    \
+      unsigned m = ~_mm256_movemask_pd(ok) & 0xF;                          \
+      if (m != 0)                                                          \
+        slow_len += lanes_slow(slow, i, m);                                \
+    }                                                                      \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);             \
+  }
+
+LANES_DEFINE_ADD_AVX2(lanes_add, _mm256_add_pd)
+LANES_DEFINE_ADD_AVX2(lanes_sub, _mm256_sub_pd)
+
+#define LANES_DEFINE_MUL_AVX2(name, errors)                                                      \
+  LANES_AVX2 static size_t name##_avx2(Lane_Reg d, Lane_Reg a, Lane_Reg b,                       \
+                                       uint64_t *slow, size_t n) {                               \
+    size_t i = 0, slow_len = 0;                                                                  \
+    for (; i + 4 <= n; i += 4) {                                                                 \
+      __m256d ar = _mm256_loadu_pd(a.re + i), ai = _mm256_loadu_pd(a.im + i);                    \
+      __m256d br = _mm256_loadu_pd(b.re + i), bi = _mm256_loadu_pd(b.im + i);                    \
+      __m256d x = _mm256_sub_pd(_mm256_mul_pd(ar, br), _mm256_mul_pd(ai, bi));                   \
+      __m256d y = _mm256_add_pd(_mm256_mul_pd(ai, br), _mm256_mul_pd(ar, bi));                   \
+      _mm256_storeu_pd(d.re + i, x);                                                             \
+      _mm256_storeu_pd(d.im + i, y);                                                             \
+      if (errors) {                                                                              \
+        __m256d ra = _mm256_cvtps_pd(_mm_loadu_ps(a.rel_err + i));                               \
+        __m256d rb = _mm256_cvtps_pd(_mm_loadu_ps(b.rel_err + i));                               \
+        __m256d r = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(ra, ra), _mm256_mul_pd(rb, rb))); \
+        _mm_storeu_ps(d.rel_err + i, _mm256_cvtpd_ps(r));                                        \
+      } else {                                                                                   \
+        _mm_storeu_ps(d.rel_err + i, _mm_setzero_ps());                                          \
+      }                                                                                          \
+      unsigned m = _mm256_movemask_pd(_mm256_cmp_pd(x, y, _CMP_UNORD_Q));                        \
+      if (m != 0)                                                                                \
+        slow_len += lanes_slow(slow, i, m);                                                      \
+    }                                                                                            \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);                                   \
+  }
+
+LANES_DEFINE_MUL_AVX2(lanes_mul, true)
+LANES_DEFINE_MUL_AVX2(lanes_mul_plain, false)
+
+#define LANES_DEFINE_PLAIN_AVX2(name, op)                                                   \
+  LANES_AVX2 static size_t name##_avx2(Lane_Reg d, Lane_Reg a, Lane_Reg b,                  \
+                                       uint64_t *slow, size_t n) {                          \
+    size_t i = 0;                                                                           \
+    for (; i + 4 <= n; i += 4) {                                                            \
+      _mm256_storeu_pd(d.re + i, op(_mm256_loadu_pd(a.re + i), _mm256_loadu_pd(b.re + i))); \
+      _mm256_storeu_pd(d.im + i, op(_mm256_loadu_pd(a.im + i), _mm256_loadu_pd(b.im + i))); \
+      _mm_storeu_ps(d.rel_err + i, _mm_setzero_ps());                                       \
+    }                                                                                       \
+    return name##_scalar_from(d, a, b, slow, i, n);                                         \
+  }
+
+LANES_DEFINE_PLAIN_AVX2(lanes_add_plain, _mm256_add_pd)
+LANES_DEFINE_PLAIN_AVX2(lanes_sub_plain, _mm256_sub_pd)
+
+LANES_AVX2 static size_t lanes_neg_avx2(Lane_Reg d, Lane_Reg a, Lane_Reg b,
+                                        uint64_t *slow, size_t n) {
+  (void)b, (void)slow;
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(d.re + i, _mm256_xor_pd(_mm256_loadu_pd(a.re + i), sign));
+    _mm256_storeu_pd(d.im + i, _mm256_xor_pd(_mm256_loadu_pd(a.im + i), sign));
+  }
+  memcpy(d.rel_err, a.rel_err, i * sizeof(float));
+
+  return lanes_neg_scalar_from(d, a, i, n);
+}
+
+//=:lanes:avx512
+
+#define LANES_AVX512 __attribute__((target("avx512f")))
+
+#define LANES_DEFINE_ADD_AVX512(name, op)                                   \
+  LANES_AVX512 static size_t name##_avx512(Lane_Reg d, Lane_Reg a,          \
+                                           Lane_Reg b, uint64_t *slow,      \
+                                           size_t n) {                      \
+    const __m512d zero = _mm512_setzero_pd();                               \
+    size_t i = 0, slow_len = 0;                                             \
+    for (; i + 8 <= n; i += 8) {                                            \
+      __m512d ar = _mm512_loadu_pd(a.re + i), ai = _mm512_loadu_pd(a.im + i); \
+      __m512d br = _mm512_loadu_pd(b.re + i), bi = _mm512_loadu_pd(b.im + i); \
+      __m512d x = op(ar, br), y = op(ai, bi);                               \
+      __m512d ra = _mm512_cvtps_pd(_mm256_loadu_ps(a.rel_err + i));         \
+      __m512d rb = _mm512_cvtps_pd(_mm256_loadu_ps(b.rel_err + i));         \
+      __m512d l = _mm512_mul_pd(ra, ar), r = _mm512_mul_pd(rb, br);         \
+      __mmask8 real = _mm512_cmp_pd_mask(ai, zero, _CMP_EQ_OQ) &            \
+                      _mm512_cmp_pd_mask(bi, zero, _CMP_EQ_OQ);             \
+      __m512d e = _mm512_maskz_div_pd(                                      \
+          real,                                                             \
+          _mm512_sqrt_pd(                                                   \
+              _mm512_add_pd(_mm512_mul_pd(l, l), _mm512_mul_pd(r, r))),     \
+          _mm512_abs_pd(x));                                                \
+      __mmask8 ok = _mm512_cmp_pd_mask(ra, zero, _CMP_EQ_OQ) &              \
+                    _mm512_cmp_pd_mask(rb, zero, _CMP_EQ_OQ) &              \
+                    _mm512_cmp_pd_mask(_mm512_sub_pd(x, x), zero,           \
+                                       _CMP_EQ_OQ) &                        \
+                    _mm512_cmp_pd_mask(_mm512_sub_pd(y, y), zero,           \
+                                       _CMP_EQ_OQ) &                        \
+                    (_mm512_cmp_pd_mask(x, zero, _CMP_NEQ_UQ) |             \
+                     _mm512_cmp_pd_mask(y, zero, _CMP_NEQ_UQ));             \
+      ok = (ok & ~real) | (real & _mm512_cmp_pd_mask(e, e, _CMP_ORD_Q));    \
+      _mm512_storeu_pd(d.re + i, x);                                        \
+      _mm512_storeu_pd(d.im + i, y);                                        \
+      _mm256_storeu_ps(d.rel_err + i, _mm512_cvtpd_ps(e));                  \
+      unsigned m = ~ok & 0xFF;                                              \
+      if (m != 0)                                                           \
+        slow_len += lanes_slow(slow, i, m);                                 \
+    }                                                                       \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);              \
+  }
+
+LANES_DEFINE_ADD_AVX512(lanes_add, _mm512_add_pd)
+LANES_DEFINE_ADD_AVX512(lanes_sub, _mm512_sub_pd)
+
+#define LANES_DEFINE_MUL_AVX512(name, errors)                                                    \
+  LANES_AVX512 static size_t name##_avx512(Lane_Reg d, Lane_Reg a, Lane_Reg b,                   \
+                                       uint64_t *slow, size_t n) {                               \
+    size_t i = 0, slow_len = 0;                                                                  \
+    for (; i + 8 <= n; i += 8) {                                                                 \
+      __m512d ar = _mm512_loadu_pd(a.re + i), ai = _mm512_loadu_pd(a.im + i);                    \
+      __m512d br = _mm512_loadu_pd(b.re + i), bi = _mm512_loadu_pd(b.im + i);                    \
+      __m512d x = _mm512_sub_pd(_mm512_mul_pd(ar, br), _mm512_mul_pd(ai, bi));                   \
+      __m512d y = _mm512_add_pd(_mm512_mul_pd(ai, br), _mm512_mul_pd(ar, bi));                   \
+      _mm512_storeu_pd(d.re + i, x);                                                             \
+      _mm512_storeu_pd(d.im + i, y);                                                             \
+      if (errors) {                                                                              \
+        __m512d ra = _mm512_cvtps_pd(_mm256_loadu_ps(a.rel_err + i));                            \
+        __m512d rb = _mm512_cvtps_pd(_mm256_loadu_ps(b.rel_err + i));                            \
+        __m512d r = _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(ra, ra), _mm512_mul_pd(rb, rb))); \
+        _mm256_storeu_ps(d.rel_err + i, _mm512_cvtpd_ps(r));                                     \
+      } else {                                                                                   \
+        _mm256_storeu_ps(d.rel_err + i, _mm256_setzero_ps());                                    \
+      }                                                                                          \
+      unsigned m = _mm512_cmp_pd_mask(x, y, _CMP_UNORD_Q);                                       \
+      if (m != 0)                                                                                \
+        slow_len += lanes_slow(slow, i, m);                                                      \
+    }                                                                                            \
+    return slow_len + name##_scalar_from(d, a, b, slow, i, n);                                   \
+  }
+
+LANES_DEFINE_MUL_AVX512(lanes_mul, true)
+LANES_DEFINE_MUL_AVX512(lanes_mul_plain, false)
+
+#define LANES_DEFINE_PLAIN_AVX512(name, op)                                                 \
+  LANES_AVX512 static size_t name##_avx512(Lane_Reg d, Lane_Reg a, Lane_Reg b,              \
+                                       uint64_t *slow, size_t n) {                          \
+    size_t i = 0;                                                                           \
+    for (; i + 8 <= n; i += 8) {                                                            \
+      _mm512_storeu_pd(d.re + i, op(_mm512_loadu_pd(a.re + i), _mm512_loadu_pd(b.re + i))); \
+      _mm512_storeu_pd(d.im + i, op(_mm512_loadu_pd(a.im + i), _mm512_loadu_pd(b.im + i))); \
+      _mm256_storeu_ps(d.rel_err + i, _mm256_setzero_ps());                                 \
+    }                                                                                       \
+    return name##_scalar_from(d, a, b, slow, i, n);                                         \
+  }
+
+LANES_DEFINE_PLAIN_AVX512(lanes_add_plain, _mm512_add_pd)
+LANES_DEFINE_PLAIN_AVX512(lanes_sub_plain, _mm512_sub_pd)
+
+LANES_AVX512 static size_t lanes_neg_avx512(Lane_Reg d, Lane_Reg a, Lane_Reg b,
+                                            uint64_t *slow, size_t n) {
+  (void)b, (void)slow;
+  const __m512i sign = _mm512_set1_epi64(INT64_MIN);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m512i re = _mm512_loadu_si512(a.re + i);
+    __m512i im = _mm512_loadu_si512(a.im + i);
+    _mm512_storeu_si512(d.re + i, _mm512_xor_si512(re, sign));
+    _mm512_storeu_si512(d.im + i, _mm512_xor_si512(im, sign));
+  }
+  memcpy(d.rel_err, a.rel_err, i * sizeof(float));
+
+  return lanes_neg_scalar_from(d, a, i, n);
+}
+
+#endif
+
+//=:lanes:dispatch
+
+// Lanes_Kernels - lane kernels of arithmetic instructions.
+typedef struct {
+  Lane_Fn add;
+  Lane_Fn sub;
+  Lane_Fn mul;
+  Lane_Fn neg;
+} Lanes_Kernels;
+
+// LANES_KERNELS - initializers of kernels whose names end with is, name of
+// instruction set.
+#define LANES_KERNELS(is)                                           \
+  .errors = {lanes_add_##is, lanes_sub_##is, lanes_mul_##is,        \
+             lanes_neg_##is},                                       \
+  .plain = {lanes_add_plain_##is, lanes_sub_plain_##is,             \
+            lanes_mul_plain_##is, lanes_neg_##is},                  \
+  .isa = #is
+
+static struct {
+  Lanes_Kernels errors; // propagating relative errors to first order
+  Lanes_Kernels plain;  // leaving relative errors zero
+  const char *isa;
+} lanes = {LANES_KERNELS(scalar)};
+
+// lanes_init - selects the widest lane kernels supported by running CPU.
+static inline void lanes_init(void) {
+#ifdef LANES_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f")) {
+    lanes = (typeof(lanes)){LANES_KERNELS(avx512)};
+  } else if (__builtin_cpu_supports("avx2")) {
+    lanes = (typeof(lanes)){LANES_KERNELS(avx2)};
+  } else if (__builtin_cpu_supports("sse2")) {
+    lanes = (typeof(lanes)){LANES_KERNELS(sse2)};
+  }
+#endif
+}
+
+#endif
@@ -31,11 +31,17 @@
 //=:includes
 #include "config.h"
 
+#include "arena.h"
+#include "fpconv.h"
 #include "hmap.h"
+#include "lanes.h"
+#include "scan.h"
 #include "util.h"
+#include "x64.h"
 
 #include <assert.h>
 #include <complex.h>
+#include <errno.h>
 #include <math.h>
 #include <stdbool.h> // IWYU pragma: keep
 #include <stdint.h>
@@ -47,10 +53,21 @@
 #ifdef HAVE_LIBREADLINE
 #include <readline/history.h> // IWYU pragma: keep
 #include <readline/readline.h>
+
+// readline's chardefs.h redefines ESC as a character constant
+#undef ESC
+#define ESC "\x1b"
 #endif
 
 #if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#define HAVE_MMAP
+#define HAVE_THREADS
 #elif defined(_WIN32) || defined(WIN32)
 #include <io.h>
 #define isatty(h) _isatty(h)
@@ -66,9 +83,12 @@ when no command line arguments are passed
 _Static_assert(INTERNAL_READING_BUF_SIZE > 0,
                "INTERNAL_READING_BUF_SIZE must be at least 1");
 
-_Static_assert(NODE_BUF_SIZE > 0, "NODE_BUF_SIZE must be at least 1");
+_Static_assert(NODE_ARENA_RETAIN <= NODE_ARENA_RESERVE,
+               "NODE_ARENA_RETAIN must not exceed NODE_ARENA_RESERVE");
 
-_Static_assert(GLOBAL_SCOPE_CAPACITY >= 4, "not enough capacity for builtins");
+_Static_assert(GLOBAL_SCOPE_CAPACITY >= MAP_GROUP &&
+                   (GLOBAL_SCOPE_CAPACITY & (GLOBAL_SCOPE_CAPACITY - 1)) == 0,
+               "GLOBAL_SCOPE_CAPACITY must be power of 2 of at least MAP_GROUP");
 
 //=:reader:reader
 
@@ -77,6 +97,9 @@ typedef struct {
 
   FILE *src;
 
+  // length of memory-mapped source, 0 when page is not a mapping
+  size_t map_len;
+
   size_t ptr;
   size_t mrk;
   size_t row;
@@ -123,6 +146,24 @@ void rd_next_page(Reader *rd) {
     rd->cch = '\0';
 }
 
+// rd_load - loads current character, reading next page when needed.
+static inline void rd_load(Reader *rd) {
+  if (rd->ptr >= rd->page.len || (rd->src == NULL && !rd->eoi)) {
+    if (rd->eof || (rd->src == NULL && rd->eoi)) {
+      rd->eos = true;
+      rd->cch = '\0';
+      return;
+    }
+    rd_next_page(rd);
+    rd->eoi = true;
+
+    if (rd->eos)
+      return;
+  }
+
+  rd->cch = rd->page.data[rd->ptr];
+}
+
 void rd_next_char(Reader *rd) {
   if (rd->prv) {
     rd->prv = false;
@@ -136,22 +177,161 @@ void rd_next_char(Reader *rd) {
   }
   ++rd->ptr;
 
-  if (rd->ptr >= rd->page.len || (rd->src == NULL && !rd->eoi)) {
-    if (rd->eof || (rd->src == NULL && rd->eoi)) {
-      rd->eos = true;
-      rd->cch = '\0';
+  rd_load(rd);
+}
+
+// rd_advance - moves reader to page.data[ptr], where ptr <= page.len;
+// equivalent to calling rd_next_char until rd->ptr == ptr.
+static inline void rd_advance(Reader *rd, size_t ptr) {
+  const char *p = &rd->page.data[rd->ptr];
+  const char *q = &rd->page.data[ptr];
+  const char *nl = NULL;
+  size_t rows = 0;
+
+  for (const char *c = p; (c = memchr(c, '\n', q - c)) != NULL; ++c) {
+    nl = c;
+    ++rows;
+  }
+
+  if (nl != NULL) {
+    rd->row += rows;
+    rd->col = q - nl - 1;
+  } else {
+    rd->col += q - p;
+  }
+
+  rd->ptr = ptr;
+  rd_load(rd);
+}
+
+// rd_skip_class - skips characters of class cc, scanning whole page runs
+// with scan.
+void rd_skip_class(Reader *rd, Scan_Fn scan, uint8_t cc) {
+  while (!rd->eos && is_class(rd->cch, cc)) {
+    if (rd->prv) {
+      rd->prv = false;
+      continue;
+    }
+
+    const char *p = &rd->page.data[rd->ptr + 1];
+    const char *end = &rd->page.data[rd->page.len];
+
+    if (p < end && is_class(*p, cc))
+      p = scan(p + 1, end);
+
+    rd_advance(rd, p - rd->page.data);
+  }
+}
+
+// rd_open_fd - maps regular files into memory, so they are lexed without
+// copying. Pipes, terminals and empty files fall back to streaming by pages.
+void rd_open_fd(Reader *rd, int fd) {
+  rd->src = NULL;
+  rd->map_len = 0;
+
+#ifdef HAVE_MMAP
+  struct stat st;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map != MAP_FAILED) {
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      madvise(map, st.st_size, MADV_WILLNEED);
+
+      rd->map_len = st.st_size;
+      rd->page.data = map;
+      rd->page.len = rd->page.cap = rd->map_len;
       return;
     }
-    rd_next_page(rd);
-    rd->eoi = true;
   }
+#endif
 
-  rd->cch = rd->page.data[rd->ptr];
+  rd->src = fd == STDIN_FILENO ? stdin : fdopen(fd, "r");
+  if (rd->src == NULL)
+    PFATAL("failed to open file");
+
+  rd->page.cap = INTERNAL_READING_BUF_SIZE;
+  rd->page.data = (char *)malloc(rd->page.cap * sizeof(char));
+  assert(rd->page.data != NULL && "allocation failed");
+}
+
+#ifdef HAVE_MMAP
+
+// rd_map - maps regular file at path into memory read only, setting len to its
+// size. Returns NULL with errno set if it cannot, or if file is empty.
+char *rd_map(const char *path, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return NULL;
+
+  struct stat st;
+  void *map = MAP_FAILED;
+
+  if (fstat(fd, &st) == 0) {
+    errno = S_ISREG(st.st_mode) ? EINVAL : EISDIR;
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  int err = errno;
+  close(fd);
+  errno = err;
+
+  if (map == MAP_FAILED)
+    return NULL;
+
+  *len = st.st_size;
+  return map;
+}
+
+#endif
+
+void rd_open(Reader *rd, const char *path) {
+#ifdef HAVE_MMAP
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    PFATAL("failed to open file");
+
+  rd_open_fd(rd, fd);
+
+  if (rd->src == NULL)
+    close(fd);
+#else
+  rd->map_len = 0;
+  rd->src = fopen(path, "r");
+  if (rd->src == NULL)
+    PFATAL("failed to open file");
+
+  rd->page.cap = INTERNAL_READING_BUF_SIZE;
+  rd->page.data = (char *)malloc(rd->page.cap * sizeof(char));
+  assert(rd->page.data != NULL && "allocation failed");
+#endif
+}
+
+void rd_close(Reader *rd) {
+#ifdef HAVE_MMAP
+  if (rd->map_len != 0) {
+    munmap(rd->page.data, rd->map_len);
+    rd->map_len = 0;
+    rd->page.data = NULL;
+    return;
+  }
+#endif
+
+  if (rd->src == NULL)
+    return;
+
+  free(rd->page.data);
+  rd->page.data = NULL;
+
+  if (rd->src != stdin)
+    fclose(rd->src);
+  rd->src = NULL;
 }
 
 void rd_skip_whitespaces(Reader *rd) {
-  while (is_whitespace(rd->cch))
-    rd_next_char(rd);
+  rd_skip_class(rd, scan.whitespaces, CC_WHITESPACE);
 }
 
 void rd_skip_line(Reader *rd) {
@@ -159,33 +339,149 @@ void rd_skip_line(Reader *rd) {
     rd_next_char(rd);
 }
 
+// rd_next_line - sets line to the next line of rd without line feed.
+// Line points into the page when it fits there, otherwise it is copied to buf.
+// Must not be mixed with rd_next_char on the same reader.
+bool rd_next_line(Reader *rd, String_Buffer *buf, char **line, size_t *len) {
+  buf->len = 0;
+
+  while (true) {
+    char *p = &rd->page.data[rd->ptr];
+    size_t n = rd->ptr < rd->page.len ? rd->page.len - rd->ptr : 0;
+    char *nl = n != 0 ? memchr(p, '\n', n) : NULL;
+    size_t run = nl != NULL ? (size_t)(nl - p) : n;
+
+    rd->ptr += run + (nl != NULL);
+
+    if (nl != NULL && buf->len == 0) {
+      *line = p;
+      *len = run;
+      ++rd->row;
+      return true;
+    }
+
+    if (buf->len + run > buf->cap) {
+      buf->cap = MAX(buf->len + run, buf->cap * 2);
+      buf->data = (char *)realloc(buf->data, buf->cap);
+      assert(buf->data != NULL && "allocation failed");
+    }
+
+    if (run != 0) {
+      memcpy(&buf->data[buf->len], p, run);
+      buf->len += run;
+    }
+
+    if (nl != NULL)
+      break;
+
+    if (rd->src == NULL || rd->eof) {
+      if (buf->len == 0)
+        return false;
+      break;
+    }
+
+    rd->ptr = 0;
+    rd->page.len = fread(rd->page.data, sizeof(char), rd->page.cap, rd->src);
+    if (ferror(rd->src))
+      PFATAL("cannot read file\n");
+
+    rd->eof = rd->page.len < rd->page.cap;
+  }
+
+  *line = buf->data;
+  *len = buf->len;
+  ++rd->row;
+  return true;
+}
+
+static inline size_t rd_count_lines(const char *p, size_t len) {
+  size_t rows = len != 0 && p[len - 1] != '\n';
+  for (const char *end = p + len; (p = memchr(p, '\n', end - p)) != NULL; ++p)
+    ++rows;
+  return rows;
+}
+
+// rd_next_lines - sets lines to the next whole lines of rd, with line feeds,
+// cutting them at the first line feed after size bytes. Lines point
+// into the page when rd has no source, otherwise they are copied to buf.
+// Must not be mixed with rd_next_char on the same reader.
+bool rd_next_lines(Reader *rd, String_Buffer *buf, size_t size, char **lines,
+                   size_t *len) {
+  buf->len = 0;
+
+  while (true) {
+    char *p = &rd->page.data[rd->ptr];
+    size_t n = rd->ptr < rd->page.len ? rd->page.len - rd->ptr : 0;
+    size_t skip = size > buf->len ? size - buf->len : 0;
+    char *nl = n > skip ? memchr(p + skip, '\n', n - skip) : NULL;
+    size_t run = nl != NULL ? (size_t)(nl + 1 - p) : n;
+
+    rd->ptr += run;
+
+    if (rd->src == NULL) {
+      *lines = p;
+      *len = run;
+      rd->row += rd_count_lines(p, run);
+      return run != 0;
+    }
+
+    if (buf->len + run > buf->cap) {
+      buf->cap = MAX(buf->len + run, buf->cap * 2);
+      buf->data = (char *)realloc(buf->data, buf->cap);
+      assert(buf->data != NULL && "allocation failed");
+    }
+
+    if (run != 0) {
+      memcpy(&buf->data[buf->len], p, run);
+      buf->len += run;
+    }
+
+    if (nl != NULL || rd->eof)
+      break;
+
+    rd->ptr = 0;
+    rd->page.len = fread(rd->page.data, sizeof(char), rd->page.cap, rd->src);
+    if (ferror(rd->src))
+      PFATAL("cannot read file\n");
+
+    rd->eof = rd->page.len < rd->page.cap;
+  }
+
+  *lines = buf->data;
+  *len = buf->len;
+  rd->row += rd_count_lines(buf->data, buf->len);
+  return buf->len != 0;
+}
+
 //=:lexer:lexer
 
 typedef struct {
   Reader rd;
 
+  // position of current token's first character
+  size_t row;
+  size_t col;
+
   Token_Type tt;
   float rel_err;
   Primitive pm;
 } Lexer;
 
-double lx_read_integer(Lexer *lx, double *log10, float *rel_err) {
-  long long test_integer = 0;
-  double integer = 0;
-  *log10 = 0;
+// lx_read_digits - pushes run of digits to dec, returns number of digits.
+size_t lx_read_digits(Lexer *lx, Fp_Decimal *dec, bool fraction) {
+  size_t len = 0;
 
   while (is_digit(lx->rd.cch)) {
-    test_integer = test_integer * 10 + lx->rd.cch - '0';
-    integer = integer * 10 + lx->rd.cch - '0';
-    *log10 += 1;
+    const char *p = &lx->rd.page.data[lx->rd.ptr];
+    const char *q = scan.digits(p + 1, &lx->rd.page.data[lx->rd.page.len]);
 
-    rd_next_char(&lx->rd);
-  }
+    fp_decimal_push(dec, p, q, fraction);
+    len += q - p;
 
-  if (rel_err != NULL && integer < ldexp(1, 63) && integer != 0)
-    *rel_err = fabs((((long long)integer) - test_integer) / integer);
+    rd_advance(&lx->rd, q - lx->rd.page.data);
+  }
 
-  return integer;
+  return len;
 }
 
 void lx_next_token_number(Lexer *lx) {
@@ -193,24 +489,41 @@ void lx_next_token_number(Lexer *lx) {
 
   lx->rel_err = 0;
 
-  double decimal, decimal_log10, integer_log10;
-  lx->pm.c = lx_read_integer(lx, &integer_log10, &lx->rel_err);
+  Fp_Decimal dec;
+  fp_decimal_init(&dec);
+
+  size_t integer_len = lx_read_digits(lx, &dec, false);
 
   if (lx->rd.cch == '.') {
     rd_next_char(&lx->rd);
 
-    decimal = lx_read_integer(lx, &decimal_log10, NULL);
-    if (decimal_log10 == 0 && integer_log10 == 0)
+    if (lx_read_digits(lx, &dec, true) == 0 && integer_len == 0)
+      return;
+  }
+
+  if (lx->rd.cch == 'e' || lx->rd.cch == 'E') {
+    rd_next_char(&lx->rd);
+
+    bool neg = lx->rd.cch == '-';
+    if (neg || lx->rd.cch == '+')
+      rd_next_char(&lx->rd);
+
+    if (!is_digit(lx->rd.cch))
       return;
-    lx->pm.c += (double)decimal / pow(10, decimal_log10);
 
-    if (decimal != 0)
-      lx->rel_err += (float)((nextafter(creal(lx->pm.c), INFINITY) - creal(lx->pm.c)) / creal(lx->pm.c));
+    int64_t e = 0;
+    for (; is_digit(lx->rd.cch); rd_next_char(&lx->rd))
+      if (e < FP_EXP_MAX)
+        e = e * 10 + lx->rd.cch - '0';
+
+    fp_decimal_exp(&dec, neg ? -e : e);
   }
 
-  DBG_PRINT("rel_err: %e\n", lx->rel_err);
+  double value = fp_decimal_value(&dec);
+  lx->pm.c = value;
+  lx->rel_err = fp_decimal_rel_err(&dec, value);
 
-  //  lx->rel_err = pow(10, -15);
+  DBG_PRINT("rel_err: %e\n", lx->rel_err);
 
   lx->tt = TT_CMX;
 
@@ -227,15 +540,22 @@ void lx_next_token_symbol(Lexer *lx) {
 
   unsigned bit_off = 0;
 
-  do {
-    lx->pm.s |= (sym_t)encode_symbol_c(lx->rd.cch) << bit_off;
-    bit_off += 6;
-    if (bit_off > SYM_T_BITSIZE) {
-      ERROR("identifier is too long (> %lu)\n", SYM_T_BITSIZE / 6);
-      return;
+  while (is_class(lx->rd.cch, CC_SYMBOL)) {
+    const char *p = &lx->rd.page.data[lx->rd.ptr];
+    const char *q = scan.symbol(p + 1, &lx->rd.page.data[lx->rd.page.len]);
+
+    for (; p < q; ++p) {
+      lx->pm.s |= (sym_t)encode_symbol_c(*p) << bit_off;
+      bit_off += 6;
+      if (bit_off > SYM_T_BITSIZE) {
+        ERROR("identifier is too long (> %lu)\n", SYM_T_BITSIZE / 6);
+        rd_advance(&lx->rd, p - lx->rd.page.data);
+        return;
+      }
     }
-    rd_next_char(&lx->rd);
-  } while (is_letter(lx->rd.cch) || is_digit(lx->rd.cch));
+
+    rd_advance(&lx->rd, q - lx->rd.page.data);
+  }
 
   rd_prev(&lx->rd);
   lx->tt = TT_SYM;
@@ -257,7 +577,7 @@ void lx_next_token_factorial(Lexer *lx, bool whitespace_prefix) {
 
   if (c == 1 && !is_whitespace(lx->rd.cch) && lx->rd.cch != '\0') {
     lx->tt = TT_NOT;
-  } else if (!whitespace_prefix && lx->rd.ptr != 1) {
+  } else if (!whitespace_prefix && (lx->rd.row != 0 || lx->rd.col != 1)) {
     lx->tt = TT_FAC;
   }
 
@@ -286,12 +606,14 @@ void lx_next_token(Lexer *lx) {
   bool whitespace_prefix = is_whitespace(lx->rd.cch);
   rd_skip_whitespaces(&lx->rd);
 
+  lx->row = lx->rd.row;
+  lx->col = lx->rd.col;
   lx->rd.mrk = lx->rd.ptr;
   lx->tt = TT_ILL;
 
   switch (lx->rd.cch) {
-  case '+':  LX_LOOKUP(lx->tt = TT_NOP, LX_TRY_C(TT_ADD, is_whitespace(lx->rd.cch), ) LX_TRY_C(TT_APX, lx->rd.cch == '/', )); break;
-  case '-':  LX_LOOKUP(lx->tt = TT_NEG, LX_TRY_C(TT_SPZ, lx->rd.cch == '>', ) LX_TRY_C(TT_SUB, is_whitespace(lx->rd.cch), )); break;
+  case '+':  LX_LOOKUP(TT_NOP, LX_TRY_C(TT_ADD, is_whitespace(lx->rd.cch), ) LX_TRY_C(TT_APX, lx->rd.cch == '/', )); break;
+  case '-':  LX_LOOKUP(TT_NEG, LX_TRY_C(TT_SPZ, lx->rd.cch == '>', ) LX_TRY_C(TT_SUB, is_whitespace(lx->rd.cch), )); break;
   case '*':  lx->tt = TT_MUL; break;
   case '/':  lx->tt = TT_QUO; break;
   case '%':  lx->tt = TT_MOD; break;
@@ -299,6 +621,7 @@ void lx_next_token(Lexer *lx) {
   case '(':  lx->tt = TT_LP0; break;
   case ')':  lx->tt = TT_RP0; break;
   case ';':  lx->tt = TT_XPC; break;
+  case ',':  lx->tt = TT_ARG; break;
   case '\0': lx->tt = TT_EOS; break;
   case '!':  lx_next_token_factorial(lx, whitespace_prefix); break;
   case '|':  lx->tt = TT_ABS; break;
@@ -318,6 +641,87 @@ void lx_next_token(Lexer *lx) {
   }
 }
 
+//=:lexer:token_buffer
+
+typedef uint32_t Token_Index;
+
+// Token_Buffer - tokens of whole source in struct-of-arrays layout;
+// literals, symbols and factorial counts are stored by payload index.
+typedef struct {
+  int8_t *types;
+  uint32_t *payloads;
+  uint32_t *rows;
+  uint32_t *cols;
+  Token_Index len;
+  Token_Index cap;
+
+  Primitive *pms;
+  float *rel_errs;
+  uint32_t pms_len;
+  uint32_t pms_cap;
+} Token_Buffer;
+
+#define TB_GROW(arr, cap) \
+  (arr = realloc(arr, (cap) * sizeof(*(arr))), assert(arr != NULL && "allocation failed"))
+
+void tb_push(Token_Buffer *tb, Lexer *lx, uint32_t row, uint32_t col) {
+  if (tb->len == tb->cap) {
+    tb->cap = MAX(tb->cap * 2, 256);
+    TB_GROW(tb->types, tb->cap);
+    TB_GROW(tb->payloads, tb->cap);
+    TB_GROW(tb->rows, tb->cap);
+    TB_GROW(tb->cols, tb->cap);
+  }
+
+  tb->types[tb->len] = lx->tt;
+  tb->rows[tb->len] = row;
+  tb->cols[tb->len] = col;
+  tb->payloads[tb->len] = 0;
+
+  switch (lx->tt) {
+  case TT_SYM:
+  case TT_CMX:
+  case TT_FAC:
+  case TT_NOT:
+    if (tb->pms_len == tb->pms_cap) {
+      tb->pms_cap = MAX(tb->pms_cap * 2, 256);
+      TB_GROW(tb->pms, tb->pms_cap);
+      TB_GROW(tb->rel_errs, tb->pms_cap);
+    }
+
+    tb->payloads[tb->len] = tb->pms_len;
+    tb->pms[tb->pms_len] = lx->pm;
+    tb->rel_errs[tb->pms_len] = lx->rel_err;
+    ++tb->pms_len;
+    break;
+  default:
+    break;
+  }
+
+  ++tb->len;
+}
+
+void tb_free(Token_Buffer *tb) {
+  free(tb->types);
+  free(tb->payloads);
+  free(tb->rows);
+  free(tb->cols);
+  free(tb->pms);
+  free(tb->rel_errs);
+  *tb = (Token_Buffer){0};
+}
+
+// lx_tokenize - lexes whole source into tb, up to TT_EOS or first TT_ILL.
+void lx_tokenize(Lexer *lx, Token_Buffer *tb) {
+  tb->len = 0;
+  tb->pms_len = 0;
+
+  do {
+    lx_next_token(lx);
+    tb_push(tb, lx, lx->row, lx->col);
+  } while (lx->tt != TT_EOS && lx->tt != TT_ILL);
+}
+
 //=:parser:nodes
 
 typedef uint32_t Node_Index;
@@ -330,85 +734,295 @@ typedef struct {
   Node_Index lhs, rhs;
 } Bi_Op;
 
+typedef uint32_t Const_Index;
+
+// Node - operator with operand indices, or primitive with index into
+// Const_Pool. Five nodes fit into cache line.
 typedef struct Node {
   Node_Type type : 16;
-  float rel_err;
 
   union {
-    Primitive pm;
+    Const_Index pm;
     Un_Op up;
     Bi_Op bp;
   } as;
 } Node;
 
+_Static_assert(sizeof(Node) == 12, "Node must stay 12 bytes");
+
+// nd_arena_grow - commits room for at least len nodes. Returns new capacity in
+// nodes, or 0 if arena is exhausted.
+static inline Node_Index nd_arena_grow(Arena *a, size_t len) {
+  if (len > UINT32_MAX)
+    return 0;
+
+  return MIN(arena_grow(a, len, sizeof(Node)), UINT32_MAX);
+}
+
+//=:parser:constants
+
+// Const_Pool - deduplicated primitives of parsed expression. Errors are kept
+// apart from values, identical literals and symbols share one entry.
+typedef struct {
+  Primitive *pms;
+  float *rel_errs;
+  Const_Index len;
+  Const_Index cap;
+
+  Const_Index *slots; // open addressing index into pms, CP_SLOT_EMPTY if none
+  Const_Index slots_cap;
+} Const_Pool;
+
+#define CP_SLOT_EMPTY UINT32_MAX
+
+static inline uint64_t cp_hash(Primitive pm, float rel_err) {
+  uint64_t w[2];
+  uint32_t e;
+
+  memcpy(w, &pm, sizeof w);
+  memcpy(&e, &rel_err, sizeof e);
+
+  // murmur3 finalizer, literals often differ only in high bits of exponent
+  uint64_t h = w[0] ^ (w[1] * 0x9E3779B97F4A7C15ull) ^ e;
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  return h ^ (h >> 33);
+}
+
+static inline bool cp_equal(const Const_Pool *cp, Const_Index i, Primitive pm,
+                            float rel_err) {
+  return memcmp(&cp->pms[i], &pm, sizeof pm) == 0 &&
+         memcmp(&cp->rel_errs[i], &rel_err, sizeof rel_err) == 0;
+}
+
+static inline Const_Index *cp_slot(Const_Pool *cp, Primitive pm, float rel_err) {
+  Const_Index mask = cp->slots_cap - 1;
+  Const_Index i = cp_hash(pm, rel_err) & mask;
+
+  while (cp->slots[i] != CP_SLOT_EMPTY && !cp_equal(cp, cp->slots[i], pm, rel_err))
+    i = (i + 1) & mask;
+
+  return &cp->slots[i];
+}
+
+bool cp_grow(Const_Pool *cp) {
+  Const_Index cap = cp->cap == 0 ? 64 : cp->cap * 2;
+
+  Primitive *pms = realloc(cp->pms, cap * sizeof(Primitive));
+  if (pms == NULL)
+    return false;
+  cp->pms = pms;
+
+  float *rel_errs = realloc(cp->rel_errs, cap * sizeof(float));
+  if (rel_errs == NULL)
+    return false;
+  cp->rel_errs = rel_errs;
+
+  // keeps load factor at most 1/2
+  Const_Index *slots = malloc(2 * cap * sizeof(Const_Index));
+  if (slots == NULL)
+    return false;
+
+  free(cp->slots);
+  cp->slots = slots;
+  cp->slots_cap = 2 * cap;
+  cp->cap = cap;
+
+  memset(cp->slots, 0xFF, cp->slots_cap * sizeof(Const_Index));
+  for (Const_Index i = 0; i < cp->len; ++i)
+    *cp_slot(cp, cp->pms[i], cp->rel_errs[i]) = i;
+
+  return true;
+}
+
+// cp_add - sets *idx to index of primitive equal to pm with rel_err, adding it
+// if there is none yet.
+bool cp_add(Const_Pool *cp, Primitive pm, float rel_err, Const_Index *idx) {
+  if (cp->len == cp->cap && !cp_grow(cp))
+    return false;
+
+  Const_Index *slot = cp_slot(cp, pm, rel_err);
+  if (*slot == CP_SLOT_EMPTY) {
+    cp->pms[cp->len] = pm;
+    cp->rel_errs[cp->len] = rel_err;
+    *slot = cp->len++;
+  }
+
+  *idx = *slot;
+  return true;
+}
+
+// cp_reset - empties pool, touching only slots in use. Clears in reversed
+// order of insertion, so probe chains of remaining entries stay intact.
+void cp_reset(Const_Pool *cp) {
+  for (Const_Index i = cp->len; i-- > 0;)
+    *cp_slot(cp, cp->pms[i], cp->rel_errs[i]) = CP_SLOT_EMPTY;
+
+  cp->len = 0;
+}
+
+void cp_free(Const_Pool *cp) {
+  free(cp->pms);
+  free(cp->rel_errs);
+  free(cp->slots);
+  *cp = (Const_Pool){0};
+}
+
+static inline Value cp_value(const Const_Pool *cp, Node nd) {
+  return (Value){
+      .pm = cp->pms[nd.as.pm],
+      .rel_err = cp->rel_errs[nd.as.pm],
+      .type = nd.type,
+  };
+}
+
 typedef struct {
   Node_Index node;
   Node_Index depth;
 } Stack_Emu_El_nd_tree_print;
 
-void nd_tree_print_cmx(cmx_t cmx, float rel_err) {
+enum {
+  // line of result: parts of complex number and its error, escapes between
+  ND_RESULT_MAX = 4 * FP_FORMAT_MAX + 64,
+};
+
+static inline char *nd_put(char *p, const char *s, size_t len) {
+  memcpy(p, s, len);
+  return p + len;
+}
+
+// ND_PUT - appends string literal s to line at p.
+#define ND_PUT(p, s) ((p) = nd_put((p), (s), sizeof(s) - 1))
+
+// ND_PUT_CLR - appends escape clr to line at p if results are colored.
+#define ND_PUT_CLR(p, clr)                                                     \
+  ((p) = stream_colors ? nd_put((p), ("" clr), sizeof("" clr) - 1) : (p))
+
+// nd_format_cmx - writes line of cmx with relative error rel_err to dst, at
+// most ND_RESULT_MAX chars. Returns its length.
+size_t nd_format_cmx(char *dst, cmx_t cmx, float rel_err) {
+  char *p = dst;
+  ND_PUT_CLR(p, CLR_PRIM);
+
   if (creal(cmx) != 0 && cimag(cmx) != 0) {
-    printf(CLR_PRIM "%lf %lfi", creal(cmx), cimag(cmx));
+    p += fp_format(p, creal(cmx));
+    *p++ = ' ';
+    p += fp_format(p, cimag(cmx));
+    *p++ = 'i';
   } else if (creal(cmx) == 0 && cimag(cmx) == 0) {
-    printf(CLR_PRIM "0");
+    *p++ = '0';
   } else if (creal(cmx) != 0) {
-    printf(CLR_PRIM "%lf", creal(cmx));
-  } else if (cimag(cmx) != 0)
-    printf(CLR_PRIM "%lfi", cimag(cmx));
-
-  if (rel_err != 0) {
-    double abs_err = (double)rel_err * fabs(cmx);
-    printf(
-        CLR_RESET " +/- " CLR_PRIM "%f" CLR_RESET
-                  "*" CLR_PRIM "10" CLR_RESET "^" CLR_PRIM "%f\n" CLR_RESET,
-        abs_err / pow(10, floor(log10(abs_err))), floor(log10(abs_err)));
-  } else {
-    printf("\n" CLR_RESET);
+    p += fp_format(p, creal(cmx));
+  } else if (cimag(cmx) != 0) {
+    p += fp_format(p, cimag(cmx));
+    *p++ = 'i';
   }
+
+  ND_PUT_CLR(p, CLR_RESET);
+
+  // unknown or vanishing error is not shown
+  double abs_err = fabs((double)rel_err * fabs(cmx));
+  if (isfinite(abs_err) && abs_err != 0) {
+    int e;
+
+    // significand and exponent come from the same shortest digits
+    ND_PUT(p, " +/- ");
+    ND_PUT_CLR(p, CLR_PRIM);
+    p += fp_format_sci(p, abs_err, &e);
+    ND_PUT_CLR(p, CLR_RESET);
+    *p++ = '*';
+    ND_PUT_CLR(p, CLR_PRIM);
+    ND_PUT(p, "10");
+    ND_PUT_CLR(p, CLR_RESET);
+    *p++ = '^';
+    ND_PUT_CLR(p, CLR_PRIM);
+    p += snprintf(p, 8, "%d", e);
+    ND_PUT_CLR(p, CLR_RESET);
+  }
+
+  *p++ = '\n';
+  return p - dst;
 }
 
-void nd_tree_print_prb(cmx_t cmx) {
+// nd_format_prb - writes line of probability cmx to dst, at most
+// ND_RESULT_MAX chars. Returns its length.
+size_t nd_format_prb(char *dst, cmx_t cmx) {
+  char *p = dst;
+  ND_PUT_CLR(p, CLR_PRIM);
+
   if (creal(cmx) == 0) {
-    printf(CLR_PRIM "false");
+    ND_PUT(p, "false");
   } else if (creal(cmx) == 1) {
-    printf(CLR_PRIM "true");
+    ND_PUT(p, "true");
   } else if (creal(cmx) != 0) {
-    printf(CLR_PRIM "%lf", creal(cmx));
+    p += fp_format(p, creal(cmx));
   }
 
-  printf("\n" CLR_RESET);
+  ND_PUT_CLR(p, CLR_RESET);
+  *p++ = '\n';
+  return p - dst;
 }
 
-void nd_tree_print(Stack_Emu_El_nd_tree_print stack_emu[], Node nodes[static 1],
-                   Node_Index node, Node_Index depth, Node_Index depth_max) {
-  Node_Index len = 1;
+void nd_tree_print_cmx(cmx_t cmx, float rel_err) {
+  char line[ND_RESULT_MAX];
+  fwrite(line, sizeof(char), nd_format_cmx(line, cmx, rel_err), STREAM_OUT);
+}
+
+void nd_tree_print_prb(cmx_t cmx) {
+  char line[ND_RESULT_MAX];
+  fwrite(line, sizeof(char), nd_format_prb(line, cmx), STREAM_OUT);
+}
 
+void nd_tree_print_value(Value v) {
   char dst[48];
   char *ptr;
   int ptr_off;
 
+  switch (v.type) {
+  case NT_PRIM_SYM:
+    ptr = decode_symbol(dst, &dst[sizeof dst - 1], v.pm.s);
+    ptr_off = ptr - dst;
+    stream_printf(STREAM_OUT, CLR_PRIM "%.*s" CLR_RESET " (%llu)\n", ptr_off,
+                  dst, (unsigned long long)v.pm.s);
+    break;
+  case NT_PRIM_CMX: nd_tree_print_cmx(v.pm.c, v.rel_err); break;
+  case NT_PRIM_PRB: nd_tree_print_prb(v.pm.c); break;
+  default:          fprintf(STREAM_OUT, "\n"); break;
+  }
+}
+
+// nd_tree_print_result - prints evaluation result as tree of single node.
+void nd_tree_print_result(Value v, Node_Index depth) {
+  fprintf(STREAM_OUT, "%*s", depth * 2, "");
+#ifndef NDEBUG
+  stream_printf(STREAM_OUT, CLR_INTERNAL "%s" CLR_RESET " (%d) ",
+                nt_stringify(v.type), v.type);
+#endif
+  nd_tree_print_value(v);
+}
+
+void nd_tree_print(Stack_Emu_El_nd_tree_print stack_emu[], Node nodes[static 1],
+                   const Const_Pool *consts, Node_Index node, Node_Index depth,
+                   Node_Index depth_max) {
+  Node_Index len = 1;
+
   Node_Index node_tmp;
 
   do {
     while (depth < depth_max) {
-      printf("%*s", depth * 2, "");
+      fprintf(STREAM_OUT, "%*s", depth * 2, "");
 #ifndef NDEBUG
-      printf(CLR_INTERNAL "%s" CLR_RESET " (%d) ",
-             nt_stringify(nodes[node].type), nodes[node].type);
+      stream_printf(STREAM_OUT, CLR_INTERNAL "%s" CLR_RESET " (%d) ",
+                    nt_stringify(nodes[node].type), nodes[node].type);
 #endif
 
       switch (nodes[node].type) {
       case NT_PRIM_SYM:
-        ptr = decode_symbol(dst, &dst[sizeof dst - 1], nodes[node].as.pm.s);
-        ptr_off = ptr - dst;
-        printf(CLR_PRIM "%.*s" CLR_RESET " (%llu)\n", ptr_off, dst,
-               nodes[node].as.pm.s);
-        goto while2_final;
       case NT_PRIM_CMX:
-        nd_tree_print_cmx(nodes[node].as.pm.c, nodes[node].rel_err);
-        goto while2_final;
       case NT_PRIM_PRB:
-        nd_tree_print_prb(nodes[node].as.pm.c);
+        nd_tree_print_value(cp_value(consts, nodes[node]));
         goto while2_final;
       case NT_BIOP_LET:
       case NT_BIOP_GRE:
@@ -425,10 +1039,11 @@ void nd_tree_print(Stack_Emu_El_nd_tree_print stack_emu[], Node nodes[static 1],
       case NT_BIOP_MOD:
       case NT_BIOP_POW:
       case NT_BIOP_XPC:
+      case NT_BIOP_ARG:
       case NT_BIOP_SPZ:
       case NT_BIOP_FAC:
       case NT_CALL:
-        printf("\n");
+        fprintf(STREAM_OUT, "\n");
         node_tmp = node;
         node = nodes[node_tmp].as.bp.lhs;
         ++depth;
@@ -440,14 +1055,14 @@ void nd_tree_print(Stack_Emu_El_nd_tree_print stack_emu[], Node nodes[static 1],
       case NT_UNOP_NOT:
       case NT_UNOP_NEG:
       case NT_UNOP_NOP:
-        printf("\n");
+        fprintf(STREAM_OUT, "\n");
         node = nodes[node].as.up.nhs;
         ++depth;
         continue;
       }
     }
 
-    printf("%*s...\n", depth * 2, "");
+    fprintf(STREAM_OUT, "%*s...\n", depth * 2, "");
 
   while2_final:
     --len;
@@ -456,52 +1071,55 @@ void nd_tree_print(Stack_Emu_El_nd_tree_print stack_emu[], Node nodes[static 1],
   } while (len != 0);
 }
 
-#define nd_tree_print(nodes, node, depth, depth_max)             \
-  {                                                              \
-    Stack_Emu_El_nd_tree_print stack_emu[depth_max - depth + 1]; \
-    nd_tree_print(stack_emu, nodes, node, depth, depth_max);     \
+#define nd_tree_print(nodes, consts, node, depth, depth_max)         \
+  {                                                                  \
+    Stack_Emu_El_nd_tree_print stack_emu[depth_max - depth + 1];     \
+    nd_tree_print(stack_emu, nodes, consts, node, depth, depth_max); \
   }
 
 //=:parser:priorities
 
 typedef enum {
-  PT_SKIP_RP0,
+  PT_NONE,
   PT_XPC,
-  PT_LET0,
-  PT_LET1,
+  PT_ARG,
+  PT_LET,
+  PT_SPZ,
   PT_TEST,
-  PT_SPZ0,
-  PT_SPZ1,
   PT_ADD_SUB,
   PT_MUL_QUO_MOD,
   PT_NOT_NOP_NEG,
-  PT_POW0,
-  PT_POW1,
+  PT_POW,
   PT_FAC,
   PT_CAL_APX,
   PT_PRIM,
 } Priority;
 
-bool pt_includes_tt(Priority pt, Token_Type tt) {
-  switch (pt) {
-  case PT_XPC:         return tt == TT_XPC;
-  case PT_LET0:        return tt == TT_LET;
-  case PT_SPZ0:        return tt == TT_SPZ;
-  case PT_TEST:        return tt == TT_GRE || tt == TT_LES || tt == TT_GEQ || tt == TT_LEQ || tt == TT_EQU || tt == TT_NEQ;
-  case PT_ADD_SUB:     return tt == TT_ADD || tt == TT_NOP || tt == TT_SUB || tt == TT_NEG;
-  case PT_MUL_QUO_MOD: return tt == TT_MUL || tt == TT_QUO || tt == TT_MOD;
-  case PT_NOT_NOP_NEG: return tt == TT_NOT || tt == TT_NEG || tt == TT_NOP;
-  case PT_POW0:        return tt == TT_POW;
-  case PT_FAC:         return tt == TT_NOT || tt == TT_FAC;
-  case PT_CAL_APX:     return tt == TT_LP0 || tt == TT_APX;
-  default:
-    DBG_FATAL("%s: unknown priority: %d\n", __func__, pt);
-    return false;
-  }
+// PT_OF_TT - priority of token in infix or postfix position, PT_NONE if token
+// does not continue expression. Indexed by tt - TT_ILL.
+static const uint8_t PT_OF_TT[] = {
+    [TT_XPC - TT_ILL] = PT_XPC,         [TT_ARG - TT_ILL] = PT_ARG,
+    [TT_LET - TT_ILL] = PT_LET,         [TT_SPZ - TT_ILL] = PT_SPZ,
+    [TT_GRE - TT_ILL] = PT_TEST,        [TT_LES - TT_ILL] = PT_TEST,
+    [TT_GEQ - TT_ILL] = PT_TEST,        [TT_LEQ - TT_ILL] = PT_TEST,
+    [TT_EQU - TT_ILL] = PT_TEST,        [TT_NEQ - TT_ILL] = PT_TEST,
+    [TT_ADD - TT_ILL] = PT_ADD_SUB,     [TT_SUB - TT_ILL] = PT_ADD_SUB,
+    [TT_NOP - TT_ILL] = PT_ADD_SUB,     [TT_NEG - TT_ILL] = PT_ADD_SUB,
+    [TT_MUL - TT_ILL] = PT_MUL_QUO_MOD, [TT_QUO - TT_ILL] = PT_MUL_QUO_MOD,
+    [TT_MOD - TT_ILL] = PT_MUL_QUO_MOD, [TT_POW - TT_ILL] = PT_POW,
+    [TT_NOT - TT_ILL] = PT_FAC,         [TT_FAC - TT_ILL] = PT_FAC,
+    [TT_LP0 - TT_ILL] = PT_CAL_APX,     [TT_APX - TT_ILL] = PT_CAL_APX,
+    [TT_ABS - TT_ILL] = PT_NONE,
+};
+
+static inline Priority pt_of_tt(Token_Type tt) { return PT_OF_TT[tt - TT_ILL]; }
+
+static inline bool pt_unop_tt(Token_Type tt) {
+  return tt == TT_NOT || tt == TT_NEG || tt == TT_NOP;
 }
 
 bool pt_rl_biop(Priority pt) {
-  return pt == PT_LET0 || pt == PT_SPZ0 || pt == PT_POW0;
+  return pt == PT_LET || pt == PT_SPZ || pt == PT_POW;
 }
 
 //=:parser:errors
@@ -513,6 +1131,8 @@ typedef enum {
   PR_ERR_PAREN_NOT_CLOSED,
   PR_ERR_TOKEN_UNEXPECTED,
   PR_ERR_MEMORY_NOT_ENOUGH,
+  PR_ERR_ARGS_OUTSIDE_CALL,
+  PR_ERR_PARAM_DUPLICATED,
 } PR_ERR;
 
 const char *pr_err_stringify(PR_ERR pr_err) {
@@ -523,6 +1143,8 @@ const char *pr_err_stringify(PR_ERR pr_err) {
     STRINGIFY_CASE(PR_ERR_PAREN_NOT_CLOSED)
     STRINGIFY_CASE(PR_ERR_TOKEN_UNEXPECTED)
     STRINGIFY_CASE(PR_ERR_MEMORY_NOT_ENOUGH)
+    STRINGIFY_CASE(PR_ERR_ARGS_OUTSIDE_CALL)
+    STRINGIFY_CASE(PR_ERR_PARAM_DUPLICATED)
   }
 
   return STRINGIFY(INVALID_PR_ERR);
@@ -535,189 +1157,463 @@ typedef struct {
   Node_Index upper;
 } Node_Bound;
 
+// Parser_Frame - operand being parsed on explicit parser stack.
+typedef struct {
+  Node_Index lhs;       // operand slot, then operand parsed so far
+  Node_Index bound_low; // first node of operand
+  uint8_t pt_min;       // lowest priority of operators applied to operand
+  uint8_t pt_last;      // priority of last applied operator
+  uint8_t unop;         // whether operand may start with unary operator
+  uint8_t cont;         // Parser_Cont waiting for result of upper frame
+  int8_t op_tt;         // pending binary operator of PR_CONT_BIOP
+} Parser_Frame;
+
+typedef enum {
+  PR_CONT_NONE,
+  PR_CONT_UNOP,
+  PR_CONT_BIOP,
+  PR_CONT_ABS,
+  PR_CONT_LP0,
+} Parser_Cont;
+
 typedef struct {
   Lexer lx;
 
+  Token_Buffer tb;
+  Token_Index tk;
+
+  Parser_Frame *frames;
+  uint32_t frames_len;
+  uint32_t frames_cap;
+
   ssize_t p0c;
   bool abs;
 
   Node_Bound *nodes_obj;
   Node_Index nodes_obj_len;
   Node_Index nodes_obj_cap;
+  Const_Pool consts;
+
+  Arena nodes_arena;
   Node_Index nodes_len;
   Node_Index nodes_cap;
-  Node nodes[];
+  Node *nodes;
 } Parser;
 
-PR_ERR pr_nd_alloc(Parser *pr, Node_Index ptr[static 1]) {
-  if (pr->nodes_len + 1 >= pr->nodes_cap)
-    return PR_ERR_MEMORY_NOT_ENOUGH;
+static inline Token_Type pr_tt(const Parser *pr) { return pr->tb.types[pr->tk]; }
 
-  ptr[0] = pr->nodes_len;
-  ++pr->nodes_len;
-  return PR_ERR_NOERROR;
-}
+static inline Primitive pr_pm(const Parser *pr) { return pr->tb.pms[pr->tb.payloads[pr->tk]]; }
 
-PR_ERR pr_nd_obj_bound_add(Parser *pr, Node_Index l, Node_Index u) {
-  if (pr->nodes_obj_len + 1 >= pr->nodes_obj_cap)
-    return PR_ERR_MEMORY_NOT_ENOUGH;
+static inline float pr_rel_err(const Parser *pr) { return pr->tb.rel_errs[pr->tb.payloads[pr->tk]]; }
 
-  pr->nodes_obj[pr->nodes_obj_len] = (Node_Bound){l, u};
-  ++pr->nodes_obj_len;
-  return PR_ERR_NOERROR;
-}
+static inline uint32_t pr_row(const Parser *pr) { return pr->tb.rows[pr->tk]; }
 
-PR_ERR pr_call(Parser *pr, Node_Index *node, Priority pt);
+static inline uint32_t pr_col(const Parser *pr) { return pr->tb.cols[pr->tk]; }
 
-PR_ERR pr_next_prim_node(Parser *pr, Node_Index *node, Priority pt) {
-  switch (pr->lx.tt) {
-  case TT_SYM:
-    pr->nodes[*node].type = NT_PRIM_SYM;
-    pr->nodes[*node].as.pm.s = pr->lx.pm.s;
-    lx_next_token(&pr->lx);
-    break;
-  case TT_CMX:
-    pr->nodes[*node].type = NT_PRIM_CMX;
-    pr->nodes[*node].as.pm.c = pr->lx.pm.c;
-    pr->nodes[*node].rel_err = pr->lx.rel_err;
-    lx_next_token(&pr->lx);
-    break;
-  case TT_ABS:
-    if (pr->abs)
-      return PR_ERR_TOKEN_UNEXPECTED;
-    pr->abs = true;
-    pr->nodes[*node].type = NT_UNOP_ABS;
-    TRY(PR_ERR, pr_nd_alloc(pr, &pr->nodes[*node].as.up.nhs));
-    lx_next_token(&pr->lx);
-    return pr_call(pr, &pr->nodes[*node].as.up.nhs, pt);
-  case TT_LP0:
-    ++pr->p0c;
-    lx_next_token(&pr->lx);
-    return pr_call(pr, node, pt);
-  default:
-    return PR_ERR_TOKEN_UNEXPECTED;
+static inline void pr_next_token(Parser *pr) {
+  if (pr->tk + 1 < pr->tb.len)
+    ++pr->tk;
+}
+
+// pr_args - whether node is list of arguments, which only call takes.
+static inline bool pr_args(const Parser *pr, Node_Index node) {
+  return pr->nodes[node].type == NT_BIOP_ARG;
+}
+
+// pr_unop_sink - moves unary operator at node down to first operand of
+// arithmetic and comparisons under it, so it applies to first leaf of its
+// operand, as in -(1+2) = 1 and -2^2 = 4. Calls, lists, assignments and
+// sequences are operands of their own. Nodes are swapped in place.
+static void pr_unop_sink(Parser *pr, Node_Index node) {
+  for (;;) {
+    Node_Index sub = pr->nodes[node].as.up.nhs;
+    Node nd = pr->nodes[sub];
+
+    switch (nd.type) {
+    case NT_BIOP_GRE:
+    case NT_BIOP_LES:
+    case NT_BIOP_GEQ:
+    case NT_BIOP_LEQ:
+    case NT_BIOP_EQU:
+    case NT_BIOP_NEQ:
+    case NT_BIOP_ADD:
+    case NT_BIOP_SUB:
+    case NT_BIOP_APX:
+    case NT_BIOP_MUL:
+    case NT_BIOP_QUO:
+    case NT_BIOP_MOD:
+    case NT_BIOP_POW:
+    case NT_BIOP_FAC:
+      break;
+    default:
+      return;
+    }
+
+    pr->nodes[sub].type = pr->nodes[node].type;
+    pr->nodes[sub].as.up.nhs = nd.as.bp.lhs;
+    pr->nodes[node] = nd;
+    pr->nodes[node].as.bp.lhs = sub;
+    node = sub;
+  }
+}
+
+// pr_params_unique - whether symbols among arguments of call, head of function
+// definition, differ, so that each of them names parameter of its own.
+// Arguments are joined from the left.
+static bool pr_params_unique(const Parser *pr, Node_Index call) {
+  for (Node_Index i = pr->nodes[call].as.bp.rhs;; i = pr->nodes[i].as.bp.lhs) {
+    Node_Index a = pr_args(pr, i) ? pr->nodes[i].as.bp.rhs : i;
+
+    for (Node_Index j = i; pr_args(pr, j) && pr->nodes[a].type == NT_PRIM_SYM;) {
+      j = pr->nodes[j].as.bp.lhs;
+      Node_Index b = pr_args(pr, j) ? pr->nodes[j].as.bp.rhs : j;
+
+      if (pr->nodes[b].type == NT_PRIM_SYM &&
+          pr->consts.pms[pr->nodes[b].as.pm].s ==
+              pr->consts.pms[pr->nodes[a].as.pm].s)
+        return false;
+    }
+
+    if (!pr_args(pr, i))
+      return true;
   }
+}
+
+PR_ERR pr_nd_alloc(Parser *pr, Node_Index ptr[static 1]) {
+  if (pr->nodes_len + 1 >= pr->nodes_cap) {
+    Node_Index cap = nd_arena_grow(&pr->nodes_arena, (size_t)pr->nodes_len + 2);
+    if (cap == 0)
+      return PR_ERR_MEMORY_NOT_ENOUGH;
+
+    pr->nodes_cap = cap;
+  }
+
+  ptr[0] = pr->nodes_len;
+  ++pr->nodes_len;
+  return PR_ERR_NOERROR;
+}
+
+PR_ERR pr_const_add(Parser *pr, Primitive pm, float rel_err, Const_Index *idx) {
+  if (!cp_add(&pr->consts, pm, rel_err, idx))
+    return PR_ERR_MEMORY_NOT_ENOUGH;
 
   return PR_ERR_NOERROR;
 }
 
-PR_ERR pr_next_unop_node(Parser *pr, Node_Index *node, Priority pt) {
-  if (pt_includes_tt(pt, pr->lx.tt)) {
-    pr->nodes[*node].type = NT_UNOP_NOT * (pr->lx.tt == TT_NOT) +
-                            NT_UNOP_NEG * (pr->lx.tt == TT_NEG) +
-                            NT_UNOP_NOP * (pr->lx.tt == TT_NOP);
+PR_ERR pr_nd_obj_bound_add(Parser *pr, Node_Index l, Node_Index u) {
+  if (pr->nodes_obj_len + 1 >= pr->nodes_obj_cap)
+    return PR_ERR_MEMORY_NOT_ENOUGH;
 
-    TRY(PR_ERR, pr_nd_alloc(pr, &pr->nodes[*node].as.up.nhs));
+  pr->nodes_obj[pr->nodes_obj_len] = (Node_Bound){l, u};
+  ++pr->nodes_obj_len;
+  return PR_ERR_NOERROR;
+}
 
-    lx_next_token(&pr->lx);
+PR_ERR pr_frame_push(Parser *pr, Node_Index slot, Priority pt_min, bool unop) {
+  if (pr->frames_len == pr->frames_cap) {
+    uint32_t cap = pr->frames_cap == 0 ? 64 : pr->frames_cap * 2;
+    Parser_Frame *frames = realloc(pr->frames, cap * sizeof(Parser_Frame));
+    if (frames == NULL)
+      return PR_ERR_MEMORY_NOT_ENOUGH;
 
-    node = &pr->nodes[*node].as.up.nhs;
+    pr->frames = frames;
+    pr->frames_cap = cap;
   }
 
-  return pr_call(pr, node, pt);
+  pr->frames[pr->frames_len++] = (Parser_Frame){
+      .lhs = slot,
+      .bound_low = pr->nodes_len - 1,
+      .pt_min = pt_min,
+      .pt_last = PT_PRIM,
+      .unop = unop,
+      .cont = PR_CONT_NONE,
+  };
+  return PR_ERR_NOERROR;
 }
 
-PR_ERR pr_next_biop_node(Parser *pr, Node_Index *lhs, Priority pt) {
-  Node_Index bound_low = pr->nodes_len - 1;
+// pr_next_operand - parses prefix operator or primary of top frame. Sets *done
+// if primary is complete, otherwise frame for its content was pushed.
+PR_ERR pr_next_operand(Parser *pr, bool *done) {
+  Parser_Frame *f = &pr->frames[pr->frames_len - 1];
+  Node_Index slot = f->lhs;
+  Token_Type tt = pr_tt(pr);
+  Primitive pm;
 
-  TRY(PR_ERR, pr_call(pr, lhs, pt));
+  *done = false;
 
-  Node_Index op, rhs;
-  Token_Type op_tt;
+  if (f->unop && pt_unop_tt(tt)) {
+    pr->nodes[slot].type = NT_UNOP_NOT * (tt == TT_NOT) +
+                           NT_UNOP_NEG * (tt == TT_NEG) +
+                           NT_UNOP_NOP * (tt == TT_NOP);
+    TRY(PR_ERR, pr_nd_alloc(pr, &pr->nodes[slot].as.up.nhs));
+    pr_next_token(pr);
 
-  while (pt_includes_tt(pt, pr->lx.tt)) {
-    op_tt = pr->lx.tt;
-    TRY(PR_ERR, pr_nd_alloc(pr, &rhs));
+    f->cont = PR_CONT_UNOP;
+    return pr_frame_push(pr, pr->nodes[slot].as.up.nhs, PT_POW, false);
+  }
 
-    if (pr->lx.tt != TT_LP0)
-      lx_next_token(&pr->lx);
-    TRY(PR_ERR, pr_call(pr, &rhs, pt + pt_rl_biop(pt)));
+  switch (tt) {
+  case TT_SYM:
+    // symbol with zeroed padding, so equal symbols are deduplicated
+    pm.c = 0;
+    pm.s = pr_pm(pr).s;
 
-    TRY(PR_ERR, pr_nd_alloc(pr, &op));
-    pr->nodes[op].type = tt_to_biop_nd(op_tt);
-    pr->nodes[op].as.bp.lhs = *lhs;
-    pr->nodes[op].as.bp.rhs = rhs;
+    pr->nodes[slot].type = NT_PRIM_SYM;
+    TRY(PR_ERR, pr_const_add(pr, pm, 0, &pr->nodes[slot].as.pm));
+    pr_next_token(pr);
+    break;
+  case TT_CMX:
+    pr->nodes[slot].type = NT_PRIM_CMX;
+    TRY(PR_ERR, pr_const_add(pr, pr_pm(pr), pr_rel_err(pr),
+                             &pr->nodes[slot].as.pm));
+    pr_next_token(pr);
+    break;
+  case TT_ABS:
+    if (pr->abs)
+      return PR_ERR_TOKEN_UNEXPECTED;
+    pr->abs = true;
+    pr->nodes[slot].type = NT_UNOP_ABS;
+    TRY(PR_ERR, pr_nd_alloc(pr, &pr->nodes[slot].as.up.nhs));
+    pr_next_token(pr);
 
-    if (pr->nodes[op].type == TT_SPZ)
-      pr_nd_obj_bound_add(pr, bound_low, pr->nodes_len);
+    f->cont = PR_CONT_ABS;
+    return pr_frame_push(pr, pr->nodes[slot].as.up.nhs, PT_XPC, true);
+  case TT_LP0:
+    ++pr->p0c;
+    pr_next_token(pr);
 
-    *lhs = op;
+    f->cont = PR_CONT_LP0;
+    return pr_frame_push(pr, slot, PT_XPC, true);
+  default:
+    return PR_ERR_TOKEN_UNEXPECTED;
   }
 
+  *done = true;
   return PR_ERR_NOERROR;
 }
 
-PR_ERR pr_next_biop_fact_node(Parser *pr, Node_Index *lhs, Priority pt) {
-  TRY(PR_ERR, pr_call(pr, lhs, pt));
+// pr_next_operator - applies postfix operator to top frame or pushes frame for
+// rhs of infix one. Sets *done if operand of top frame is complete.
+PR_ERR pr_next_operator(Parser *pr, bool *done) {
+  Parser_Frame *f = &pr->frames[pr->frames_len - 1];
+  Token_Type tt = pr_tt(pr);
+  Priority pt = pt_of_tt(tt);
+
+  *done = pt < f->pt_min || pt > f->pt_last ||
+          (pt == PT_FAC && f->pt_last == PT_FAC);
+  if (*done)
+    return PR_ERR_NOERROR;
 
   Node_Index op, rhs;
 
-  if (pt_includes_tt(pt, pr->lx.tt)) {
-    TRY(PR_ERR, pr_nd_alloc(pr, &rhs));
+  TRY(PR_ERR, pr_nd_alloc(pr, &rhs));
+
+  if (pt == PT_FAC) {
+    if (pr_args(pr, f->lhs))
+      return PR_ERR_ARGS_OUTSIDE_CALL;
+
     TRY(PR_ERR, pr_nd_alloc(pr, &op));
 
     pr->nodes[op].type = NT_BIOP_FAC;
-    pr->nodes[op].as.bp.lhs = *lhs;
+    pr->nodes[op].as.bp.lhs = f->lhs;
     pr->nodes[op].as.bp.rhs = rhs;
     pr->nodes[rhs].type = NT_PRIM_CMX;
-    pr->nodes[rhs].as.pm.c = pr->lx.pm.c;
-    pr->nodes[rhs].rel_err = 0;
+    TRY(PR_ERR, pr_const_add(pr, pr_pm(pr), 0, &pr->nodes[rhs].as.pm));
 
-    lx_next_token(&pr->lx);
+    pr_next_token(pr);
 
-    *lhs = op;
+    f->lhs = op;
+    f->pt_last = PT_FAC;
+    return PR_ERR_NOERROR;
   }
 
-  return PR_ERR_NOERROR;
+  if (tt != TT_LP0)
+    pr_next_token(pr);
+
+  f->cont = PR_CONT_BIOP;
+  f->op_tt = tt;
+  return pr_frame_push(pr, rhs, pt + !pt_rl_biop(pt), pt != PT_CAL_APX);
 }
 
-PR_ERR pr_skip_rp0(Parser *pr, Node_Index *node, Priority pt) {
-  TRY(PR_ERR, pr_call(pr, node, pt));
+// pr_reduce - passes complete operand of top frame to frame below it.
+PR_ERR pr_reduce(Parser *pr) {
+  Node_Index res = pr->frames[--pr->frames_len].lhs;
+  Parser_Frame *f = &pr->frames[pr->frames_len - 1];
+  Node_Index op;
+  Node_Type nt;
+
+  switch (f->cont) {
+  case PR_CONT_UNOP:
+    if (pr_args(pr, res))
+      return PR_ERR_ARGS_OUTSIDE_CALL;
+
+    pr->nodes[f->lhs].as.up.nhs = res;
+    pr_unop_sink(pr, f->lhs);
+    f->pt_last = PT_MUL_QUO_MOD;
+    break;
+  case PR_CONT_BIOP:
+    // lists of arguments are joined by commas and passed to calls only
+    nt = tt_to_biop_nd(f->op_tt);
+    if ((pr_args(pr, f->lhs) && nt != NT_BIOP_ARG) ||
+        (pr_args(pr, res) && nt != NT_BIOP_ARG && nt != NT_CALL))
+      return PR_ERR_ARGS_OUTSIDE_CALL;
+
+    // head of definition is call, guarded or not
+    if (nt == NT_BIOP_LET) {
+      Node_Index call = f->lhs;
+      if (pr->nodes[call].type == NT_BIOP_SPZ)
+        call = pr->nodes[call].as.bp.lhs;
+      if (pr->nodes[call].type == NT_CALL && !pr_params_unique(pr, call))
+        return PR_ERR_PARAM_DUPLICATED;
+    }
+
+    TRY(PR_ERR, pr_nd_alloc(pr, &op));
+    pr->nodes[op].type = nt;
+    pr->nodes[op].as.bp.lhs = f->lhs;
+    pr->nodes[op].as.bp.rhs = res;
+
+    if (pr->nodes[op].type == NT_BIOP_SPZ)
+      pr_nd_obj_bound_add(pr, f->bound_low, pr->nodes_len);
+
+    f->lhs = op;
+    f->pt_last = pt_of_tt(f->op_tt);
+    break;
+  case PR_CONT_ABS:
+  case PR_CONT_LP0:
+    if (f->cont == PR_CONT_ABS && pr_args(pr, res))
+      return PR_ERR_ARGS_OUTSIDE_CALL;
+
+    if (f->cont == PR_CONT_ABS) {
+      pr->nodes[f->lhs].as.up.nhs = res;
+      pr_unop_sink(pr, f->lhs);
+    } else {
+      f->lhs = res;
+    }
 
-  if (pr->lx.tt == TT_RP0) {
-    if (--pr->p0c < 0)
-      return PR_ERR_PAREN_NOT_OPENED;
+    if (pr_tt(pr) == TT_RP0) {
+      if (--pr->p0c < 0)
+        return PR_ERR_PAREN_NOT_OPENED;
+
+      pr_next_token(pr);
+    } else if (pr_tt(pr) == TT_ABS) {
+      pr->abs = false;
+      pr_next_token(pr);
+    }
 
-    lx_next_token(&pr->lx);
-  } else if (pr->lx.tt == TT_ABS) {
-    pr->abs = false;
-    lx_next_token(&pr->lx);
+    f->pt_last = PT_PRIM;
+    break;
+  default:
+    DBG_FATAL("%s: unknown continuation: %d\n", __func__, f->cont);
   }
 
+  f->cont = PR_CONT_NONE;
   return PR_ERR_NOERROR;
 }
 
+// pr_next_node - parses whole expression into node with operator precedence
+// climbing on explicit stack of Parser_Frame.
 PR_ERR pr_next_node(Parser *pr, Node_Index *node) {
-  lx_next_token(&pr->lx);
-  TRY(PR_ERR, pr_call(pr, node, 0));
+  lx_tokenize(&pr->lx, &pr->tb);
+  pr->tk = 0;
+  pr->frames_len = 0;
+
+  TRY(PR_ERR, pr_frame_push(pr, *node, PT_XPC, true));
+
+  uint32_t frames_len;
+  bool done;
+
+operand:
+  TRY(PR_ERR, pr_next_operand(pr, &done));
+  if (!done)
+    goto operand;
+
+operator:
+  frames_len = pr->frames_len;
+  TRY(PR_ERR, pr_next_operator(pr, &done));
+  if (!done) {
+    if (pr->frames_len == frames_len)
+      goto operator;
+    goto operand;
+  }
+
+  if (pr->frames_len > 1) {
+    TRY(PR_ERR, pr_reduce(pr));
+    goto operator;
+  }
+
+  *node = pr->frames[0].lhs;
 
   if (pr->p0c != 0)
     return PR_ERR_PAREN_NOT_CLOSED;
+  if (pr_args(pr, *node))
+    return PR_ERR_ARGS_OUTSIDE_CALL;
 
   return PR_ERR_NOERROR;
 }
 
-PR_ERR pr_call(Parser *pr, Node_Index *node, Priority pt) {
-  switch (pt) {
-  case PT_SKIP_RP0:    return pr_next_biop_node(pr, node, PT_XPC);
-  case PT_XPC:         return pr_next_biop_node(pr, node, PT_LET0);
-  case PT_LET0:        return pr_next_biop_node(pr, node, PT_SPZ0);
-  case PT_LET1:        return pr_next_biop_node(pr, node, PT_LET0);
-  case PT_SPZ0:        return pr_next_biop_node(pr, node, PT_TEST);
-  case PT_SPZ1:        return pr_next_biop_node(pr, node, PT_SPZ0);
-  case PT_TEST:        return pr_next_biop_node(pr, node, PT_ADD_SUB);
-  case PT_ADD_SUB:     return pr_next_biop_node(pr, node, PT_MUL_QUO_MOD);
-  case PT_MUL_QUO_MOD: return pr_next_unop_node(pr, node, PT_NOT_NOP_NEG);
-  case PT_NOT_NOP_NEG: return pr_next_biop_node(pr, node, PT_POW0);
-  case PT_POW0:        return pr_next_biop_fact_node(pr, node, PT_FAC);
-  case PT_POW1:        return pr_next_unop_node(pr, node, PT_NOT_NOP_NEG);
-  case PT_FAC:         return pr_next_biop_node(pr, node, PT_CAL_APX);
-  case PT_CAL_APX:     return pr_next_prim_node(pr, node, PT_PRIM);
-  case PT_PRIM:        return pr_skip_rp0(pr, node, PT_SKIP_RP0);
-  }
-
-  DBG_FATAL("%s: unknown priority: %d\n", __func__, pt);
-  return false;
+// pr_reset - prepares parser for next expression, releasing memory of big
+// previous one.
+void pr_reset(Parser *pr) {
+  pr->p0c = 0;
+  pr->abs = false;
+  pr->nodes_len = 1;
+
+  cp_reset(&pr->consts);
+  arena_reset(&pr->nodes_arena, NODE_ARENA_RETAIN);
+  pr->nodes_cap = MIN(pr->nodes_arena.committed / sizeof(Node), UINT32_MAX);
+}
+
+// pr_reset_line - prepares parser for expression of line of len bytes.
+void pr_reset_line(Parser *pr, char *line, size_t len) {
+  Reader *rd = &pr->lx.rd;
+
+  rd->src = NULL;
+  rd->page.data = line;
+  rd->page.len = rd->page.cap = len;
+  rd_reset_counters(rd);
+
+  pr_reset(pr);
+}
+
+Parser *pr_new(void) {
+  Parser *pr = malloc(sizeof(Parser));
+  assert(pr != NULL && "allocation failed");
+
+  *pr = ((Parser){
+      .lx.rd =
+          {
+              .src = NULL,
+              .page =
+                  {
+                      .data = NULL,
+                      .len = 0,
+                      .cap = 0,
+                  },
+          },
+      .p0c = 0,
+      .abs = false,
+      .nodes_len = 1,
+      .nodes_cap = 0,
+  });
+
+  if (!arena_init(&pr->nodes_arena, NODE_ARENA_RESERVE, NODE_ARENA_HUGEPAGES))
+    FATAL("cannot reserve memory for nodes\n");
+  pr->nodes = (Node *)pr->nodes_arena.base;
+
+  // source node is always first
+  pr->nodes_cap = nd_arena_grow(&pr->nodes_arena, 2);
+  if (pr->nodes_cap == 0)
+    FATAL("cannot commit memory for nodes\n");
+
+  return pr;
+}
+
+void pr_free(Parser *pr) {
+  tb_free(&pr->tb);
+  free(pr->frames);
+  cp_free(&pr->consts);
+  arena_free(&pr->nodes_arena);
+  free(pr);
 }
 
 //=:interpreter:errors
@@ -735,6 +1631,10 @@ typedef enum {
   IR_ERR_STACK_UNDERFLOW,
   IR_ERR_AST_MEMORY_NOT_ENOUGH,
   IR_ERR_SYM_MEMORY_NOT_ENOUGH,
+  IR_ERR_ARITY_MISMATCH,
+  IR_ERR_CLAUSE_NOT_MATCHED,
+  IR_ERR_GUARD_NOT_INTERVAL,
+  IR_ERR_BUILTIN_REDEFINED,
 } IR_ERR;
 
 const char *ir_err_stringify(IR_ERR ir_err) {
@@ -751,153 +1651,217 @@ const char *ir_err_stringify(IR_ERR ir_err) {
     STRINGIFY_CASE(IR_ERR_STACK_UNDERFLOW)
     STRINGIFY_CASE(IR_ERR_AST_MEMORY_NOT_ENOUGH)
     STRINGIFY_CASE(IR_ERR_SYM_MEMORY_NOT_ENOUGH)
+    STRINGIFY_CASE(IR_ERR_ARITY_MISMATCH)
+    STRINGIFY_CASE(IR_ERR_CLAUSE_NOT_MATCHED)
+    STRINGIFY_CASE(IR_ERR_GUARD_NOT_INTERVAL)
+    STRINGIFY_CASE(IR_ERR_BUILTIN_REDEFINED)
   }
 
   return STRINGIFY(INVALID_IR_ERR);
 }
 
-//=:interpreter:interpreter
+//=:interpreter:propagation
 
-typedef struct {
-  Node_Index cap;
-  Node_Index len;
-  Node data[];
-} Stack_Node;
+// Errors - how relative errors of values are propagated through operations.
+typedef enum {
+  ERRORS_OFF,      // not at all, every value is taken as exact
+  ERRORS_LINEAR,   // to first order, adding independent errors in quadrature
+  ERRORS_INTERVAL, // as rigorous upper bounds, including rounding
+} Errors;
+
+// errors_parse - sets *errors to mode named by s. Returns false if there is no
+// such mode.
+bool errors_parse(const char *s, Errors *errors) {
+  if (strcmp(s, "off") == 0) {
+    *errors = ERRORS_OFF;
+  } else if (strcmp(s, "linear") == 0) {
+    *errors = ERRORS_LINEAR;
+  } else if (strcmp(s, "interval") == 0) {
+    *errors = ERRORS_INTERVAL;
+  } else {
+    return false;
+  }
 
-IR_ERR st_nd_add(Stack_Node *st, Node nd) {
-  if (st->len >= st->cap)
-    return IR_ERR_STACK_OVERFLOW;
+  return true;
+}
 
-  st->data[st->len] = nd;
-  ++st->len;
+// IV_U - unit roundoff, bound of relative rounding error of one operation
+// whose result is normal.
+#define IV_U 0x1p-53
 
-  return IR_ERR_NOERROR;
+// iv_up - rounds upwards bound x computed in few operations, so it stays bound
+// despite their rounding errors. NaN bound is no bound at all.
+static inline double iv_up(double x) {
+  return isnan(x) ? INFINITY : x * (1 + 0x1p-48);
 }
 
-IR_ERR st_nd_pop(Stack_Node *st, Node *nd) {
-  if (st->len == 0)
-    return IR_ERR_STACK_UNDERFLOW;
+// iv_rel - relative error of value of magnitude mag from bound r of its
+// absolute one, rounded upwards to float.
+static inline float iv_rel(double r, double mag) {
+  if (r == 0)
+    return 0;
 
-  --st->len;
-  *nd = st->data[st->len];
+  double rel = iv_up(r / mag);
+  if (!(rel < INFINITY))
+    return INFINITY;
 
-  return IR_ERR_NOERROR;
+  float f = (float)rel;
+  return (double)f < rel ? nextafterf(f, INFINITY) : f;
 }
 
-typedef struct {
-  Parser *pr;
-  Stack_Node *st;
+// errors_const - relative error of constant under errors mode, whose rel_err
+// is given by lexer: dropped without propagation and rounded upwards into
+// bound for intervals.
+static inline float errors_const(Errors errors, float rel_err) {
+  switch (errors) {
+  case ERRORS_OFF:      return 0;
+  case ERRORS_INTERVAL: return rel_err == 0 ? 0 : nextafterf(rel_err, INFINITY);
+  default:              return rel_err;
+  }
+}
 
-  Map_Entry *gscope;
-  size_t gscope_len;
-  size_t gscope_cap;
-} Interpreter;
+// iv_sum_err - rounding error of s = a + b, exact (Knuth's TwoSum). It is
+// NaN once sum overflows.
+static inline double iv_sum_err(double a, double b, double s) {
+  double bb = s - a;
+  return (a - (s - bb)) + (b - bb);
+}
 
-IR_ERR ir_assert_type(Node_Type expected, Node_Type actual) {
-  if (expected != actual)
-    return IR_ERR_NOT_DEFINED_FOR_TYPE;
+// iv_prod_err - rounding error of p = a * b, exact (Dekker's TwoProduct)
+// unless operands are too big to split or p is about to underflow, then it
+// is bound.
+static inline double iv_prod_err(double a, double b, double p) {
+  if (!(fabs(a) < 0x1p995 && fabs(b) < 0x1p995 && fabs(p) > 0x1p-960))
+    return p == 0 && (a == 0 || b == 0) ? 0 : fabs(p) * 2 * IV_U + 0x1p-1074;
 
-  return IR_ERR_NOERROR;
+  const double split = 0x1p27 + 1;
+  double ca = split * a, cb = split * b;
+  double ah = ca - (ca - a), bh = cb - (cb - b);
+  double al = a - ah, bl = b - bh;
+
+  return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
 }
 
-IR_ERR ir_st_pop_value(Interpreter *ir, Node *nd) {
-  TRY(IR_ERR, st_nd_pop(ir->st, nd));
+// iv_quo_err - bound of rounding error of q = a / b, zero if it is exact.
+static inline double iv_quo_err(double a, double b, double q) {
+  double p = q * b;
+  if (p == a && iv_prod_err(q, b, p) == 0)
+    return 0;
 
-  if (nd->type == NT_PRIM_SYM && !MAP_GET(ir->gscope, ir->gscope_cap, nd->as.pm.s, nd))
-    return IR_ERR_NOT_DEFINED_SYMBOL;
+  return fabs(q) * IV_U + 0x1p-1074;
+}
 
-  return IR_ERR_NOERROR;
+// iv_libm_err - bound of error of v computed by libm function.
+static inline double iv_libm_err(double v) {
+  return fabs(v) * INTERVAL_LIBM_ULPS * 0x1p-52 + 0x1p-1074;
 }
 
-IR_ERR ir_biop_exec_test_ncmx(Interpreter *ir, Node_Type op, Node nlhs, Node nrhs) {
-  double ra, rb;
+// iv_lo, iv_hi - ends of interval of x with absolute error r, rounded
+// outwards.
+static inline double iv_lo(double x, double r) {
+  return r == 0 ? x : nextafter(x - r, -INFINITY);
+}
 
-  cmx_t lhs = nlhs.as.pm.c;
-  cmx_t rhs = nrhs.as.pm.c;
+static inline double iv_hi(double x, double r) {
+  return r == 0 ? x : nextafter(x + r, INFINITY);
+}
 
-  float lhs_re = nlhs.rel_err;
-  float rhs_re = nrhs.rel_err;
+// iv_pow_exact - whether m = a^b is exactly integer power of integer, which
+// repeated squaring below 2^53 confirms.
+static inline bool iv_pow_exact(double a, double b, double m) {
+  if (a != trunc(a) || b != trunc(b) || b < 0 || !(fabs(m) < 0x1p53))
+    return false;
 
-  if (cimag(lhs) == 0 && cimag(rhs) == 0) {
-    ra = creal(lhs);
-    rb = creal(rhs);
-  } else if (creal(lhs) == 0 && creal(rhs) == 0) {
-    ra = cimag(lhs);
-    rb = cimag(rhs);
-  } else {
-    return IR_ERR_NOT_DEFINED_FOR_TYPE;
+  double p = 1;
+  for (double n = b, x = a; n > 0; n = floor(n / 2)) {
+    if (fmod(n, 2) == 1 && !(fabs(p *= x) < 0x1p53))
+      return false;
+    if (n > 1 && !(fabs(x *= x) < 0x1p53))
+      return false;
   }
 
-  double rt;
+  return p == m;
+}
 
-  switch (op) {
-  case NT_BIOP_GRE: rt = ra > rb; break;
-  case NT_BIOP_LES: rt = ra < rb; break;
-  case NT_BIOP_EQU: rt = contains_interval(ra, lhs_re, rb, rhs_re); break;
-  case NT_BIOP_NEQ: rt = 1 - contains_interval(ra, lhs_re, rb, rhs_re); break;
-  default:
-    return IR_ERR_ILL_NT;
+// iv_pow - relative error bound of m = a^b. Real power is monotonic in each
+// operand over intervals where it is defined, so it is bounded by values at
+// corners of intervals of operands.
+static inline float iv_pow(double a, float ra, double b, float rb, double m) {
+  if (ra == 0 && rb == 0 && iv_pow_exact(a, b, m))
+    return 0;
+
+  double rla = iv_up(fabs(a) * ra), rlb = iv_up(fabs(b) * rb);
+  double as[] = {iv_lo(a, rla), iv_hi(a, rla)};
+  double bs[] = {iv_lo(b, rlb), iv_hi(b, rlb)};
+  double lo = m, hi = m;
+
+  for (int i = 0; i < 2; ++i) {
+    for (int k = 0; k < 2; ++k) {
+      double v = pow(as[i], bs[k]);
+      if (isnan(v))
+        return INFINITY;
+      lo = fmin(lo, v);
+      hi = fmax(hi, v);
+    }
   }
 
-  return st_nd_add(ir->st, (Node){.type = NT_PRIM_PRB, .as.pm.c = rt, .rel_err = 0});
+  // integer power of base crossing zero reaches its extremum there
+  if (as[0] < 0 && as[1] > 0) {
+    double v = pow(0.0, b);
+    lo = fmin(lo, v);
+    hi = fmax(hi, v);
+  }
+
+  double r = fmax(hi - m, m - lo) + iv_libm_err(lo) + iv_libm_err(hi);
+  return iv_rel(r, fabs(m));
 }
 
-IR_ERR ir_biop_exec_ncmx(Interpreter *ir, Node_Type op, Node nlhs, Node nrhs) {
-  cmx_t rt;
-  float rt_re = 0;
+// iv_mod - relative error bound of m = fmod(a, b), which is exact. Remainder
+// is continuous only while quotient keeps its integer part.
+static inline float iv_mod(double a, float ra, double b, float rb, double m) {
+  if (ra == 0 && rb == 0)
+    return 0;
+  if (!(rb < 1))
+    return INFINITY;
+
+  double q = a / b;
+  double dq = iv_up(fabs(q) * (((double)ra + rb) / (1 - rb) + 2 * IV_U));
+  double k = trunc(q);
+  if (trunc(q - dq) != k || trunc(q + dq) != k)
+    return INFINITY;
+
+  return iv_rel(fabs(a) * ra + fabs(k) * fabs(b) * rb, fabs(m));
+}
 
-  cmx_t lhs = nlhs.as.pm.c;
-  cmx_t rhs = nrhs.as.pm.c;
+// iv_count - relative error bound of m = count, computed exactly by caller
+// as below 2^53, or unbounded error if count is not known.
+static inline float iv_count(double count, double m) {
+  if (!(count < 0x1p53))
+    return INFINITY;
 
-  float lhs_re = nlhs.rel_err;
-  float rhs_re = nrhs.rel_err;
+  return iv_rel(fabs(m - count), fabs(m));
+}
 
-  switch (op) {
-  case NT_BIOP_ADD:
-    rt = lhs + rhs;
-    rt_re = sqrt(pow(lhs_re * lhs, 2) + pow(rhs_re * rhs, 2)) / fabs(rt);
-    break;
-  case NT_BIOP_SUB:
-    rt = lhs - rhs;
-    rt_re = sqrt(pow(lhs_re * lhs, 2) + pow(rhs_re * rhs, 2)) / fabs(rt);
-    break;
-  case NT_BIOP_APX:
-    rt = lhs;
-    rt_re = rhs / lhs;
-    break;
-  case NT_BIOP_MUL:
-    rt = lhs * rhs;
-    rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
-    break;
-  case NT_BIOP_POW:
-    rt = pow(lhs, rhs);
-    rt_re = sqrt(pow(rhs * lhs_re, 2) + pow(log(lhs) * rhs_re, 2));
-    break;
-  case NT_BIOP_FAC:
-    rt = fac_cmx(lhs, rhs);
-    rt_re = fabs(lhs_re * lhs * log(lhs)) + rhs_re;
-    break;
-  case NT_BIOP_QUO:
-    if (rhs == 0)
-      return IR_ERR_DIV_BY_ZERO;
+// iv_fac - relative error bound of m = multifactorial of n with step s, which
+// is exact for exact integers once product is below 2^53.
+static inline float iv_fac(double n, float rn, double s, float rs, double m) {
+  if (rn != 0 || rs != 0 || n != trunc(n) || s != trunc(s) || n < 0 || s < 1)
+    return INFINITY;
 
-    rt = lhs / rhs;
-    rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
-    break;
-  case NT_BIOP_MOD:
-    if (cimag(lhs) != 0 || cimag(rhs) != 0)
-      return IR_ERR_NOT_DEFINED_FOR_TYPE;
+  return iv_count(fac_int(n, s), m);
+}
 
-    rt = fmod(creal(lhs), creal(rhs));
-    rt_re = lhs_re + rhs_re;
-    break;
-  default:
-    return ir_biop_exec_test_ncmx(ir, op, nlhs, nrhs);
-  }
+// iv_subfac - relative error bound of m = subfactorial of n, exact for exact
+// integers.
+static inline float iv_subfac(double n, float rn, double m) {
+  if (rn != 0 || n != trunc(n) || n < 0)
+    return INFINITY;
 
-  return st_nd_add(ir->st, (Node){.type = NT_PRIM_CMX, .as.pm.c = rt, .rel_err = rt_re});
+  return iv_count(subfac_int(n), m);
 }
 
+//=:interpreter:builtins
+
 enum {
   BUILTIN_CONST_PI = 2282,
   BUILTIN_CONST_E = 31,
@@ -919,149 +1883,4079 @@ enum {
   BUILTIN_ACOSH = 582391643,
   BUILTIN_ASINH = 581057371,
   BUILTIN_ATANH = 581024667,
+  BUILTIN_HYPOT = 782675170,
+  BUILTIN_ATAN2 = 950123419,
+  BUILTIN_MIN = 166119,
+  BUILTIN_MAX = 206567,
+  BUILTIN_CLAMP = 714979741,
+  BUILTIN_LOG = 137830,
 };
 
-IR_ERR ir_call_exec_builtin_cmx(Interpreter *ir, sym_t fn, cmx_t arg) {
-  cmx_t rt;
+// BUILTIN_ARITY_MAX - most arguments taken by builtin.
+#define BUILTIN_ARITY_MAX 3
+
+// Builtin_Fn - builtin function of one complex argument.
+typedef cmx_t (*Builtin_Fn)(cmx_t);
+
+// Builtin_Fn_N - builtin function of several complex arguments.
+typedef cmx_t (*Builtin_Fn_N)(const cmx_t *args);
+
+typedef struct Builtin Builtin;
+
+// Builtin_Bound - bound of relative error of real result m of builtin bi, from
+// its real arguments with bounds of their relative errors.
+typedef float (*Builtin_Bound)(const Builtin *bi, const Value *args, double m);
+
+// Builtin - entry of builtin registry. Builtins of one argument are called by
+// fn, so machine code may call them directly, the others by fn_n.
+struct Builtin {
+  sym_t sym; // name, 0 in empty slot
+  uint8_t arity;
+  bool pure;      // result depends on arguments only, so calls of constants fold
+  bool real;      // maps real arguments to real result
+  bool monotonic; // monotonic on reals it maps to reals
+  bool real_args; // takes real arguments only, warns on others
+  Builtin_Fn fn;
+  Builtin_Fn_N fn_n;
+  Builtin_Bound bound; // error propagation in interval mode
+};
 
-  switch (fn) {
-  case BUILTIN_SQRT:  rt = sqrt(arg); break;
-  case BUILTIN_CEIL:  rt = ceil(creal(arg)) + ceil(cimag(arg)) * I; break;
-  case BUILTIN_ROUND: rt = round(creal(arg)) + round(cimag(arg)) * I; break;
-  case BUILTIN_FLOOR: rt = floor(creal(arg)) + floor(cimag(arg)) * I; break;
-  case BUILTIN_LN:    rt = log(arg); break;
-  case BUILTIN_EXP:   rt = exp(arg); break;
-  case BUILTIN_COS:   rt = cos(arg); break;
-  case BUILTIN_SIN:   rt = sin(arg); break;
-  case BUILTIN_TAN:   rt = tan(arg); break;
-  case BUILTIN_COSH:  rt = cosh(arg); break;
-  case BUILTIN_SINH:  rt = sinh(arg); break;
-  case BUILTIN_TANH:  rt = tanh(arg); break;
-  case BUILTIN_ACOS:  rt = acos(arg); break;
-  case BUILTIN_ASIN:  rt = asin(arg); break;
-  case BUILTIN_ATAN:  rt = atan(arg); break;
-  case BUILTIN_ACOSH: rt = acosh(arg); break;
-  case BUILTIN_ASINH: rt = asinh(arg); break;
-  case BUILTIN_ATANH: rt = atanh(arg); break;
-  default:
-    return IR_ERR_NOT_DEFINED_SYMBOL;
+// BUILTIN_DEFINE - defines builtin which maps real arguments within [lo, hi]
+// by real function fn and the rest by complex one. Zero imaginary part is
+// taken as positive, so results on branch cuts do not depend on its sign.
+#define BUILTIN_DEFINE(name, fn, lo, hi)                     \
+  cmx_t builtin_##name(cmx_t arg) {                          \
+    if (cimag(arg) != 0)                                     \
+      return fn(arg);                                        \
+                                                             \
+    double x = creal(arg);                                   \
+    return x >= (lo) && x <= (hi) ? fn(x) : fn(CMPLX(x, 0)); \
   }
 
-  return st_nd_add(ir->st, (Node){.type = NT_PRIM_CMX, .as.pm.c = rt, .rel_err = 0});
-}
+BUILTIN_DEFINE(sqrt, sqrt, 0, INFINITY)
+BUILTIN_DEFINE(ln, log, 0, INFINITY)
+BUILTIN_DEFINE(exp, exp, -INFINITY, INFINITY)
+BUILTIN_DEFINE(cos, cos, -INFINITY, INFINITY)
+BUILTIN_DEFINE(sin, sin, -INFINITY, INFINITY)
+BUILTIN_DEFINE(tan, tan, -INFINITY, INFINITY)
+BUILTIN_DEFINE(cosh, cosh, -INFINITY, INFINITY)
+BUILTIN_DEFINE(sinh, sinh, -INFINITY, INFINITY)
+BUILTIN_DEFINE(tanh, tanh, -INFINITY, INFINITY)
+BUILTIN_DEFINE(acos, acos, -1, 1)
+BUILTIN_DEFINE(asin, asin, -1, 1)
+BUILTIN_DEFINE(atan, atan, -INFINITY, INFINITY)
+BUILTIN_DEFINE(acosh, acosh, 1, INFINITY)
+BUILTIN_DEFINE(asinh, asinh, -INFINITY, INFINITY)
+BUILTIN_DEFINE(atanh, atanh, -1, 1)
 
-IR_ERR ir_exec(Interpreter *ir) {
-  Node current, lhs, rhs;
-  Node_Index tail_mark, head_mark;
+#undef BUILTIN_DEFINE
 
-  Node_Index pr_nodes_ptr = 0;
+cmx_t builtin_ceil(cmx_t arg) { return ceil(creal(arg)) + ceil(cimag(arg)) * I; }
 
-  while (pr_nodes_ptr < ir->pr->nodes_len) {
-    current = ir->pr->nodes[pr_nodes_ptr];
+cmx_t builtin_round(cmx_t arg) { return round(creal(arg)) + round(cimag(arg)) * I; }
 
-    switch (current.type) {
-    case NT_PRIM_SYM:
-    case NT_PRIM_CMX:
-      TRY(IR_ERR, st_nd_add(ir->st, current));
-      break;
-    case NT_UNOP_NOT:
-    case NT_UNOP_NEG:
-    case NT_UNOP_ABS:
-    case NT_UNOP_NOP:
-      tail_mark = pr_nodes_ptr;
-      if (pr_nodes_ptr + 1 == ir->pr->nodes_len)
-        return IR_ERR_NUM_ARG_EXPECTED;
-      ++pr_nodes_ptr;
+cmx_t builtin_floor(cmx_t arg) { return floor(creal(arg)) + floor(cimag(arg)) * I; }
 
-      while (pr_nodes_ptr + 1 < ir->pr->nodes_len && is_unop(ir->pr->nodes[pr_nodes_ptr].type))
-        ++pr_nodes_ptr;
+// builtin_hypot - length of hypotenuse, without overflow of squares of real
+// legs.
+cmx_t builtin_hypot(const cmx_t *args) {
+  cmx_t x = args[0], y = args[1];
 
-      head_mark = pr_nodes_ptr;
+  if (cimag(x) == 0 && cimag(y) == 0)
+    return hypot(creal(x), creal(y));
 
-      lhs = ir->pr->nodes[pr_nodes_ptr];
+  return csqrt(x * x + y * y);
+}
 
-      if (lhs.type == NT_PRIM_SYM && !MAP_GET(ir->gscope, ir->gscope_cap, lhs.as.pm.s, &lhs))
-        return IR_ERR_NOT_DEFINED_SYMBOL;
+// builtin_atan2 - angle of point (x, y) given as atan2(y, x).
+cmx_t builtin_atan2(const cmx_t *args) {
+  ASSERT_IMG_ZER(args[0], "atan2");
+  ASSERT_IMG_ZER(args[1], "atan2");
 
-      TRY(IR_ERR, ir_assert_type(NT_PRIM_CMX, lhs.type));
+  return atan2(creal(args[0]), creal(args[1]));
+}
 
-      while (pr_nodes_ptr > tail_mark && pr_nodes_ptr <= head_mark) {
-        --pr_nodes_ptr;
+cmx_t builtin_min(const cmx_t *args) {
+  ASSERT_IMG_ZER(args[0], "min");
+  ASSERT_IMG_ZER(args[1], "min");
 
-        switch (ir->pr->nodes[pr_nodes_ptr].type) {
-        case NT_UNOP_NOP: break;
-        case NT_UNOP_NOT: lhs.as.pm.c = subfac_cmx(lhs.as.pm.c); break;
-        case NT_UNOP_NEG: lhs.as.pm.c = -lhs.as.pm.c; break;
-        case NT_UNOP_ABS: lhs.as.pm.c = fabs(lhs.as.pm.c); break;
-        default:
-          return IR_ERR_ILL_NT;
-        }
-      }
+  return fmin(creal(args[0]), creal(args[1]));
+}
 
-      pr_nodes_ptr = head_mark;
-      st_nd_add(ir->st, lhs);
-      break;
-    case NT_CALL:
-      TRY(IR_ERR, ir_st_pop_value(ir, &rhs));
-      TRY(IR_ERR, st_nd_pop(ir->st, &lhs));
+cmx_t builtin_max(const cmx_t *args) {
+  ASSERT_IMG_ZER(args[0], "max");
+  ASSERT_IMG_ZER(args[1], "max");
 
-      TRY(IR_ERR, ir_assert_type(NT_PRIM_SYM, lhs.type));
-      TRY(IR_ERR, ir_assert_type(NT_PRIM_CMX, rhs.type));
+  return fmax(creal(args[0]), creal(args[1]));
+}
 
-      TRY(IR_ERR, ir_call_exec_builtin_cmx(ir, lhs.as.pm.s, rhs.as.pm.c));
-      break;
-    case NT_BIOP_LET:
-      TRY(IR_ERR, ir_st_pop_value(ir, &rhs));
-      TRY(IR_ERR, st_nd_pop(ir->st, &lhs));
+// builtin_clamp - x of clamp(x, lo, hi) limited to [lo, hi].
+cmx_t builtin_clamp(const cmx_t *args) {
+  ASSERT_IMG_ZER(args[0], "clamp");
+  ASSERT_IMG_ZER(args[1], "clamp");
+  ASSERT_IMG_ZER(args[2], "clamp");
 
-      TRY(IR_ERR, ir_assert_type(NT_PRIM_SYM, lhs.type));
+  return fmin(fmax(creal(args[0]), creal(args[1])), creal(args[2]));
+}
 
-      if (!MAP_SET(ir->gscope, ir->gscope_cap, lhs.as.pm.s, &rhs))
-        return IR_ERR_SYM_MEMORY_NOT_ENOUGH;
+// builtin_log - logarithm of x to base b, given as log(b, x). Quotient of real
+// logarithms is rounded once, unlike complex division.
+cmx_t builtin_log(const cmx_t *args) {
+  cmx_t lb = builtin_ln(args[0]), lx = builtin_ln(args[1]);
 
-      break;
-    case NT_BIOP_GRE:
-    case NT_BIOP_LES:
-    case NT_BIOP_GEQ:
-    case NT_BIOP_LEQ:
-    case NT_BIOP_EQU:
-    case NT_BIOP_NEQ:
-    case NT_BIOP_ADD:
-    case NT_BIOP_SUB:
-    case NT_BIOP_APX:
-    case NT_BIOP_MUL:
-    case NT_BIOP_QUO:
-    case NT_BIOP_MOD:
-    case NT_BIOP_POW:
-    case NT_BIOP_FAC:
-      TRY(IR_ERR, ir_st_pop_value(ir, &rhs));
-      TRY(IR_ERR, ir_st_pop_value(ir, &lhs));
+  if (cimag(lb) == 0 && cimag(lx) == 0)
+    return creal(lx) / creal(lb);
 
-      if (lhs.type == NT_PRIM_CMX && rhs.type == NT_PRIM_CMX) {
-        TRY(IR_ERR, ir_biop_exec_ncmx(ir, current.type, lhs, rhs));
-      } else {
-        return IR_ERR_NOT_DEFINED_FOR_TYPE;
-      }
+  return lx / lb;
+}
 
-      break;
-    default:
-      return IR_ERR_NOT_IMPLEMENTED;
-    }
+// builtin_bound_unary - bound of relative error of m = fn(x), from interval of
+// x: by values at its ends for monotonic builtins, cosh and tan between poles,
+// and by Lipschitz constant 1 for sin and cos. Zeros of builtins at exact
+// arguments are exact.
+float builtin_bound_unary(const Builtin *bi, const Value *args, double m) {
+  double x = creal(args[0].pm.c);
+  double r = iv_up(fabs(x) * args[0].rel_err);
+  sym_t fn = bi->sym;
+  bool exact = fn == BUILTIN_CEIL || fn == BUILTIN_ROUND || fn == BUILTIN_FLOOR;
 
-    ++pr_nodes_ptr;
-  }
+  if (r == 0 && (exact || m == 0))
+    return 0;
+  if (r == 0 && fn == BUILTIN_SQRT && m * m == x && iv_prod_err(m, m, x) == 0)
+    return 0;
 
-  if (ir->st->len) {
-    TRY(IR_ERR, ir_st_pop_value(ir, &current));
-    TRY(IR_ERR, st_nd_add(ir->st, current));
-  }
+  if (fn == BUILTIN_SIN || fn == BUILTIN_COS)
+    return iv_rel(r + iv_libm_err(m), fabs(m));
 
-  return IR_ERR_NOERROR;
-}
+  double lo = iv_lo(x, r), hi = iv_hi(x, r);
+  cmx_t flo = bi->fn(lo), fhi = bi->fn(hi);
 
-//=:user:repl
+  if (cimag(flo) != 0 || cimag(fhi) != 0 || isnan(creal(flo)) ||
+      isnan(creal(fhi)))
+    return INFINITY;
 
-_Noreturn void repl(Interpreter *ir) {
+  double vlo = fmin(creal(flo), creal(fhi)), vhi = fmax(creal(flo), creal(fhi));
+
+  switch (fn) {
+  case BUILTIN_COSH:
+    if (lo < 0 && hi > 0)
+      vlo = 1;
+    break;
+  case BUILTIN_TAN:
+    // pole between ends would make tan decrease
+    if (!(hi - lo < M_PI && creal(flo) <= creal(fhi)))
+      return INFINITY;
+    break;
+  default:
+    if (!bi->monotonic)
+      return INFINITY;
+    break;
+  }
+
+  double e = exact ? 0 : iv_libm_err(vlo) + iv_libm_err(vhi);
+  return iv_rel(fmax(vhi - m, m - vlo) + e, fabs(m));
+}
+
+// builtin_box - ends lo and hi of intervals of arity arguments.
+static inline void builtin_box(const Builtin *bi, const Value *args,
+                               double *lo, double *hi) {
+  for (unsigned i = 0; i < bi->arity; ++i) {
+    double x = creal(args[i].pm.c), r = iv_up(fabs(x) * args[i].rel_err);
+    lo[i] = iv_lo(x, r);
+    hi[i] = iv_hi(x, r);
+  }
+}
+
+// builtin_corners - bound of relative error of m from values of builtin at
+// corners of box [lo, hi], which hold its extremes on box if it is monotonic
+// in every argument while the others are fixed. Every value is computed with
+// error of libm calls, none if it is exact.
+float builtin_corners(const Builtin *bi, const double *lo, const double *hi,
+                      unsigned libm, double m) {
+  double vlo = INFINITY, vhi = -INFINITY;
+
+  for (unsigned k = 0; k < 1u << bi->arity; ++k) {
+    cmx_t x[BUILTIN_ARITY_MAX];
+    for (unsigned i = 0; i < bi->arity; ++i)
+      x[i] = k >> i & 1 ? hi[i] : lo[i];
+
+    cmx_t v = bi->fn_n(x);
+    if (cimag(v) != 0 || isnan(creal(v)))
+      return INFINITY;
+
+    vlo = fmin(vlo, creal(v));
+    vhi = fmax(vhi, creal(v));
+  }
+
+  double e = libm * fmax(iv_libm_err(vlo), iv_libm_err(vhi));
+  return iv_rel(fmax(vhi - m, m - vlo) + e, fabs(m));
+}
+
+// builtin_bound_exact - bound for min, max and clamp, which are exact and
+// nondecreasing in every argument.
+float builtin_bound_exact(const Builtin *bi, const Value *args, double m) {
+  double lo[BUILTIN_ARITY_MAX], hi[BUILTIN_ARITY_MAX];
+
+  builtin_box(bi, args, lo, hi);
+  return builtin_corners(bi, lo, hi, 0, m);
+}
+
+// builtin_bound_hypot - bound for hypot, which is monotonic in magnitudes of
+// legs, so intervals are folded at zero.
+float builtin_bound_hypot(const Builtin *bi, const Value *args, double m) {
+  double lo[BUILTIN_ARITY_MAX], hi[BUILTIN_ARITY_MAX];
+
+  builtin_box(bi, args, lo, hi);
+  for (unsigned i = 0; i < bi->arity; ++i) {
+    double a = fabs(lo[i]), b = fabs(hi[i]);
+    lo[i] = lo[i] <= 0 && hi[i] >= 0 ? 0 : fmin(a, b);
+    hi[i] = fmax(a, b);
+  }
+
+  return builtin_corners(bi, lo, hi, 1, m);
+}
+
+// builtin_bound_atan2 - bound for atan2, whose extremes on box away from
+// origin and branch cut along negative x are at its corners.
+float builtin_bound_atan2(const Builtin *bi, const Value *args, double m) {
+  double lo[BUILTIN_ARITY_MAX], hi[BUILTIN_ARITY_MAX];
+
+  builtin_box(bi, args, lo, hi);
+  if (lo[0] <= 0 && hi[0] >= 0 && lo[1] <= 0)
+    return INFINITY;
+
+  return builtin_corners(bi, lo, hi, 1, m);
+}
+
+// builtin_bound_log - bound for log(b, x), quotient of two libm logarithms,
+// which is monotonic in both while base stays off 1.
+float builtin_bound_log(const Builtin *bi, const Value *args, double m) {
+  double lo[BUILTIN_ARITY_MAX], hi[BUILTIN_ARITY_MAX];
+
+  builtin_box(bi, args, lo, hi);
+  if (lo[0] <= 0 || lo[1] <= 0 || (lo[0] <= 1 && hi[0] >= 1))
+    return INFINITY;
+
+  return builtin_corners(bi, lo, hi, 3, m);
+}
+
+// BUILTIN_HASH_MUL, BUILTIN_HASH_BITS - multiplicative hash which maps names
+// of all builtins to distinct slots of BUILTINS. Multiplier was found among
+// random odd ones; name which collides makes -Woverride-init report slot
+// initialized twice, then another one is to be found.
+#define BUILTIN_HASH_MUL 0x56befa395e3c536dull
+#define BUILTIN_HASH_BITS 6
+
+#define BUILTIN_SLOT(sym) \
+  ((uint64_t)(sym) * BUILTIN_HASH_MUL >> (64 - BUILTIN_HASH_BITS))
+
+#define BUILTIN_UNARY(name, NAME, is_real, is_monotonic)                      \
+  [BUILTIN_SLOT(BUILTIN_##NAME)] = {                                          \
+      .sym = BUILTIN_##NAME, .arity = 1, .pure = true, .real = is_real,       \
+      .monotonic = is_monotonic, .fn = builtin_##name,                        \
+      .bound = builtin_bound_unary,                                           \
+  }
+
+#define BUILTIN_N(name, NAME, n, is_real, takes_real, bound_fn)               \
+  [BUILTIN_SLOT(BUILTIN_##NAME)] = {                                          \
+      .sym = BUILTIN_##NAME, .arity = n, .pure = true, .real = is_real,       \
+      .real_args = takes_real, .fn_n = builtin_##name, .bound = bound_fn,     \
+  }
+
+// BUILTINS - registry of builtins, indexed by BUILTIN_SLOT of their names.
+static const Builtin BUILTINS[1 << BUILTIN_HASH_BITS] = {
+    BUILTIN_UNARY(sqrt, SQRT, false, true),
+    BUILTIN_UNARY(ceil, CEIL, true, true),
+    BUILTIN_UNARY(round, ROUND, true, true),
+    BUILTIN_UNARY(floor, FLOOR, true, true),
+    BUILTIN_UNARY(ln, LN, false, true),
+    BUILTIN_UNARY(exp, EXP, true, true),
+    BUILTIN_UNARY(cos, COS, true, false),
+    BUILTIN_UNARY(sin, SIN, true, false),
+    BUILTIN_UNARY(tan, TAN, true, false),
+    BUILTIN_UNARY(cosh, COSH, true, false),
+    BUILTIN_UNARY(sinh, SINH, true, true),
+    BUILTIN_UNARY(tanh, TANH, true, true),
+    BUILTIN_UNARY(acos, ACOS, false, true),
+    BUILTIN_UNARY(asin, ASIN, false, true),
+    BUILTIN_UNARY(atan, ATAN, true, true),
+    BUILTIN_UNARY(acosh, ACOSH, false, true),
+    BUILTIN_UNARY(asinh, ASINH, true, true),
+    BUILTIN_UNARY(atanh, ATANH, false, true),
+    BUILTIN_N(hypot, HYPOT, 2, true, false, builtin_bound_hypot),
+    BUILTIN_N(atan2, ATAN2, 2, true, true, builtin_bound_atan2),
+    BUILTIN_N(min, MIN, 2, true, true, builtin_bound_exact),
+    BUILTIN_N(max, MAX, 2, true, true, builtin_bound_exact),
+    BUILTIN_N(clamp, CLAMP, 3, true, true, builtin_bound_exact),
+    BUILTIN_N(log, LOG, 2, false, false, builtin_bound_log),
+};
+
+#undef BUILTIN_UNARY
+#undef BUILTIN_N
+
+// builtin_of - returns builtin named sym, or NULL. Its slot is computed, so
+// lookup takes one multiplication and one comparison.
+static inline const Builtin *builtin_of(sym_t sym) {
+  const Builtin *bi = &BUILTINS[BUILTIN_SLOT(sym)];
+  return bi->sym == sym && sym != 0 ? bi : NULL;
+}
+
+// builtin_exec - calls bi on its arguments, which are read before res is
+// written, so it may alias them. Errors propagate through builtins only in
+// interval mode, results of complex numbers are not bounded.
+static inline __attribute__((always_inline)) void
+builtin_exec(const Builtin *bi, Errors errors, const Value *args, Value *res) {
+  cmx_t x[BUILTIN_ARITY_MAX];
+  bool real = true;
+
+  for (unsigned i = 0; i < bi->arity; ++i) {
+    x[i] = args[i].pm.c;
+    real &= cimag(x[i]) == 0;
+  }
+
+  cmx_t m = bi->arity == 1 ? bi->fn(x[0]) : bi->fn_n(x);
+  float rel_err = 0;
+  if (errors == ERRORS_INTERVAL)
+    rel_err = real && cimag(m) == 0 ? bi->bound(bi, args, creal(m)) : INFINITY;
+
+  *res = (Value){.type = NT_PRIM_CMX, .pm.c = m, .rel_err = rel_err};
+}
+
+//=:interpreter:globals
+
+// Globals - values of global symbols in dense slots, which compiled code loads
+// and stores by index. Map is consulted only by compiler, binding names to
+// slots as it meets them; slots of names never assigned hold NT_PRIM_SYM.
+// Globals may instead view snapshot, sharing its arrays read only.
+typedef struct {
+  Map slots; // of uint32_t
+  Value *vals;
+  sym_t *syms; // naming every slot
+  uint32_t len;
+  uint32_t cap;
+  struct Gl_Snapshot *snap; // viewed, NULL if globals are own
+} Globals;
+
+// Gl_Snapshot - immutable copy of globals, shared by views of it and freed by
+// the last of them to release it. Slot after the last one is never bound,
+// names missing from snapshot resolve to it in views.
+typedef struct Gl_Snapshot {
+  _Atomic uint32_t refs;
+  Globals gl;
+} Gl_Snapshot;
+
+bool gl_init(Globals *gl) {
+  *gl = (Globals){0};
+  return map_init(&gl->slots, GLOBAL_SCOPE_CAPACITY, sizeof(uint32_t));
+}
+
+// gl_grow - makes room for cap slots. Returns false if allocation failed.
+bool gl_grow(Globals *gl, uint32_t cap) {
+  Value *vals = realloc(gl->vals, cap * sizeof(Value));
+  if (vals == NULL)
+    return false;
+  gl->vals = vals;
+
+  sym_t *syms = realloc(gl->syms, cap * sizeof(sym_t));
+  if (syms == NULL)
+    return false;
+  gl->syms = syms;
+
+  gl->cap = cap;
+  return true;
+}
+
+// gl_slot - sets \*slot to slot of sym, binding new one if it has none.
+// Returns false if there is no memory for it.
+bool gl_slot(Globals *gl, sym_t sym, uint32_t *slot) {
+  if (MAP_GET(&gl->slots, sym, slot))
+    return true;
+
+  // view binds nothing, its code never assigns
+  if (gl->snap != NULL) {
+    *slot = gl->len;
+    return true;
+  }
+
+  if (gl->len == gl->cap &&
+      (gl->cap > UINT32_MAX / 2 || !gl_grow(gl, MAX(2 * gl->cap, 64))))
+    return false;
+
+  *slot = gl->len;
+  if (!MAP_SET(&gl->slots, sym, slot))
+    return false;
+
+  gl->vals[gl->len] = (Value){.type = NT_PRIM_SYM};
+  gl->syms[gl->len++] = sym;
+  return true;
+}
+
+// gl_set - assigns v to sym. Returns false if there is no memory for it.
+bool gl_set(Globals *gl, sym_t sym, const Value *v) {
+  uint32_t slot;
+  if (!gl_slot(gl, sym, &slot))
+    return false;
+
+  gl->vals[slot] = *v;
+  return true;
+}
+
+// gl_copy - sets dst to copy of src, with the same slots. Returns false if
+// allocation failed.
+bool gl_copy(Globals *dst, const Globals *src) {
+  if (!map_copy(&dst->slots, &src->slots, sizeof(uint32_t)) ||
+      (dst->cap < src->len && !gl_grow(dst, src->cap)))
+    return false;
+
+  memcpy(dst->vals, src->vals, src->len * sizeof(Value));
+  memcpy(dst->syms, src->syms, src->len * sizeof(sym_t));
+  dst->len = src->len;
+  return true;
+}
+
+void gl_snap_release(Gl_Snapshot *s) {
+  if (atomic_fetch_sub_explicit(&s->refs, 1, memory_order_acq_rel) != 1)
+    return;
+
+  map_free(&s->gl.slots);
+  free(s->gl.vals);
+  free(s->gl.syms);
+  free(s);
+}
+
+// gl_snapshot - returns snapshot of gl referenced once, or NULL if allocation
+// failed.
+Gl_Snapshot *gl_snapshot(const Globals *gl) {
+  Gl_Snapshot *s = malloc(sizeof(Gl_Snapshot));
+  if (s == NULL)
+    return NULL;
+
+  s->gl = (Globals){0};
+  atomic_init(&s->refs, 1);
+  if (!gl_grow(&s->gl, gl->len + 1) || !gl_copy(&s->gl, gl)) {
+    gl_snap_release(s);
+    return NULL;
+  }
+
+  s->gl.vals[s->gl.len] = (Value){.type = NT_PRIM_SYM};
+  return s;
+}
+
+void gl_free(Globals *gl) {
+  if (gl->snap != NULL) {
+    gl_snap_release(gl->snap);
+    return;
+  }
+
+  map_free(&gl->slots);
+  free(gl->vals);
+  free(gl->syms);
+}
+
+// gl_view - sets gl, own or viewing other snapshot, to view of s. Snapshot is
+// referenced until view is freed; caller must hold reference to s meanwhile.
+void gl_view(Globals *gl, Gl_Snapshot *s) {
+  atomic_fetch_add_explicit(&s->refs, 1, memory_order_relaxed);
+  gl_free(gl);
+  *gl = s->gl;
+  gl->snap = s;
+}
+
+//=:interpreter:bytecode
+
+typedef uint32_t Reg;
+
+typedef enum {
+  OP_HALT,   // stops without result
+  OP_RET,    // stops with result in a
+  OP_FAIL,   // stops with IR_ERR a
+  OP_LDSYM,  // dst = value of symbol in global slot a
+  OP_CHKCMX, // fails unless a is complex
+  OP_ADD,    // dst = a op b, for OP_ADD up to OP_NEQ
+  OP_SUB,
+  OP_APX,
+  OP_MUL,
+  OP_QUO,
+  OP_MOD,
+  OP_POW,
+  OP_FAC,
+  OP_GRE,
+  OP_LES,
+  OP_GEQ,
+  OP_LEQ,
+  OP_EQU,
+  OP_NEQ,
+  OP_NEG, // dst = op a, for OP_NEG up to OP_ABS
+  OP_NOT,
+  OP_ABS,
+  OP_CALL, // dst = builtin named by a of arguments from b on
+  OP_LET,  // symbol in global slot a = b
+  OP_MOV,  // dst = a
+  OP_FN,   // dst = user function named by a of n arguments from b on
+  OP_DEF,  // defines clause of user function compiled with expression
+  OP_RADD, // dst = a op b of real a and b, for OP_RADD up to OP_RPOW
+  OP_RSUB,
+  OP_RMUL,
+  OP_RQUO,
+  OP_RPOW,
+} Opcode;
+
+// Instr - instruction of register machine. Registers below consts_len hold
+// constant pool of expression and results of folded calls, the rest are
+// temporaries.
+typedef struct {
+  uint8_t op;
+  uint8_t n; // number of arguments of OP_FN
+  Reg dst;
+  Reg a;
+  Reg b;
+} Instr;
+
+typedef enum {
+  BC_OPD_CMX,  // complex number
+  BC_OPD_REAL, // complex number with zero imaginary part
+  BC_OPD_PRB,  // result of test
+  BC_OPD_SYM,  // symbol not resolved yet, register holds its name
+  BC_OPD_ANY,  // resolved symbol of any type
+} Bc_Operand_Kind;
+
+// Bc_Operand - compile time value of evaluated node. Arguments of call are
+// adjacent operands, the last of them counts all.
+typedef struct {
+  Reg reg;
+  uint8_t kind;
+  uint32_t args;
+} Bc_Operand;
+
+// Bc_Work - node waiting for its operands. Sequence which is not lhs of
+// another one opens block, holding operands and locals bound outside of it.
+typedef struct {
+  Node_Index node;
+  bool visited;
+  bool block;
+  uint32_t opds;
+  uint32_t locals;
+  Reg bound;
+  Reg temps; // first temporary allocated in block
+} Bc_Work;
+
+// Bc_Local - symbol assigned in block, bound to register holding its value
+// up to end of block.
+typedef struct {
+  sym_t sym;
+  Reg reg;
+  uint8_t kind;
+} Bc_Local;
+
+// FN_ARITY_MAX - most parameters of user function, one bit of mask each.
+#define FN_ARITY_MAX 8
+
+// Bc_Guard - guard of clause being defined, argument param op bound for op
+// from OP_GRE up to OP_EQU. Code of definition computes bound of node into
+// register.
+typedef struct {
+  Node_Index node;
+  Reg bound;
+  uint8_t param;
+  uint8_t op;
+} Bc_Guard;
+
+// Bc_Def - clause of user function defined by expression and installed by
+// OP_DEF. Its body is compiled apart, to run in frame of registers holding
+// constants of expression, then arguments from consts_len on, then
+// temporaries.
+typedef struct {
+  sym_t name;
+  uint8_t arity;
+  Reg regs_len; // of frame of body
+
+  Instr *code;
+  uint32_t code_len;
+  uint32_t code_cap;
+
+  Bc_Guard *guards;
+  uint32_t guards_len;
+  uint32_t guards_cap;
+} Bc_Def;
+
+typedef struct {
+  Arena code_arena;
+  uint32_t code_len;
+  uint32_t code_cap;
+  Instr *code;
+
+  Arena regs_arena;
+  Reg consts_len;
+  Reg folded;   // next register for result of folded call
+  Reg temps_at; // first temporary, after parameters in body of function
+  Reg temps_len;
+  Reg temps_max;
+  Reg bound;    // first temporary not holding value of local
+  Value *regs;
+
+  Bc_Work *work;
+  uint32_t work_len;
+  uint32_t work_cap;
+
+  Bc_Operand *opds;
+  uint32_t opds_len;
+  uint32_t opds_cap;
+
+  // assignments in sequences, function bodies and guards bind locals, those
+  // of whole expression are global
+  Bc_Local *locals;
+  uint32_t locals_len;
+  uint32_t locals_cap;
+  uint32_t blocks;
+
+  Errors errors;     // of constants and folded calls
+  Globals *globals; // symbols are resolved to slots of
+
+  // parameters of function being defined, held in registers from consts_len
+  // on by its body; its guards may not refer to them
+  sym_t params[FN_ARITY_MAX];
+  uint32_t params_len;
+  uint32_t params_real; // mask of guarded parameters, so known to be real
+  bool body;            // whether body is being compiled
+  Bc_Def def;
+} Bytecode;
+
+bool bc_init(Bytecode *bc) {
+  *bc = (Bytecode){0};
+
+  if (!arena_init(&bc->code_arena, NODE_ARENA_RESERVE, NODE_ARENA_HUGEPAGES) ||
+      !arena_init(&bc->regs_arena, NODE_ARENA_RESERVE, NODE_ARENA_HUGEPAGES))
+    return false;
+
+  bc->code = (Instr *)bc->code_arena.base;
+  bc->regs = (Value *)bc->regs_arena.base;
+  return true;
+}
+
+static inline IR_ERR bc_emit(Bytecode *bc, Opcode op, Reg dst, Reg a, Reg b) {
+  if (bc->code_len == bc->code_cap) {
+    size_t cap = arena_grow(&bc->code_arena, (size_t)bc->code_len + 1, sizeof(Instr));
+    if (cap == 0)
+      return IR_ERR_AST_MEMORY_NOT_ENOUGH;
+
+    bc->code_cap = MIN(cap, UINT32_MAX);
+  }
+
+  bc->code[bc->code_len++] = (Instr){.op = op, .dst = dst, .a = a, .b = b};
+  return IR_ERR_NOERROR;
+}
+
+IR_ERR bc_work_push(Bytecode *bc, Node_Index node) {
+  if (bc->work_len == bc->work_cap) {
+    uint32_t cap = bc->work_cap == 0 ? 64 : bc->work_cap * 2;
+    Bc_Work *work = realloc(bc->work, cap * sizeof(Bc_Work));
+    if (work == NULL)
+      return IR_ERR_ALLOC_FAILED;
+
+    bc->work = work;
+    bc->work_cap = cap;
+  }
+
+  bc->work[bc->work_len++] = (Bc_Work){.node = node, .visited = false};
+  return IR_ERR_NOERROR;
+}
+
+static inline IR_ERR bc_opd_push(Bytecode *bc, Reg reg, Bc_Operand_Kind kind) {
+  if (bc->opds_len == bc->opds_cap) {
+    uint32_t cap = bc->opds_cap == 0 ? 64 : bc->opds_cap * 2;
+    Bc_Operand *opds = realloc(bc->opds, cap * sizeof(Bc_Operand));
+    if (opds == NULL)
+      return IR_ERR_ALLOC_FAILED;
+
+    bc->opds = opds;
+    bc->opds_cap = cap;
+  }
+
+  bc->opds[bc->opds_len++] = (Bc_Operand){.reg = reg, .kind = kind, .args = 1};
+  return IR_ERR_NOERROR;
+}
+
+static inline IR_ERR bc_local_push(Bytecode *bc, sym_t sym, const Bc_Operand *o) {
+  if (bc->locals_len == bc->locals_cap) {
+    uint32_t cap = bc->locals_cap == 0 ? 16 : bc->locals_cap * 2;
+    Bc_Local *locals = realloc(bc->locals, cap * sizeof(Bc_Local));
+    if (locals == NULL)
+      return IR_ERR_ALLOC_FAILED;
+
+    bc->locals = locals;
+    bc->locals_cap = cap;
+  }
+
+  bc->locals[bc->locals_len++] = (Bc_Local){.sym = sym, .reg = o->reg, .kind = o->kind};
+  return IR_ERR_NOERROR;
+}
+
+static inline IR_ERR bc_temp(Bytecode *bc, Reg *reg) {
+  if (bc->temps_at + bc->temps_len == UINT32_MAX)
+    return IR_ERR_STACK_OVERFLOW;
+
+  *reg = bc->temps_at + bc->temps_len++;
+  bc->temps_max = MAX(bc->temps_max, bc->temps_len);
+  return IR_ERR_NOERROR;
+}
+
+// bc_mark - returns first temporary held by n top operands. Temporaries are
+// allocated in evaluation order, so all of them above mark are free once the
+// operands are consumed. Those holding locals stay below bound until end of
+// their block.
+static inline Reg bc_mark(const Bytecode *bc, uint32_t n) {
+  Reg mark = bc->temps_at + bc->temps_len;
+
+  for (uint32_t i = bc->opds_len - n; i < bc->opds_len; ++i)
+    if (bc->opds[i].reg >= bc->bound)
+      mark = MIN(mark, bc->opds[i].reg);
+
+  return mark;
+}
+
+// bc_result - replaces n top operands with a new one of kind, held in fresh
+// temporary above mark.
+static inline IR_ERR bc_result(Bytecode *bc, uint32_t n, Reg mark, Bc_Operand_Kind kind, Reg *dst) {
+  bc->opds_len -= n;
+  bc->temps_len = mark - bc->temps_at;
+
+  TRY(IR_ERR, bc_temp(bc, dst));
+  return bc_opd_push(bc, *dst, kind);
+}
+
+// bc_slot - sets \*slot to global slot of symbol named by register reg.
+static inline IR_ERR bc_slot(Bytecode *bc, Reg reg, uint32_t *slot) {
+  if (!gl_slot(bc->globals, bc->regs[reg].pm.s, slot))
+    return IR_ERR_SYM_MEMORY_NOT_ENOUGH;
+
+  return IR_ERR_NOERROR;
+}
+
+// bc_value - resolves symbol at the point where its value is consumed, to the
+// innermost local of that name or else to global.
+static inline IR_ERR bc_value(Bytecode *bc, Bc_Operand *o) {
+  uint32_t slot;
+  Reg reg;
+
+  if (o->kind != BC_OPD_SYM)
+    return IR_ERR_NOERROR;
+
+  for (uint32_t i = bc->locals_len; i-- != 0;) {
+    if (bc->locals[i].sym == bc->regs[o->reg].pm.s) {
+      o->reg = bc->locals[i].reg;
+      o->kind = bc->locals[i].kind;
+      return IR_ERR_NOERROR;
+    }
+  }
+
+  TRY(IR_ERR, bc_slot(bc, o->reg, &slot));
+  TRY(IR_ERR, bc_temp(bc, &reg));
+  TRY(IR_ERR, bc_emit(bc, OP_LDSYM, reg, slot, 0));
+  o->reg = reg;
+  o->kind = BC_OPD_ANY;
+  return IR_ERR_NOERROR;
+}
+
+// bc_underflow - fails node with fewer operands on stack than it consumes.
+// Assignment leaves no value, so it happens only when one is used as operand.
+IR_ERR bc_underflow(Bytecode *bc) {
+  if (bc->opds_len != 0)
+    TRY(IR_ERR, bc_value(bc, &bc->opds[bc->opds_len - 1]));
+
+  bc->opds_len = 0;
+  bc->temps_len = 0;
+  return bc_emit(bc, OP_FAIL, 0, IR_ERR_STACK_UNDERFLOW, 0);
+}
+
+// bc_assert_cmx - checks type of operand at run time only if it is not known
+// while compiling.
+static inline IR_ERR bc_assert_cmx(Bytecode *bc, Bc_Operand *o) {
+  switch (o->kind) {
+  case BC_OPD_ANY:
+    o->kind = BC_OPD_CMX;
+    return bc_emit(bc, OP_CHKCMX, 0, o->reg, 0);
+  case BC_OPD_PRB:
+  case BC_OPD_SYM:
+    return bc_emit(bc, OP_FAIL, 0, IR_ERR_NOT_DEFINED_FOR_TYPE, 0);
+  default:
+    return IR_ERR_NOERROR;
+  }
+}
+
+static inline IR_ERR bc_assert_sym(Bytecode *bc, Bc_Operand *o) {
+  if (o->kind != BC_OPD_SYM)
+    return bc_emit(bc, OP_FAIL, 0, IR_ERR_NOT_DEFINED_FOR_TYPE, 0);
+
+  return IR_ERR_NOERROR;
+}
+
+// bc_param - pushes parameter k of function being defined, named by symbol in
+// register sym. Parameters have no value outside of body, so guard which
+// bounds parameter by another one fails.
+static inline IR_ERR bc_param(Bytecode *bc, Reg sym, uint32_t k) {
+  if (!bc->body) {
+    TRY(IR_ERR, bc_emit(bc, OP_FAIL, 0, IR_ERR_GUARD_NOT_INTERVAL, 0));
+    return bc_opd_push(bc, sym, BC_OPD_CMX);
+  }
+
+  return bc_opd_push(bc, bc->consts_len + k,
+                     bc->params_real >> k & 1 ? BC_OPD_REAL : BC_OPD_CMX);
+}
+
+Opcode bc_op_of_nt(Node_Type nt) {
+  switch (nt) {
+  case NT_BIOP_ADD: return OP_ADD;
+  case NT_BIOP_SUB: return OP_SUB;
+  case NT_BIOP_APX: return OP_APX;
+  case NT_BIOP_MUL: return OP_MUL;
+  case NT_BIOP_QUO: return OP_QUO;
+  case NT_BIOP_MOD: return OP_MOD;
+  case NT_BIOP_POW: return OP_POW;
+  case NT_BIOP_FAC: return OP_FAC;
+  case NT_BIOP_GRE: return OP_GRE;
+  case NT_BIOP_LES: return OP_LES;
+  case NT_BIOP_GEQ: return OP_GEQ;
+  case NT_BIOP_LEQ: return OP_LEQ;
+  case NT_BIOP_EQU: return OP_EQU;
+  case NT_BIOP_NEQ: return OP_NEQ;
+  case NT_UNOP_NEG: return OP_NEG;
+  case NT_UNOP_NOT: return OP_NOT;
+  case NT_UNOP_ABS: return OP_ABS;
+  default:          return OP_FAIL;
+  }
+}
+
+// bc_real_op - returns opcode computing op of real operands in real
+// arithmetic, or op itself.
+Opcode bc_real_op(Opcode op) {
+  switch (op) {
+  case OP_ADD: return OP_RADD;
+  case OP_SUB: return OP_RSUB;
+  case OP_MUL: return OP_RMUL;
+  case OP_QUO: return OP_RQUO;
+  case OP_POW: return OP_RPOW;
+  default:     return op;
+  }
+}
+
+// bc_kind_of_op - infers kind of binary op result from kinds of operands.
+// Power of real numbers is not real in general, as that of negative one.
+Bc_Operand_Kind bc_kind_of_op(Opcode op, Bc_Operand_Kind lhs,
+                              Bc_Operand_Kind rhs) {
+  switch (op) {
+  case OP_ADD:
+  case OP_SUB:
+  case OP_MUL:
+  case OP_QUO:
+    return lhs == BC_OPD_REAL && rhs == BC_OPD_REAL ? BC_OPD_REAL : BC_OPD_CMX;
+  case OP_APX:
+    return lhs;
+  case OP_MOD:
+    return BC_OPD_REAL;
+  default:
+    return op >= OP_GRE ? BC_OPD_PRB : BC_OPD_CMX;
+  }
+}
+
+// bc_call - emits call of function named by operand below n top ones, which
+// are its arguments. Pure builtin of constants is called right away and its
+// result becomes constant. Other names call user functions, which are looked
+// up when call runs, as they may be defined later. Arguments are copied next
+// to each other unless they are already; wrong arities fail where call would
+// run.
+IR_ERR bc_call(Bytecode *bc, uint32_t n, Reg mark) {
+  Bc_Operand *fn = &bc->opds[bc->opds_len - n - 1], *args = fn + 1;
+  const Builtin *bi = fn->kind == BC_OPD_SYM ? builtin_of(bc->regs[fn->reg].pm.s) : NULL;
+  Reg f = fn->reg, b = args[0].reg, dst;
+
+  if (fn->kind != BC_OPD_SYM)
+    return bc_result(bc, n + 1, mark, BC_OPD_CMX, &dst);
+  if (bi == NULL ? n > FN_ARITY_MAX : bi->arity != n) {
+    TRY(IR_ERR, bc_emit(bc, OP_FAIL, 0, IR_ERR_ARITY_MISMATCH, 0));
+    return bc_result(bc, n + 1, mark, BC_OPD_CMX, &dst);
+  }
+
+  bool real = true, folds = bi != NULL && bi->pure, adjacent = true;
+  for (uint32_t i = 0; i < n; ++i) {
+    real &= args[i].kind == BC_OPD_REAL;
+    folds &= args[i].reg < bc->consts_len && args[i].kind != BC_OPD_PRB;
+    adjacent &= args[i].reg == b + i;
+  }
+
+  // complex arguments of real builtins are left to warn at run time
+  if (folds && (real || !bi->real_args)) {
+    Value v[BUILTIN_ARITY_MAX];
+    for (uint32_t i = 0; i < n; ++i)
+      v[i] = bc->regs[args[i].reg];
+
+    Reg k = bc->folded++;
+    builtin_exec(bi, bc->errors, v, &bc->regs[k]);
+
+    bc->opds_len -= n + 1;
+    bc->temps_len = mark - bc->temps_at;
+    return bc_opd_push(bc, k, cimag(bc->regs[k].pm.c) == 0 ? BC_OPD_REAL : BC_OPD_CMX);
+  }
+
+  if (!adjacent) {
+    TRY(IR_ERR, bc_temp(bc, &b));
+    for (uint32_t i = 1; i < n; ++i)
+      TRY(IR_ERR, bc_temp(bc, &dst));
+    for (uint32_t i = 0; i < n; ++i)
+      TRY(IR_ERR, bc_emit(bc, OP_MOV, b + i, args[i].reg, 0));
+  }
+
+  // user function may return value of any type
+  if (bi == NULL) {
+    TRY(IR_ERR, bc_result(bc, n + 1, mark, BC_OPD_ANY, &dst));
+    TRY(IR_ERR, bc_emit(bc, OP_FN, dst, f, b));
+    bc->code[bc->code_len - 1].n = n;
+    return IR_ERR_NOERROR;
+  }
+
+  TRY(IR_ERR, bc_result(bc, n + 1, mark, real && bi->real ? BC_OPD_REAL : BC_OPD_CMX, &dst));
+  return bc_emit(bc, OP_CALL, dst, f, b);
+}
+
+// bc_node - emits code of node whose operands are already on operand stack.
+// Operand stack mirrors former evaluation stack, operands are resolved and
+// checked in its order, so expressions fail with the same IR_ERR.
+IR_ERR bc_node(Bytecode *bc, const Const_Pool *cp, Node nd) {
+  Bc_Operand *lhs, *rhs;
+  Bc_Operand_Kind kind;
+  Reg mark, dst;
+  uint32_t n, slot;
+
+  switch (nd.type) {
+  case NT_PRIM_CMX:
+    kind = cimag(cp->pms[nd.as.pm].c) == 0 ? BC_OPD_REAL : BC_OPD_CMX;
+    return bc_opd_push(bc, nd.as.pm, kind);
+  case NT_PRIM_SYM:
+    for (uint32_t k = 0; k < bc->params_len; ++k)
+      if (bc->params[k] == cp->pms[nd.as.pm].s)
+        return bc_param(bc, nd.as.pm, k);
+
+    return bc_opd_push(bc, nd.as.pm, BC_OPD_SYM);
+  case NT_UNOP_NOT:
+  case NT_UNOP_NEG:
+  case NT_UNOP_ABS:
+  case NT_UNOP_NOP:
+    if (bc->opds_len < 1)
+      return bc_underflow(bc);
+
+    mark = bc_mark(bc, 1);
+    lhs = &bc->opds[bc->opds_len - 1];
+
+    TRY(IR_ERR, bc_value(bc, lhs));
+    TRY(IR_ERR, bc_assert_cmx(bc, lhs));
+
+    if (nd.type == NT_UNOP_NOP)
+      return IR_ERR_NOERROR;
+
+    // modulus is real, negation keeps real number real
+    Reg src = lhs->reg;
+    kind = nd.type == NT_UNOP_ABS ||
+                   (nd.type == NT_UNOP_NEG && lhs->kind == BC_OPD_REAL)
+               ? BC_OPD_REAL
+               : BC_OPD_CMX;
+    TRY(IR_ERR, bc_result(bc, 1, mark, kind, &dst));
+    return bc_emit(bc, bc_op_of_nt(nd.type), dst, src, 0);
+  case NT_CALL:
+    if (bc->opds_len < 2 || bc->opds[bc->opds_len - 1].args >= bc->opds_len)
+      return bc_underflow(bc);
+
+    // lists of arguments are resolved as they are joined
+    n = bc->opds[bc->opds_len - 1].args;
+    mark = bc_mark(bc, n + 1);
+    lhs = &bc->opds[bc->opds_len - n - 1];
+    rhs = &bc->opds[bc->opds_len - n];
+
+    if (n == 1)
+      TRY(IR_ERR, bc_value(bc, rhs));
+    TRY(IR_ERR, bc_assert_sym(bc, lhs));
+    if (n == 1)
+      TRY(IR_ERR, bc_assert_cmx(bc, rhs));
+
+    return bc_call(bc, n, mark);
+  case NT_BIOP_ARG:
+    if (bc->opds_len < 2 || bc->opds[bc->opds_len - 1].args >= bc->opds_len)
+      return bc_underflow(bc);
+
+    rhs = &bc->opds[bc->opds_len - 1];
+    lhs = &bc->opds[bc->opds_len - rhs->args - 1];
+    if (lhs->args + rhs->args > bc->opds_len)
+      return bc_underflow(bc);
+
+    if (rhs->args == 1)
+      TRY(IR_ERR, bc_value(bc, rhs));
+    if (lhs->args == 1)
+      TRY(IR_ERR, bc_value(bc, lhs));
+    if (rhs->args == 1)
+      TRY(IR_ERR, bc_assert_cmx(bc, rhs));
+    if (lhs->args == 1)
+      TRY(IR_ERR, bc_assert_cmx(bc, lhs));
+
+    rhs->args += lhs->args;
+    return IR_ERR_NOERROR;
+  case NT_BIOP_LET:
+    if (bc->opds_len < 2)
+      return bc_underflow(bc);
+
+    mark = bc_mark(bc, 2);
+    lhs = &bc->opds[bc->opds_len - 2];
+    rhs = &bc->opds[bc->opds_len - 1];
+
+    TRY(IR_ERR, bc_value(bc, rhs));
+    TRY(IR_ERR, bc_assert_sym(bc, lhs));
+
+    // local names register of value, kept below bound if it is temporary
+    if (bc->blocks != 0 && lhs->kind == BC_OPD_SYM) {
+      TRY(IR_ERR, bc_local_push(bc, bc->regs[lhs->reg].pm.s, rhs));
+      bc->bound = MAX(bc->bound, rhs->reg + 1);
+      bc->opds_len -= 2;
+      bc->temps_len = MAX(mark, bc->bound) - bc->temps_at;
+      return IR_ERR_NOERROR;
+    }
+
+    // code after failed assertion is emitted, but never run
+    slot = 0;
+    if (lhs->kind == BC_OPD_SYM)
+      TRY(IR_ERR, bc_slot(bc, lhs->reg, &slot));
+    TRY(IR_ERR, bc_emit(bc, OP_LET, 0, slot, rhs->reg));
+
+    // assignment has no value
+    bc->opds_len -= 2;
+    bc->temps_len = mark - bc->temps_at;
+    return IR_ERR_NOERROR;
+  case NT_BIOP_GRE:
+  case NT_BIOP_LES:
+  case NT_BIOP_GEQ:
+  case NT_BIOP_LEQ:
+  case NT_BIOP_EQU:
+  case NT_BIOP_NEQ:
+  case NT_BIOP_ADD:
+  case NT_BIOP_SUB:
+  case NT_BIOP_APX:
+  case NT_BIOP_MUL:
+  case NT_BIOP_QUO:
+  case NT_BIOP_MOD:
+  case NT_BIOP_POW:
+  case NT_BIOP_FAC:
+    if (bc->opds_len < 2)
+      return bc_underflow(bc);
+
+    mark = bc_mark(bc, 2);
+    lhs = &bc->opds[bc->opds_len - 2];
+    rhs = &bc->opds[bc->opds_len - 1];
+
+    TRY(IR_ERR, bc_value(bc, rhs));
+    TRY(IR_ERR, bc_value(bc, lhs));
+    TRY(IR_ERR, bc_assert_cmx(bc, rhs));
+    TRY(IR_ERR, bc_assert_cmx(bc, lhs));
+
+    Reg a = lhs->reg, b = rhs->reg;
+    Opcode op = bc_op_of_nt(nd.type);
+    kind = bc_kind_of_op(op, lhs->kind, rhs->kind);
+    if (lhs->kind == BC_OPD_REAL && rhs->kind == BC_OPD_REAL)
+      op = bc_real_op(op);
+
+    TRY(IR_ERR, bc_result(bc, 2, mark, kind, &dst));
+    return bc_emit(bc, op, dst, a, b);
+  default:
+    return bc_emit(bc, OP_FAIL, 0, IR_ERR_NOT_IMPLEMENTED, 0);
+  }
+}
+
+// bc_seq_open - notes state under sequence node just pushed on work stack.
+static inline void bc_seq_open(Bytecode *bc, const Parser *pr) {
+  Bc_Work *w = &bc->work[bc->work_len - 1];
+  const Bc_Work *up = bc->work_len > 1 ? w - 1 : NULL;
+
+  w->block = up == NULL || up->visited ||
+             pr->nodes[up->node].type != NT_BIOP_XPC;
+  w->opds = bc->opds_len;
+  w->locals = bc->locals_len;
+  w->bound = bc->bound;
+  w->temps = bc->temps_at + bc->temps_len;
+  bc->blocks += w->block;
+}
+
+// bc_seq_next - drops value of lhs of sequence, if it has one, checking that
+// its symbol is defined.
+static inline IR_ERR bc_seq_next(Bytecode *bc, const Bc_Work *w) {
+  if (bc->opds_len <= w->opds)
+    return IR_ERR_NOERROR;
+
+  Reg mark = bc_mark(bc, 1);
+  TRY(IR_ERR, bc_value(bc, &bc->opds[bc->opds_len - 1]));
+  --bc->opds_len;
+  bc->temps_len = mark - bc->temps_at;
+  return IR_ERR_NOERROR;
+}
+
+// bc_seq_close - ends sequence, whose value is that of its rhs. Block
+// resolves it while its locals are visible, then unbinds them, freeing their
+// registers other than that of value.
+static inline IR_ERR bc_seq_close(Bytecode *bc, const Bc_Work *w) {
+  if (!w->block)
+    return IR_ERR_NOERROR;
+
+  Reg top = w->temps;
+  if (bc->opds_len > w->opds) {
+    Bc_Operand *o = &bc->opds[bc->opds_len - 1];
+    TRY(IR_ERR, bc_value(bc, o));
+    if (o->reg >= top)
+      top = o->reg + 1;
+  }
+
+  bc->locals_len = w->locals;
+  bc->bound = w->bound;
+  bc->temps_len = MIN(top, bc->temps_at + bc->temps_len) - bc->temps_at;
+  --bc->blocks;
+  return IR_ERR_NOERROR;
+}
+
+// bc_tree - emits code of tree at node, walking it in post order on explicit
+// stack. Its value, if any, is left on operand stack.
+IR_ERR bc_tree(Bytecode *bc, const Parser *pr, Node_Index node) {
+  Node nd;
+
+descend:
+  // leaves are compiled right away, only inner nodes wait on stack
+  while (!is_prim((nd = pr->nodes[node]).type)) {
+    TRY(IR_ERR, bc_work_push(bc, node));
+    if (nd.type == NT_BIOP_XPC)
+      bc_seq_open(bc, pr);
+    node = is_unop(nd.type) ? nd.as.up.nhs : nd.as.bp.lhs;
+  }
+  TRY(IR_ERR, bc_node(bc, &pr->consts, nd));
+
+  while (bc->work_len != 0) {
+    Bc_Work *w = &bc->work[bc->work_len - 1];
+    nd = pr->nodes[w->node];
+
+    if (!w->visited && !is_unop(nd.type)) {
+      w->visited = true;
+      if (nd.type == NT_BIOP_XPC)
+        TRY(IR_ERR, bc_seq_next(bc, w));
+      node = nd.as.bp.rhs;
+      goto descend;
+    }
+
+    --bc->work_len;
+    if (nd.type == NT_BIOP_XPC) {
+      TRY(IR_ERR, bc_seq_close(bc, w));
+    } else {
+      TRY(IR_ERR, bc_node(bc, &pr->consts, nd));
+    }
+  }
+
+  return IR_ERR_NOERROR;
+}
+
+// bc_ret - emits end of code, which returns top operand if there is one.
+IR_ERR bc_ret(Bytecode *bc) {
+  if (bc->opds_len == 0)
+    return bc_emit(bc, OP_HALT, 0, 0, 0);
+
+  Bc_Operand *top = &bc->opds[bc->opds_len - 1];
+  TRY(IR_ERR, bc_value(bc, top));
+  return bc_emit(bc, OP_RET, 0, top->reg, 0);
+}
+
+// bc_param_of - sets *k to parameter named by symbol at node. Returns false if
+// node is not one.
+static inline bool bc_param_of(const Bytecode *bc, const Parser *pr,
+                               Node_Index node, uint8_t *k) {
+  Node nd = pr->nodes[node];
+  if (nd.type != NT_PRIM_SYM)
+    return false;
+
+  for (uint32_t i = 0; i < bc->params_len; ++i) {
+    if (bc->params[i] == pr->consts.pms[nd.as.pm].s) {
+      *k = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// bc_guard_of - returns relation of parameter *k to bound at *bound tested by
+// guard, or OP_FAIL if guard does not compare parameter with anything.
+Opcode bc_guard_of(const Bytecode *bc, const Parser *pr, Node_Index test,
+                   uint8_t *k, Node_Index *bound) {
+  Node nd = pr->nodes[test];
+  Opcode op = bc_op_of_nt(nd.type);
+
+  if (op < OP_GRE || op > OP_EQU)
+    return OP_FAIL;
+
+  if (bc_param_of(bc, pr, nd.as.bp.lhs, k)) {
+    *bound = nd.as.bp.rhs;
+    return op;
+  }
+
+  if (!bc_param_of(bc, pr, nd.as.bp.rhs, k))
+    return OP_FAIL;
+
+  *bound = nd.as.bp.lhs;
+  switch (op) {
+  case OP_GRE: return OP_LES;
+  case OP_LES: return OP_GRE;
+  case OP_GEQ: return OP_LEQ;
+  case OP_LEQ: return OP_GEQ;
+  default:     return op;
+  }
+}
+
+IR_ERR bc_guard_push(Bytecode *bc, Node_Index node, uint8_t k, Opcode op) {
+  Bc_Def *d = &bc->def;
+
+  if (d->guards_len == d->guards_cap) {
+    uint32_t cap = d->guards_cap == 0 ? 16 : d->guards_cap * 2;
+    Bc_Guard *guards = realloc(d->guards, cap * sizeof(Bc_Guard));
+    if (guards == NULL)
+      return IR_ERR_ALLOC_FAILED;
+
+    d->guards = guards;
+    d->guards_cap = cap;
+  }
+
+  d->guards[d->guards_len++] = (Bc_Guard){.node = node, .param = k, .op = op};
+  bc->params_real |= 1u << k;
+  return IR_ERR_NOERROR;
+}
+
+// bc_body - compiles body of function being defined into code of definition,
+// in frame with parameters after constants. Returns whether body has value.
+IR_ERR bc_body(Bytecode *bc, const Parser *pr, Node_Index body, bool *valued) {
+  Bc_Def *d = &bc->def;
+
+  bc->body = true;
+  bc->blocks = 1;
+  bc->temps_at = bc->consts_len + bc->params_len;
+  bc->bound = bc->temps_at;
+
+  TRY(IR_ERR, bc_tree(bc, pr, body));
+  *valued = bc->opds_len != 0;
+  TRY(IR_ERR, bc_ret(bc));
+
+  if (d->code_cap < bc->code_len) {
+    Instr *code = realloc(d->code, bc->code_len * sizeof(Instr));
+    if (code == NULL)
+      return IR_ERR_ALLOC_FAILED;
+
+    d->code = code;
+    d->code_cap = bc->code_len;
+  }
+
+  memcpy(d->code, bc->code, bc->code_len * sizeof(Instr));
+  d->code_len = bc->code_len;
+  d->regs_len = bc->temps_at + bc->temps_max;
+
+  // code of expression starts over
+  bc->body = false;
+  bc->blocks = 0;
+  bc->code_len = 0;
+  bc->opds_len = 0;
+  bc->temps_at = bc->consts_len;
+  bc->bound = bc->temps_at;
+  bc->temps_len = 0;
+  bc->temps_max = 0;
+  return IR_ERR_NOERROR;
+}
+
+// bc_define - emits definition of clause of user function by assignment of
+// body to head f(args) -> guards. Symbols among arguments name parameters,
+// others are values parameters are specialized on; every guard compares
+// parameter with bound, which is computed once by code of definition before
+// OP_DEF installs clause. Body is compiled apart from that code.
+IR_ERR bc_define(Bytecode *bc, const Parser *pr, Node head, Node call,
+                 Node_Index body) {
+  Bc_Def *d = &bc->def;
+  Node nd = pr->nodes[call.as.bp.lhs];
+  Node_Index args[FN_ARITY_MAX], bound;
+  uint32_t n = 0, len = 0;
+  uint8_t k;
+  Opcode op;
+  bool valued;
+
+  d->name = pr->consts.pms[nd.as.pm].s;
+  if (builtin_of(d->name) != NULL)
+    return bc_emit(bc, OP_FAIL, 0, IR_ERR_BUILTIN_REDEFINED, 0);
+
+  // lists of arguments are flattened from the left, args holding the rest
+  args[len++] = call.as.bp.rhs;
+  while (len != 0) {
+    Node_Index arg = args[--len];
+    nd = pr->nodes[arg];
+
+    if (nd.type == NT_BIOP_ARG) {
+      if (n + len + 2 > FN_ARITY_MAX)
+        return bc_emit(bc, OP_FAIL, 0, IR_ERR_ARITY_MISMATCH, 0);
+
+      args[len++] = nd.as.bp.rhs;
+      args[len++] = nd.as.bp.lhs;
+      continue;
+    }
+
+    bc->params[n++] = nd.type == NT_PRIM_SYM ? pr->consts.pms[nd.as.pm].s : 0;
+  }
+
+  d->arity = bc->params_len = n;
+  d->guards_len = 0;
+  bc->params_real = 0;
+
+  // arguments are visited once more, in order, for values
+  args[len++] = call.as.bp.rhs;
+  for (uint32_t i = 0; len != 0;) {
+    Node_Index arg = args[--len];
+    nd = pr->nodes[arg];
+
+    if (nd.type == NT_BIOP_ARG) {
+      args[len++] = nd.as.bp.rhs;
+      args[len++] = nd.as.bp.lhs;
+    } else if (bc->params[i++] == 0) {
+      TRY(IR_ERR, bc_guard_push(bc, arg, i - 1, OP_EQU));
+    }
+  }
+
+  // guards are joined from the right
+  Node_Index g = head.as.bp.rhs;
+  for (bool more = head.type == NT_BIOP_SPZ; more;) {
+    Node_Index test = g;
+    more = pr->nodes[g].type == NT_BIOP_SPZ;
+    if (more) {
+      test = pr->nodes[g].as.bp.lhs;
+      g = pr->nodes[g].as.bp.rhs;
+    }
+
+    op = bc_guard_of(bc, pr, test, &k, &bound);
+    if (op == OP_FAIL)
+      return bc_emit(bc, OP_FAIL, 0, IR_ERR_GUARD_NOT_INTERVAL, 0);
+
+    TRY(IR_ERR, bc_guard_push(bc, bound, k, op));
+  }
+
+  TRY(IR_ERR, bc_body(bc, pr, body, &valued));
+  if (!valued)
+    return bc_emit(bc, OP_FAIL, 0, IR_ERR_STACK_UNDERFLOW, 0);
+
+  // bounds stay on operand stack, so their registers stay reserved
+  bc->blocks = 1;
+  for (uint32_t i = 0; i < d->guards_len; ++i) {
+    TRY(IR_ERR, bc_tree(bc, pr, d->guards[i].node));
+    if (bc->opds_len != i + 1)
+      return bc_emit(bc, OP_FAIL, 0, IR_ERR_STACK_UNDERFLOW, 0);
+
+    Bc_Operand *top = &bc->opds[i];
+    TRY(IR_ERR, bc_value(bc, top));
+    TRY(IR_ERR, bc_assert_cmx(bc, top));
+    d->guards[i].bound = top->reg;
+  }
+
+  bc->opds_len = 0;
+  TRY(IR_ERR, bc_emit(bc, OP_DEF, 0, 0, 0));
+  return bc_emit(bc, OP_HALT, 0, 0, 0);
+}
+
+// bc_compile - lowers tree of source into register code. Constants are loaded
+// into registers once here, with errors taken as errors mode does, so code may
+// be run several times. Every call gets register for its result after them,
+// in case it is folded. Assignment to call defines user function instead.
+// Symbols are resolved to slots of globals, which new names are bound in, or
+// to registers of locals assigned in sequences.
+IR_ERR bc_compile(Bytecode *bc, const Parser *pr, Node_Index source,
+                  Errors errors, Globals *globals) {
+  Reg calls = 0;
+  for (Node_Index i = 0; i < pr->nodes_len; ++i)
+    calls += pr->nodes[i].type == NT_CALL;
+
+  bc->code_len = 0;
+  bc->work_len = 0;
+  bc->opds_len = 0;
+  bc->consts_len = pr->consts.len + calls;
+  bc->folded = pr->consts.len;
+  bc->temps_at = bc->consts_len;
+  bc->temps_len = 0;
+  bc->temps_max = 0;
+  bc->bound = bc->temps_at;
+  bc->locals_len = 0;
+  bc->blocks = 0;
+  bc->errors = errors;
+  bc->globals = globals;
+  bc->params_len = 0;
+  bc->body = false;
+
+  if (bc->consts_len != 0 &&
+      arena_grow(&bc->regs_arena, bc->consts_len, sizeof(Value)) == 0)
+    return IR_ERR_STACK_OVERFLOW;
+
+  for (Reg i = 0; i < pr->consts.len; ++i)
+    bc->regs[i] = (Value){
+        .pm = pr->consts.pms[i],
+        .rel_err = errors_const(errors, pr->consts.rel_errs[i]),
+        .type = NT_PRIM_CMX,
+    };
+  for (Reg i = pr->consts.len; i < bc->consts_len; ++i)
+    bc->regs[i] = (Value){.type = NT_PRIM_CMX};
+
+  // head of definition is call of symbol, guarded or not
+  Node nd = pr->nodes[source];
+  Node head = nd.type == NT_BIOP_LET ? pr->nodes[nd.as.bp.lhs] : nd;
+  Node call = head.type == NT_BIOP_SPZ ? pr->nodes[head.as.bp.lhs] : head;
+  if (nd.type == NT_BIOP_LET && call.type == NT_CALL &&
+      pr->nodes[call.as.bp.lhs].type == NT_PRIM_SYM) {
+    TRY(IR_ERR, bc_define(bc, pr, head, call, nd.as.bp.rhs));
+  } else {
+    TRY(IR_ERR, bc_tree(bc, pr, source));
+    TRY(IR_ERR, bc_ret(bc));
+  }
+
+  size_t regs_len = (size_t)bc->consts_len + bc->temps_max;
+  if (regs_len != 0 && arena_grow(&bc->regs_arena, regs_len, sizeof(Value)) == 0)
+    return IR_ERR_STACK_OVERFLOW;
+
+  return IR_ERR_NOERROR;
+}
+
+// bc_reset - releases memory of big previous expression.
+void bc_reset(Bytecode *bc) {
+  bc->code_len = 0;
+
+  arena_reset(&bc->code_arena, NODE_ARENA_RETAIN);
+  bc->code_cap = MIN(bc->code_arena.committed / sizeof(Instr), UINT32_MAX);
+  arena_reset(&bc->regs_arena, NODE_ARENA_RETAIN);
+}
+
+// bc_assigns - whether code of bc assigns symbols, so expressions evaluated
+// after it may depend on it.
+bool bc_assigns(const Bytecode *bc) {
+  for (uint32_t i = 0; i < bc->code_len; ++i)
+    if (bc->code[i].op == OP_LET || bc->code[i].op == OP_DEF)
+      return true;
+
+  return false;
+}
+
+void bc_free(Bytecode *bc) {
+  arena_free(&bc->code_arena);
+  arena_free(&bc->regs_arena);
+  free(bc->work);
+  free(bc->opds);
+  free(bc->locals);
+  free(bc->def.code);
+  free(bc->def.guards);
+  *bc = (Bytecode){0};
+}
+
+//=:interpreter:functions
+
+// Fn_Interval - real arguments from lo to hi, ends excluded if open.
+typedef struct {
+  double lo, hi;
+  bool lo_open, hi_open;
+} Fn_Interval;
+
+// Fn_Clause - body of user function for arguments in box, run in own frame of
+// registers: constants of defining expression, then arguments, then
+// temporaries. Parameters out of mask bounded take any argument.
+typedef struct {
+  Fn_Interval box[FN_ARITY_MAX];
+  uint32_t bounded;
+  uint32_t rank; // specificity of box, see fn_rank
+  double width;
+
+  Instr *code;
+  Value *consts;
+  Reg consts_len;
+  Reg regs_len;
+} Fn_Clause;
+
+// Fn - user function with its clauses, most specific ones first, and table
+// dispatching them on argument key. Finite ends of intervals of key cut real
+// line into pieces: gaps between cuts alternate with cuts themselves, and one
+// more piece holds arguments which are not real. Candidates of piece p are
+// cands from pieces[p] up to pieces[p + 1], the first one matching the rest of
+// arguments is called.
+typedef struct {
+  sym_t sym; // 0 if slot of Fn_Table is empty
+  uint8_t arity;
+  uint8_t key;
+
+  Fn_Clause *clauses;
+  uint32_t clauses_len;
+  uint32_t clauses_cap;
+
+  double *cuts;
+  uint32_t cuts_len;
+  uint32_t *pieces;
+  uint32_t *cands;
+} Fn;
+
+// Fn_Table - user functions by symbol, with open addressing in power of two
+// slots.
+typedef struct {
+  Fn *fns;
+  uint32_t len;
+  uint32_t cap;
+} Fn_Table;
+
+static inline bool fn_covers(const Fn_Interval *iv, double x) {
+  return (x > iv->lo || (x == iv->lo && !iv->lo_open)) &&
+         (x < iv->hi || (x == iv->hi && !iv->hi_open));
+}
+
+// fn_narrow - intersects interval with arguments x for which x op bound.
+void fn_narrow(Fn_Interval *iv, Opcode op, double bound) {
+  if ((op == OP_GRE || op == OP_GEQ || op == OP_EQU) && bound >= iv->lo) {
+    iv->lo_open = op == OP_GRE || (bound == iv->lo && iv->lo_open);
+    iv->lo = bound;
+  }
+
+  if ((op == OP_LES || op == OP_LEQ || op == OP_EQU) && bound <= iv->hi) {
+    iv->hi_open = op == OP_LES || (bound == iv->hi && iv->hi_open);
+    iv->hi = bound;
+  }
+}
+
+// fn_rank - ranks box of clause by its parameters: points before intervals
+// before rays before any value, so more specific clause has lower rank. Among
+// equal ranks, narrower intervals come first.
+void fn_rank(Fn_Clause *cl, unsigned arity) {
+  cl->rank = 0;
+  cl->width = 0;
+
+  for (unsigned k = 0; k < arity; ++k) {
+    const Fn_Interval *iv = &cl->box[k];
+    unsigned ends = isfinite(iv->lo) + isfinite(iv->hi);
+
+    if (!(cl->bounded >> k & 1)) {
+      cl->rank += 3;
+    } else if (ends == 2 && iv->lo == iv->hi) {
+      cl->rank += 0;
+    } else if (ends == 2) {
+      cl->rank += 1;
+      cl->width += iv->hi - iv->lo;
+    } else {
+      cl->rank += 3 - ends;
+    }
+  }
+}
+
+static bool fn_same_box(const Fn_Clause *a, const Fn_Clause *b,
+                        unsigned arity) {
+  if (a->bounded != b->bounded)
+    return false;
+
+  for (unsigned k = 0; k < arity; ++k) {
+    const Fn_Interval *x = &a->box[k], *y = &b->box[k];
+    if ((a->bounded >> k & 1) &&
+        (x->lo != y->lo || x->hi != y->hi || x->lo_open != y->lo_open ||
+         x->hi_open != y->hi_open))
+      return false;
+  }
+
+  return true;
+}
+
+// fn_cut - returns index of first cut of fn not below x.
+static inline uint32_t fn_cut(const Fn *fn, double x) {
+  uint32_t lo = 0, hi = fn->cuts_len;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (fn->cuts[mid] < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+// fn_span - sets first and last pieces of fn covered by interval of its key.
+// Returns false if there are none.
+static bool fn_span(const Fn *fn, const Fn_Interval *iv, uint32_t *first,
+                    uint32_t *last) {
+  if (iv->lo == INFINITY || iv->hi == -INFINITY)
+    return false;
+
+  *first = iv->lo == -INFINITY ? 0 : 2 * fn_cut(fn, iv->lo) + 1 + iv->lo_open;
+  *last = iv->hi == INFINITY ? 2 * fn->cuts_len
+                             : 2 * fn_cut(fn, iv->hi) + 1 - iv->hi_open;
+  return *first <= *last;
+}
+
+static int fn_cut_cmp(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// fn_cut_add - adds x to sorted cuts of fn unless it is there already.
+static void fn_cut_add(Fn *fn, double x) {
+  uint32_t i = fn_cut(fn, x);
+  if (i < fn->cuts_len && fn->cuts[i] == x)
+    return;
+
+  memmove(&fn->cuts[i + 1], &fn->cuts[i],
+          (fn->cuts_len - i) * sizeof(double));
+  fn->cuts[i] = x;
+  ++fn->cuts_len;
+}
+
+// fn_index - rebuilds dispatch table of fn after clause added, on parameter
+// bounded by most clauses. While that key stays, ends of added clause are
+// merged into cuts, which only grow as replaced clause has the same ends.
+// Candidates are counted per piece first, then placed in order of clauses, so
+// table is built in time of its size.
+bool fn_index(Fn *fn, const Fn_Clause *added) {
+  uint32_t counts[FN_ARITY_MAX] = {0};
+  uint32_t len = fn->clauses_len;
+  unsigned key = 0;
+
+  for (uint32_t c = 0; c < len; ++c)
+    for (unsigned k = 0; k < fn->arity; ++k)
+      counts[k] += fn->clauses[c].bounded >> k & 1;
+  for (unsigned k = 1; k < fn->arity; ++k)
+    if (counts[k] > counts[key])
+      key = k;
+
+  double *cuts = realloc(fn->cuts, (2 * (size_t)len + 1) * sizeof(double));
+  if (cuts == NULL)
+    return false;
+  fn->cuts = cuts;
+
+  if (key == fn->key) {
+    const Fn_Interval *iv = &added->box[key];
+    if ((added->bounded >> key & 1) && isfinite(iv->lo))
+      fn_cut_add(fn, iv->lo);
+    if ((added->bounded >> key & 1) && isfinite(iv->hi))
+      fn_cut_add(fn, iv->hi);
+  } else {
+    uint32_t m = 0;
+    fn->key = key;
+
+    for (uint32_t c = 0; c < len; ++c) {
+      const Fn_Clause *cl = &fn->clauses[c];
+      if (!(cl->bounded >> key & 1))
+        continue;
+
+      if (isfinite(cl->box[key].lo))
+        cuts[m++] = cl->box[key].lo;
+      if (isfinite(cl->box[key].hi))
+        cuts[m++] = cl->box[key].hi;
+    }
+
+    qsort(cuts, m, sizeof(double), fn_cut_cmp);
+    fn->cuts_len = 0;
+    for (uint32_t i = 0; i < m; ++i)
+      if (i == 0 || cuts[i] != cuts[i - 1])
+        cuts[fn->cuts_len++] = cuts[i];
+  }
+
+  // pieces of real line, then one of other arguments
+  uint32_t pieces_len = 2 * fn->cuts_len + 2;
+  uint32_t *pieces = realloc(fn->pieces, (pieces_len + 1) * sizeof(uint32_t));
+  if (pieces == NULL)
+    return false;
+  fn->pieces = pieces;
+
+  memset(pieces, 0, (pieces_len + 1) * sizeof(uint32_t));
+  for (uint32_t c = 0; c < len; ++c) {
+    const Fn_Clause *cl = &fn->clauses[c];
+    uint32_t first = 0, last = pieces_len - 1;
+
+    if ((cl->bounded >> fn->key & 1) &&
+        !fn_span(fn, &cl->box[fn->key], &first, &last))
+      continue;
+
+    ++pieces[first];
+    --pieces[last + 1];
+  }
+
+  // counts become ends of candidates of every piece
+  size_t total = 0;
+  for (uint32_t p = 0, live = 0; p < pieces_len; ++p) {
+    live += pieces[p];
+    total += live;
+    pieces[p] = total;
+  }
+  if (total > UINT32_MAX)
+    return false;
+
+  uint32_t *cands = realloc(fn->cands, MAX(total, 1) * sizeof(uint32_t));
+  if (cands == NULL)
+    return false;
+  fn->cands = cands;
+
+  for (uint32_t c = len; c-- > 0;) {
+    const Fn_Clause *cl = &fn->clauses[c];
+    uint32_t first = 0, last = pieces_len - 1;
+
+    if ((cl->bounded >> fn->key & 1) &&
+        !fn_span(fn, &cl->box[fn->key], &first, &last))
+      continue;
+
+    for (uint32_t p = first; p <= last; ++p)
+      cands[--pieces[p]] = c;
+  }
+
+  pieces[pieces_len] = total;
+  return true;
+}
+
+// fn_dispatch - returns first clause of fn matching args, or NULL if there is
+// none. Clauses are looked up in table by key argument, the rest is compared
+// with intervals of candidates only.
+static inline const Fn_Clause *fn_dispatch(const Fn *fn, const Value *args) {
+  cmx_t x = args[fn->key].pm.c;
+  uint32_t p, k;
+
+  if (cimag(x) != 0 || isnan(creal(x))) {
+    p = 2 * fn->cuts_len + 1;
+  } else {
+    k = fn_cut(fn, creal(x));
+    p = 2 * k + (k < fn->cuts_len && fn->cuts[k] == creal(x));
+  }
+
+  for (uint32_t i = fn->pieces[p]; i < fn->pieces[p + 1]; ++i) {
+    const Fn_Clause *cl = &fn->clauses[fn->cands[i]];
+    uint32_t rest = cl->bounded & ~(1u << fn->key);
+
+    for (; rest != 0; rest &= rest - 1) {
+      unsigned j = __builtin_ctz(rest);
+      cmx_t y = args[j].pm.c;
+
+      if (cimag(y) != 0 || !fn_covers(&cl->box[j], creal(y)))
+        break;
+    }
+
+    if (rest == 0)
+      return cl;
+  }
+
+  return NULL;
+}
+
+static inline uint32_t fn_slot(const Fn_Table *t, sym_t sym) {
+  uint32_t mask = t->cap - 1;
+  uint32_t i = (uint32_t)((sym * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+
+  while (t->fns[i].sym != 0 && t->fns[i].sym != sym)
+    i = (i + 1) & mask;
+
+  return i;
+}
+
+// fn_of - returns user function named by sym, or NULL if there is none.
+static inline const Fn *fn_of(const Fn_Table *t, sym_t sym) {
+  if (t->len == 0)
+    return NULL;
+
+  const Fn *fn = &t->fns[fn_slot(t, sym)];
+  return fn->sym == 0 ? NULL : fn;
+}
+
+bool fn_table_grow(Fn_Table *t) {
+  Fn_Table g = {.len = t->len, .cap = t->cap == 0 ? 16 : t->cap * 2};
+
+  g.fns = calloc(g.cap, sizeof(Fn));
+  if (g.fns == NULL)
+    return false;
+
+  for (uint32_t i = 0; i < t->cap; ++i)
+    if (t->fns[i].sym != 0)
+      g.fns[fn_slot(&g, t->fns[i].sym)] = t->fns[i];
+
+  free(t->fns);
+  *t = g;
+  return true;
+}
+
+void fn_clause_free(Fn_Clause *cl) {
+  free(cl->code);
+  free(cl->consts);
+}
+
+// fn_define - adds clause of arity to function named by sym, taking its
+// memory. It goes before clauses which are not more specific, so later
+// definition wins ties, and replaces former clause of the same box.
+IR_ERR fn_define(Fn_Table *t, sym_t sym, uint8_t arity, Fn_Clause *cl) {
+  if (2 * (t->len + 1) > t->cap && !fn_table_grow(t)) {
+    fn_clause_free(cl);
+    return IR_ERR_ALLOC_FAILED;
+  }
+
+  Fn *fn = &t->fns[fn_slot(t, sym)];
+  if (fn->sym == 0) {
+    *fn = (Fn){.sym = sym, .arity = arity};
+    ++t->len;
+  } else if (fn->arity != arity) {
+    fn_clause_free(cl);
+    return IR_ERR_ARITY_MISMATCH;
+  }
+
+  fn_rank(cl, arity);
+
+  uint32_t at = 0;
+  for (; at < fn->clauses_len; ++at) {
+    const Fn_Clause *old = &fn->clauses[at];
+    if (old->rank > cl->rank ||
+        (old->rank == cl->rank && old->width >= cl->width))
+      break;
+  }
+
+  // clause of the same box is as specific, so it is among the rest
+  for (uint32_t i = at; i < fn->clauses_len; ++i) {
+    if (fn_same_box(&fn->clauses[i], cl, arity)) {
+      fn_clause_free(&fn->clauses[i]);
+      memmove(&fn->clauses[i], &fn->clauses[i + 1],
+              (fn->clauses_len - i - 1) * sizeof(Fn_Clause));
+      --fn->clauses_len;
+      break;
+    }
+  }
+
+  if (fn->clauses_len == fn->clauses_cap) {
+    uint32_t cap = fn->clauses_cap == 0 ? 4 : fn->clauses_cap * 2;
+    Fn_Clause *clauses = realloc(fn->clauses, cap * sizeof(Fn_Clause));
+    if (clauses == NULL) {
+      fn_clause_free(cl);
+      return IR_ERR_ALLOC_FAILED;
+    }
+
+    fn->clauses = clauses;
+    fn->clauses_cap = cap;
+  }
+
+  memmove(&fn->clauses[at + 1], &fn->clauses[at],
+          (fn->clauses_len - at) * sizeof(Fn_Clause));
+  fn->clauses[at] = *cl;
+  ++fn->clauses_len;
+
+  return fn_index(fn, cl) ? IR_ERR_NOERROR : IR_ERR_ALLOC_FAILED;
+}
+
+void fn_table_free(Fn_Table *t) {
+  for (uint32_t i = 0; i < t->cap; ++i) {
+    Fn *fn = &t->fns[i];
+    if (fn->sym == 0)
+      continue;
+
+    for (uint32_t c = 0; c < fn->clauses_len; ++c)
+      fn_clause_free(&fn->clauses[c]);
+    free(fn->clauses);
+    free(fn->cuts);
+    free(fn->pieces);
+    free(fn->cands);
+  }
+
+  free(t->fns);
+  *t = (Fn_Table){0};
+}
+
+//=:interpreter:interpreter
+
+typedef struct {
+  Parser *pr;
+  Bytecode bc;
+  const Value *result; // NULL if expression has no value
+  size_t runs;         // times to run compiled code, for benchmarking
+  Errors errors;
+#ifdef X64_JIT
+  X64_Code jit_code;
+  bool jit; // whether to run expressions as machine code
+#endif
+
+  Globals globals;
+
+  Fn_Table *fns; // user functions, only read by forks sharing them
+  bool fork;     // whether fns belong to interpreter ir was forked from
+  Arena frames;  // registers of called user functions
+  size_t frames_len;
+  uint32_t depth;   // of nested calls of user functions
+  uintptr_t stack; // native stack address of outermost of them
+
+  const char *session; // file of :save and :load without one, NULL if none
+} Interpreter;
+
+IR_ERR ir_biop_exec_test_ncmx(Node_Type op, Value nlhs, Value nrhs, Value *res) {
+  double ra, rb;
+
+  cmx_t lhs = nlhs.pm.c;
+  cmx_t rhs = nrhs.pm.c;
+
+  float lhs_re = nlhs.rel_err;
+  float rhs_re = nrhs.rel_err;
+
+  if (cimag(lhs) == 0 && cimag(rhs) == 0) {
+    ra = creal(lhs);
+    rb = creal(rhs);
+  } else if (creal(lhs) == 0 && creal(rhs) == 0) {
+    ra = cimag(lhs);
+    rb = cimag(rhs);
+  } else {
+    return IR_ERR_NOT_DEFINED_FOR_TYPE;
+  }
+
+  double rt;
+
+  switch (op) {
+  case NT_BIOP_GRE: rt = ra > rb; break;
+  case NT_BIOP_LES: rt = ra < rb; break;
+  case NT_BIOP_EQU: rt = contains_interval(ra, lhs_re, rb, rhs_re); break;
+  case NT_BIOP_NEQ: rt = 1 - contains_interval(ra, lhs_re, rb, rhs_re); break;
+  default:
+    return IR_ERR_ILL_NT;
+  }
+
+  *res = (Value){.type = NT_PRIM_PRB, .pm.c = rt, .rel_err = 0};
+  return IR_ERR_NOERROR;
+}
+
+// ir_interval_cmx - bound of relative error of result rt of op on complex
+// operands. Product is rounded as compiler computes it, componentwise; errors
+// of complex division and power by libm are not known, so the latter is not
+// bounded.
+static inline float ir_interval_cmx(Node_Type op, Value nlhs, Value nrhs,
+                                    cmx_t rt) {
+  cmx_t lhs = nlhs.pm.c;
+  cmx_t rhs = nrhs.pm.c;
+
+  double lhs_re = nlhs.rel_err;
+  double rhs_re = nrhs.rel_err;
+
+  double l = cabs(lhs), r = cabs(rhs), e, s;
+  double ar = creal(lhs), ai = cimag(lhs), br = creal(rhs), bi = cimag(rhs);
+
+  switch (op) {
+  case NT_BIOP_ADD:
+    e = fabs(iv_sum_err(ar, br, creal(rt))) + fabs(iv_sum_err(ai, bi, cimag(rt)));
+    return iv_rel(l * lhs_re + r * rhs_re + e, cabs(rt));
+  case NT_BIOP_SUB:
+    e = fabs(iv_sum_err(ar, -br, creal(rt))) + fabs(iv_sum_err(ai, -bi, cimag(rt)));
+    return iv_rel(l * lhs_re + r * rhs_re + e, cabs(rt));
+  case NT_BIOP_APX:
+    return iv_rel(l * lhs_re + r * (1 + rhs_re), l);
+  case NT_BIOP_MUL: {
+    double p[] = {ar * br, ai * bi, ai * br, ar * bi};
+    if (p[0] - p[1] != creal(rt) || p[2] + p[3] != cimag(rt))
+      return INFINITY;
+
+    e = fabs(iv_prod_err(ar, br, p[0])) + fabs(iv_prod_err(ai, bi, p[1])) +
+        fabs(iv_prod_err(ai, br, p[2])) + fabs(iv_prod_err(ar, bi, p[3])) +
+        fabs(iv_sum_err(p[0], -p[1], creal(rt))) +
+        fabs(iv_sum_err(p[2], p[3], cimag(rt)));
+    s = lhs_re + rhs_re + lhs_re * rhs_re;
+    return iv_rel(l * r * s + e, cabs(rt));
+  }
+  case NT_BIOP_QUO:
+    if (!(rhs_re < 1))
+      return INFINITY;
+
+    e = iv_libm_err(cabs(rt));
+    s = (lhs_re + rhs_re) / (1 - rhs_re);
+    return iv_rel((cabs(rt) + e) * s + e, cabs(rt));
+  case NT_BIOP_MOD:
+    return iv_mod(ar, lhs_re, br, rhs_re, creal(rt));
+  case NT_BIOP_FAC:
+    return iv_fac(ar, lhs_re, br, rhs_re, creal(rt));
+  default:
+    return INFINITY;
+  }
+}
+
+// ir_interval_real - bound of relative error of result rt of op on real
+// operands.
+static inline float ir_interval_real(Node_Type op, Value nlhs, Value nrhs,
+                                     double rt) {
+  double lhs = creal(nlhs.pm.c);
+  double rhs = creal(nrhs.pm.c);
+
+  double lhs_re = nlhs.rel_err;
+  double rhs_re = nrhs.rel_err;
+
+  double e, s;
+
+  switch (op) {
+  case NT_BIOP_ADD:
+    e = iv_sum_err(lhs, rhs, rt);
+    return iv_rel(fabs(lhs) * lhs_re + fabs(rhs) * rhs_re + fabs(e), fabs(rt));
+  case NT_BIOP_SUB:
+    e = iv_sum_err(lhs, -rhs, rt);
+    return iv_rel(fabs(lhs) * lhs_re + fabs(rhs) * rhs_re + fabs(e), fabs(rt));
+  case NT_BIOP_MUL:
+    e = fabs(iv_prod_err(lhs, rhs, rt));
+    s = lhs_re + rhs_re + lhs_re * rhs_re;
+    return iv_rel((fabs(rt) + e) * s + e, fabs(rt));
+  case NT_BIOP_QUO:
+    if (!(rhs_re < 1))
+      return INFINITY;
+
+    e = iv_quo_err(lhs, rhs, rt);
+    s = (lhs_re + rhs_re) / (1 - rhs_re);
+    return iv_rel((fabs(rt) + e) * s + e, fabs(rt));
+  case NT_BIOP_POW:
+    return iv_pow(lhs, lhs_re, rhs, rhs_re, rt);
+  default:
+    return INFINITY;
+  }
+}
+
+// ir_biop_exec_cmx - executes op in complex arithmetic, propagating errors as
+// errors mode says. Called with constant op and errors, as all ir_biop_exec_*
+// are, so switches are folded away once inlined.
+static inline __attribute__((always_inline)) IR_ERR
+ir_biop_exec_cmx(Node_Type op, Errors errors, Value nlhs, Value nrhs,
+                 Value *res) {
+  cmx_t rt;
+  float rt_re = 0;
+
+  cmx_t lhs = nlhs.pm.c;
+  cmx_t rhs = nrhs.pm.c;
+
+  float lhs_re = nlhs.rel_err;
+  float rhs_re = nrhs.rel_err;
+
+  bool linear = errors == ERRORS_LINEAR;
+
+  switch (op) {
+  case NT_BIOP_ADD:
+    rt = lhs + rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re * lhs, 2) + pow(rhs_re * rhs, 2)) / fabs(rt);
+    break;
+  case NT_BIOP_SUB:
+    rt = lhs - rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re * lhs, 2) + pow(rhs_re * rhs, 2)) / fabs(rt);
+    break;
+  case NT_BIOP_APX:
+    rt = lhs;
+    if (linear)
+      rt_re = rhs / lhs;
+    break;
+  case NT_BIOP_MUL:
+    rt = lhs * rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
+    break;
+  case NT_BIOP_POW:
+    rt = pow(lhs, rhs);
+    if (linear)
+      rt_re = sqrt(pow(rhs * lhs_re, 2) + pow(log(lhs) * rhs_re, 2));
+    break;
+  case NT_BIOP_FAC:
+    rt = fac_cmx(lhs, rhs);
+    // exact operand keeps exact result, even 0! where log(0) is infinite
+    if (linear)
+      rt_re = lhs_re == 0 ? rhs_re : fabs(lhs_re * lhs * log(lhs)) + rhs_re;
+    break;
+  case NT_BIOP_QUO:
+    if (rhs == 0)
+      return IR_ERR_DIV_BY_ZERO;
+
+    rt = lhs / rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
+    break;
+  case NT_BIOP_MOD:
+    if (cimag(lhs) != 0 || cimag(rhs) != 0)
+      return IR_ERR_NOT_DEFINED_FOR_TYPE;
+
+    rt = fmod(creal(lhs), creal(rhs));
+    if (linear)
+      rt_re = lhs_re + rhs_re;
+    break;
+  default:
+    return ir_biop_exec_test_ncmx(op, nlhs, nrhs, res);
+  }
+
+  if (errors == ERRORS_INTERVAL)
+    rt_re = ir_interval_cmx(op, nlhs, nrhs, rt);
+
+  *res = (Value){.type = NT_PRIM_CMX, .pm.c = rt, .rel_err = rt_re};
+  return IR_ERR_NOERROR;
+}
+
+// ir_biop_exec_real - executes op on operands with zero imaginary parts in
+// real arithmetic, leaving operations it does not speed up, and powers whose
+// result may be complex, to ir_biop_exec_cmx.
+static inline __attribute__((always_inline)) IR_ERR
+ir_biop_exec_real(Node_Type op, Errors errors, Value nlhs, Value nrhs,
+                  Value *res) {
+  double rt, l, r;
+  float rt_re = 0;
+
+  double lhs = creal(nlhs.pm.c);
+  double rhs = creal(nrhs.pm.c);
+
+  float lhs_re = nlhs.rel_err;
+  float rhs_re = nrhs.rel_err;
+
+  bool linear = errors == ERRORS_LINEAR;
+
+  switch (op) {
+  case NT_BIOP_ADD:
+    rt = lhs + rhs;
+    if (linear) {
+      l = lhs_re * lhs;
+      r = rhs_re * rhs;
+      rt_re = sqrt(l * l + r * r) / fabs(rt);
+    }
+    break;
+  case NT_BIOP_SUB:
+    rt = lhs - rhs;
+    if (linear) {
+      l = lhs_re * lhs;
+      r = rhs_re * rhs;
+      rt_re = sqrt(l * l + r * r) / fabs(rt);
+    }
+    break;
+  case NT_BIOP_MUL:
+    rt = lhs * rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
+    break;
+  case NT_BIOP_QUO:
+    if (rhs == 0)
+      return IR_ERR_DIV_BY_ZERO;
+
+    rt = lhs / rhs;
+    if (linear)
+      rt_re = sqrt(pow(lhs_re, 2) + pow(rhs_re, 2));
+    break;
+  case NT_BIOP_POW:
+    // negative base is real only under exact integer exponent
+    if (!(lhs >= 0 || (rhs == trunc(rhs) && rhs_re == 0))) {
+      nlhs.pm.c = CMPLX(lhs, 0);
+      nrhs.pm.c = CMPLX(rhs, 0);
+      return ir_biop_exec_cmx(op, errors, nlhs, nrhs, res);
+    }
+
+    rt = pow(lhs, rhs);
+    if (linear) {
+      l = rhs * lhs_re;
+      r = rhs_re == 0 ? 0 : log(lhs) * rhs_re;
+      rt_re = sqrt(l * l + r * r);
+    }
+    break;
+  default:
+    return ir_biop_exec_cmx(op, errors, nlhs, nrhs, res);
+  }
+
+  if (errors == ERRORS_INTERVAL)
+    rt_re = ir_interval_real(op, nlhs, nrhs, rt);
+
+  *res = (Value){.type = NT_PRIM_CMX, .pm.c = rt, .rel_err = rt_re};
+  return IR_ERR_NOERROR;
+}
+
+// ir_biop_exec_ncmx - executes op on operands of any numeric type, switching
+// to real arithmetic whenever both of them are real.
+static inline __attribute__((always_inline)) IR_ERR
+ir_biop_exec_ncmx(Node_Type op, Errors errors, Value nlhs, Value nrhs,
+                  Value *res) {
+  if (cimag(nlhs.pm.c) == 0 && cimag(nrhs.pm.c) == 0)
+    return ir_biop_exec_real(op, errors, nlhs, nrhs, res);
+
+  return ir_biop_exec_cmx(op, errors, nlhs, nrhs, res);
+}
+
+// ir_unop_exec - executes unary op, but negation, under errors mode. Without
+// intervals, relative error of operand is kept.
+static inline __attribute__((always_inline)) void
+ir_unop_exec(Opcode op, Errors errors, Value v, Value *res) {
+  cmx_t x = v.pm.c;
+
+  switch (op) {
+  case OP_NOT:
+    v.pm.c = subfac_cmx(x);
+    if (errors == ERRORS_INTERVAL)
+      v.rel_err = cimag(x) != 0 ? INFINITY
+                                : iv_subfac(creal(x), v.rel_err, creal(v.pm.c));
+    break;
+  case OP_ABS:
+    v.pm.c = fabs(x);
+    // magnitude of complex number is rounded once more
+    if (errors == ERRORS_INTERVAL && cimag(x) != 0)
+      v.rel_err = iv_rel(creal(v.pm.c) * ((double)v.rel_err + 2 * IV_U),
+                         creal(v.pm.c));
+    break;
+  default:
+    break;
+  }
+
+  *res = v;
+}
+
+// Ir_Op_Fn - executes single opcode on registers at given addresses, for code
+// which cannot run it inline. Opcodes on global slots have none.
+typedef IR_ERR (*Ir_Op_Fn)(Interpreter *ir, Value *dst, Value *a, Value *b);
+
+// IR_OP_BIOP - defines ir_op_##op executing nt by exec specialized on errors
+// mode of interpreter.
+#define IR_OP_BIOP(op, exec, nt)                                        \
+  IR_ERR ir_op_##op(Interpreter *ir, Value *dst, Value *a, Value *b) {  \
+    switch (ir->errors) {                                               \
+    case ERRORS_OFF:      return exec(nt, ERRORS_OFF, *a, *b, dst);      \
+    case ERRORS_INTERVAL: return exec(nt, ERRORS_INTERVAL, *a, *b, dst); \
+    default:              return exec(nt, ERRORS_LINEAR, *a, *b, dst);   \
+    }                                                                   \
+  }
+
+IR_OP_BIOP(add, ir_biop_exec_ncmx, NT_BIOP_ADD)
+IR_OP_BIOP(sub, ir_biop_exec_ncmx, NT_BIOP_SUB)
+IR_OP_BIOP(apx, ir_biop_exec_ncmx, NT_BIOP_APX)
+IR_OP_BIOP(mul, ir_biop_exec_ncmx, NT_BIOP_MUL)
+IR_OP_BIOP(quo, ir_biop_exec_ncmx, NT_BIOP_QUO)
+IR_OP_BIOP(mod, ir_biop_exec_ncmx, NT_BIOP_MOD)
+IR_OP_BIOP(pow, ir_biop_exec_ncmx, NT_BIOP_POW)
+IR_OP_BIOP(fac, ir_biop_exec_ncmx, NT_BIOP_FAC)
+IR_OP_BIOP(gre, ir_biop_exec_ncmx, NT_BIOP_GRE)
+IR_OP_BIOP(les, ir_biop_exec_ncmx, NT_BIOP_LES)
+IR_OP_BIOP(geq, ir_biop_exec_ncmx, NT_BIOP_GEQ)
+IR_OP_BIOP(leq, ir_biop_exec_ncmx, NT_BIOP_LEQ)
+IR_OP_BIOP(equ, ir_biop_exec_ncmx, NT_BIOP_EQU)
+IR_OP_BIOP(neq, ir_biop_exec_ncmx, NT_BIOP_NEQ)
+IR_OP_BIOP(radd, ir_biop_exec_real, NT_BIOP_ADD)
+IR_OP_BIOP(rsub, ir_biop_exec_real, NT_BIOP_SUB)
+IR_OP_BIOP(rmul, ir_biop_exec_real, NT_BIOP_MUL)
+IR_OP_BIOP(rquo, ir_biop_exec_real, NT_BIOP_QUO)
+IR_OP_BIOP(rpow, ir_biop_exec_real, NT_BIOP_POW)
+
+#undef IR_OP_BIOP
+
+#define IR_OP_UNOP(op, opcode)                                          \
+  IR_ERR ir_op_##op(Interpreter *ir, Value *dst, Value *a, Value *b) {  \
+    (void)b;                                                            \
+    if (ir->errors == ERRORS_INTERVAL)                                  \
+      ir_unop_exec(opcode, ERRORS_INTERVAL, *a, dst);                   \
+    else                                                                \
+      ir_unop_exec(opcode, ERRORS_LINEAR, *a, dst);                     \
+    return IR_ERR_NOERROR;                                              \
+  }
+
+IR_OP_UNOP(not, OP_NOT)
+IR_OP_UNOP(abs, OP_ABS)
+
+#undef IR_OP_UNOP
+
+// ir_ldsym - loads value of global slot into dst.
+static inline IR_ERR ir_ldsym(const Interpreter *ir, Value *dst,
+                              uint32_t slot) {
+  const Value *v = &ir->globals.vals[slot];
+  if (v->type == NT_PRIM_SYM)
+    return IR_ERR_NOT_DEFINED_SYMBOL;
+
+  *dst = *v;
+  return IR_ERR_NOERROR;
+}
+
+IR_ERR ir_op_neg(Interpreter *ir, Value *dst, Value *a, Value *b) {
+  (void)ir, (void)b;
+  Value v = *a;
+  v.pm.c = -v.pm.c;
+  *dst = v;
+  return IR_ERR_NOERROR;
+}
+
+IR_ERR ir_op_call(Interpreter *ir, Value *dst, Value *a, Value *b) {
+  const Builtin *bi = builtin_of(a->pm.s);
+  if (bi == NULL)
+    return IR_ERR_NOT_DEFINED_SYMBOL;
+
+  builtin_exec(bi, ir->errors, b, dst);
+  return IR_ERR_NOERROR;
+}
+
+IR_ERR ir_op_mov(Interpreter *ir, Value *dst, Value *a, Value *b) {
+  (void)ir, (void)b;
+  *dst = *a;
+  return IR_ERR_NOERROR;
+}
+
+// ir_run_code - runs code with registers r, see below. Calls of user functions
+// run their bodies by it in turn.
+IR_ERR ir_run_code(Interpreter *ir, const Instr *ip, Value *r);
+
+// ir_fn_call - calls user function named by name on n arguments from args,
+// running body of its first clause matching them in new frame of registers.
+IR_ERR ir_fn_call(Interpreter *ir, Value *dst, const Value *name,
+                  const Value *args, unsigned n) {
+  const Fn *fn = fn_of(ir->fns, name->pm.s);
+  if (fn == NULL)
+    return IR_ERR_NOT_DEFINED_SYMBOL;
+  if (fn->arity != n)
+    return IR_ERR_ARITY_MISMATCH;
+
+  const Fn_Clause *cl = fn_dispatch(fn, args);
+  if (cl == NULL)
+    return IR_ERR_CLAUSE_NOT_MATCHED;
+
+  uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+  if (ir->depth == 0)
+    ir->stack = sp;
+
+  size_t at = ir->frames_len;
+  if (ir->stack - sp > FN_STACK_MAX ||
+      (ir->frames.base == NULL &&
+       !arena_init(&ir->frames, NODE_ARENA_RESERVE, NODE_ARENA_HUGEPAGES)) ||
+      arena_grow(&ir->frames, at + cl->regs_len, sizeof(Value)) == 0)
+    return IR_ERR_STACK_OVERFLOW;
+
+  Value *r = (Value *)ir->frames.base + at;
+  memcpy(r, cl->consts, cl->consts_len * sizeof(Value));
+  memcpy(r + cl->consts_len, args, n * sizeof(Value));
+
+  ir->frames_len += cl->regs_len;
+  ++ir->depth;
+  IR_ERR err = ir_run_code(ir, cl->code, r);
+  --ir->depth;
+  ir->frames_len = at;
+
+  if (err != IR_ERR_NOERROR)
+    return err;
+
+  // body always has value, or its definition failed
+  *dst = *ir->result;
+  ir->result = NULL;
+  return IR_ERR_NOERROR;
+}
+
+// ir_def - installs clause compiled with expression, with bounds of its guards
+// computed into registers, in user functions of ir.
+IR_ERR ir_def(Interpreter *ir) {
+  const Bc_Def *d = &ir->bc.def;
+  Fn_Clause cl = {.consts_len = ir->bc.consts_len, .regs_len = d->regs_len};
+
+  for (unsigned k = 0; k < d->arity; ++k)
+    cl.box[k] = (Fn_Interval){.lo = -INFINITY, .hi = INFINITY};
+
+  for (uint32_t i = 0; i < d->guards_len; ++i) {
+    const Bc_Guard *g = &d->guards[i];
+    cmx_t bound = ir->bc.regs[g->bound].pm.c;
+
+    if (cimag(bound) != 0 || isnan(creal(bound)))
+      return IR_ERR_GUARD_NOT_INTERVAL;
+
+    fn_narrow(&cl.box[g->param], g->op, creal(bound));
+    cl.bounded |= 1u << g->param;
+  }
+
+  cl.code = malloc(d->code_len * sizeof(Instr));
+  cl.consts = malloc(MAX(cl.consts_len, 1) * sizeof(Value));
+  if (cl.code == NULL || cl.consts == NULL) {
+    fn_clause_free(&cl);
+    return IR_ERR_ALLOC_FAILED;
+  }
+
+  memcpy(cl.code, d->code, d->code_len * sizeof(Instr));
+  memcpy(cl.consts, ir->bc.regs, cl.consts_len * sizeof(Value));
+  return fn_define(ir->fns, d->name, d->arity, &cl);
+}
+
+IR_ERR ir_op_def(Interpreter *ir, Value *dst, Value *a, Value *b) {
+  (void)dst, (void)a, (void)b;
+  return ir_def(ir);
+}
+
+static const Ir_Op_Fn IR_OPS[] = {
+    [OP_ADD] = ir_op_add,   [OP_SUB] = ir_op_sub,   [OP_APX] = ir_op_apx,
+    [OP_MUL] = ir_op_mul,   [OP_QUO] = ir_op_quo,   [OP_MOD] = ir_op_mod,
+    [OP_POW] = ir_op_pow,   [OP_FAC] = ir_op_fac,   [OP_GRE] = ir_op_gre,
+    [OP_LES] = ir_op_les,   [OP_GEQ] = ir_op_geq,   [OP_LEQ] = ir_op_leq,
+    [OP_EQU] = ir_op_equ,   [OP_NEQ] = ir_op_neq,   [OP_NEG] = ir_op_neg,
+    [OP_NOT] = ir_op_not,   [OP_ABS] = ir_op_abs,   [OP_CALL] = ir_op_call,
+    [OP_MOV] = ir_op_mov,   [OP_DEF] = ir_op_def,   [OP_RADD] = ir_op_radd,
+    [OP_RSUB] = ir_op_rsub, [OP_RMUL] = ir_op_rmul, [OP_RQUO] = ir_op_rquo,
+    [OP_RPOW] = ir_op_rpow,
+};
+
+// labels as values give every opcode its own indirect jump, which predicts
+// far better than single jump of switch on long mixed expressions
+#if defined(__GNUC__) && !defined(IR_DISPATCH_SWITCH)
+#define IR_THREADED
+#endif
+
+// Instructions which propagate errors have body per errors mode, so every one
+// of them is specialized on constant mode. Mode is picked once per run, by
+// table of labels or by high bits of switch.
+#ifdef IR_THREADED
+#define IR_CASE(op) L_##op:
+#define IR_CASE_E(op, e) L_##op##_##e:
+#define IR_NEXT goto *labels[(++ip)->op]
+#else
+#define IR_CASE(op)                        \
+  case op | ERRORS_OFF << 8:               \
+  case op | ERRORS_LINEAR << 8:            \
+  case op | ERRORS_INTERVAL << 8:
+#define IR_CASE_E(op, e) case op | e << 8:
+#define IR_NEXT \
+  ++ip;         \
+  continue
+#endif
+
+// IR_EACH_ERRORS - expands body(e) for every errors mode e.
+#define IR_EACH_ERRORS(body, ...) \
+  body(ERRORS_OFF, __VA_ARGS__)   \
+  body(ERRORS_LINEAR, __VA_ARGS__) \
+  body(ERRORS_INTERVAL, __VA_ARGS__)
+
+#define IR_BIOP_E(e, op, exec, nt)                                   \
+  IR_CASE_E(op, e)                                                   \
+  TRY(IR_ERR, exec(nt, e, r[ip->a], r[ip->b], &r[ip->dst]));         \
+  IR_NEXT;
+
+#define IR_BIOP(op, nt) IR_EACH_ERRORS(IR_BIOP_E, op, ir_biop_exec_ncmx, nt)
+#define IR_REAL(op, nt) IR_EACH_ERRORS(IR_BIOP_E, op, ir_biop_exec_real, nt)
+
+#define IR_UNOP_E(e, op)                         \
+  IR_CASE_E(op, e)                               \
+  ir_unop_exec(op, e, r[ip->a], &r[ip->dst]);    \
+  IR_NEXT;
+
+#define IR_UNOP(op) IR_EACH_ERRORS(IR_UNOP_E, op)
+
+// calls were checked by compiler, so slot of builtin is taken unverified
+#define IR_CALL_E(e, _)                                                   \
+  IR_CASE_E(OP_CALL, e)                                                   \
+  builtin_exec(&BUILTINS[BUILTIN_SLOT(r[ip->a].pm.s)], e, &r[ip->b],      \
+               &r[ip->dst]);                                              \
+  IR_NEXT;
+
+#define IR_LABEL(op) [op] = &&L_##op
+#define IR_LABEL_E(op, e) [op] = &&L_##op##_##e
+
+// IR_LABELS_E - row of labels for errors mode e.
+#define IR_LABELS_E(e, ...)                                                \
+  [e] = {                                                                  \
+      IR_LABEL(OP_HALT),        IR_LABEL(OP_RET),                          \
+      IR_LABEL(OP_FAIL),        IR_LABEL(OP_LDSYM),                        \
+      IR_LABEL(OP_CHKCMX),      IR_LABEL_E(OP_ADD, e),                     \
+      IR_LABEL_E(OP_SUB, e),    IR_LABEL_E(OP_APX, e),                     \
+      IR_LABEL_E(OP_MUL, e),    IR_LABEL_E(OP_QUO, e),                     \
+      IR_LABEL_E(OP_MOD, e),    IR_LABEL_E(OP_POW, e),                     \
+      IR_LABEL_E(OP_FAC, e),    IR_LABEL(OP_GRE),                          \
+      IR_LABEL(OP_LES),         IR_LABEL(OP_GEQ),                          \
+      IR_LABEL(OP_LEQ),         IR_LABEL(OP_EQU),                          \
+      IR_LABEL(OP_NEQ),         IR_LABEL(OP_NEG),                          \
+      IR_LABEL_E(OP_NOT, e),    IR_LABEL_E(OP_ABS, e),                     \
+      IR_LABEL_E(OP_CALL, e),   IR_LABEL(OP_LET),                          \
+      IR_LABEL(OP_MOV),         IR_LABEL(OP_FN),                           \
+      IR_LABEL(OP_DEF),         IR_LABEL_E(OP_RADD, e),                    \
+      IR_LABEL_E(OP_RSUB, e),   IR_LABEL_E(OP_RMUL, e),                    \
+      IR_LABEL_E(OP_RQUO, e),   IR_LABEL_E(OP_RPOW, e),                    \
+  },
+
+#ifdef IR_THREADED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// ir_run_code - executes code with registers r, setting ir->result if it
+// returns value.
+IR_ERR ir_run_code(Interpreter *ir, const Instr *ip, Value *r) {
+  Value v;
+
+#ifdef IR_THREADED
+  static const void *const IR_LABELS[][OP_RPOW + 1] = {
+      IR_EACH_ERRORS(IR_LABELS_E, _)
+  };
+  const void *const *labels = IR_LABELS[ir->errors];
+
+  goto *labels[ip->op];
+#else
+  const unsigned errors = ir->errors << 8;
+
+  for (;;) {
+    switch (ip->op | errors) {
+#endif
+
+  IR_CASE(OP_HALT)
+    return IR_ERR_NOERROR;
+  IR_CASE(OP_RET)
+    ir->result = &r[ip->a];
+    return IR_ERR_NOERROR;
+  IR_CASE(OP_FAIL)
+    return (IR_ERR)ip->a;
+  IR_CASE(OP_LDSYM)
+    TRY(IR_ERR, ir_ldsym(ir, &r[ip->dst], ip->a));
+    IR_NEXT;
+  IR_CASE(OP_CHKCMX)
+    if (r[ip->a].type != NT_PRIM_CMX)
+      return IR_ERR_NOT_DEFINED_FOR_TYPE;
+    IR_NEXT;
+  IR_BIOP(OP_ADD, NT_BIOP_ADD)
+  IR_BIOP(OP_SUB, NT_BIOP_SUB)
+  IR_BIOP(OP_APX, NT_BIOP_APX)
+  IR_BIOP(OP_MUL, NT_BIOP_MUL)
+  IR_BIOP(OP_QUO, NT_BIOP_QUO)
+  IR_BIOP(OP_MOD, NT_BIOP_MOD)
+  IR_BIOP(OP_POW, NT_BIOP_POW)
+  IR_BIOP(OP_FAC, NT_BIOP_FAC)
+  IR_CASE(OP_GRE)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_GRE, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_LES)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_LES, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_GEQ)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_GEQ, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_LEQ)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_LEQ, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_EQU)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_EQU, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_NEQ)
+    TRY(IR_ERR, ir_biop_exec_test_ncmx(NT_BIOP_NEQ, r[ip->a], r[ip->b], &r[ip->dst]));
+    IR_NEXT;
+  IR_CASE(OP_NEG)
+    v = r[ip->a];
+    v.pm.c = -v.pm.c;
+    r[ip->dst] = v;
+    IR_NEXT;
+  IR_UNOP(OP_NOT)
+  IR_UNOP(OP_ABS)
+  IR_EACH_ERRORS(IR_CALL_E, _)
+  IR_CASE(OP_LET)
+    ir->globals.vals[ip->a] = r[ip->b];
+    IR_NEXT;
+  IR_CASE(OP_MOV)
+    r[ip->dst] = r[ip->a];
+    IR_NEXT;
+  IR_CASE(OP_FN)
+    TRY(IR_ERR, ir_fn_call(ir, &r[ip->dst], &r[ip->a], &r[ip->b], ip->n));
+    IR_NEXT;
+  IR_CASE(OP_DEF)
+    TRY(IR_ERR, ir_def(ir));
+    IR_NEXT;
+  IR_REAL(OP_RADD, NT_BIOP_ADD)
+  IR_REAL(OP_RSUB, NT_BIOP_SUB)
+  IR_REAL(OP_RMUL, NT_BIOP_MUL)
+  IR_REAL(OP_RQUO, NT_BIOP_QUO)
+  IR_REAL(OP_RPOW, NT_BIOP_POW)
+
+#ifndef IR_THREADED
+    default:
+      return IR_ERR_ILL_NT;
+    }
+  }
+#endif
+}
+
+#ifdef IR_THREADED
+#pragma GCC diagnostic pop
+#endif
+
+// ir_result_canon - makes NaN parts of ir->result, in registers of ir, positive
+// quiet NaNs. Sign of NaN depends on order of operands of each instruction
+// computing it, which machine code and compiled interpreter need not share,
+// and is meaningless.
+void ir_result_canon(Interpreter *ir) {
+  Value *v = (Value *)ir->result;
+  if (v == NULL || v->type != NT_PRIM_CMX)
+    return;
+
+  double re = creal(v->pm.c), im = cimag(v->pm.c);
+  if (isnan(re) || isnan(im))
+    v->pm.c = CMPLX(isnan(re) ? NAN : re, isnan(im) ? NAN : im);
+}
+
+// ir_run - executes compiled code of expression, setting ir->result.
+IR_ERR ir_run(Interpreter *ir) {
+  ir->result = NULL;
+  TRY(IR_ERR, ir_run_code(ir, ir->bc.code, ir->bc.regs));
+  ir_result_canon(ir);
+  return IR_ERR_NOERROR;
+}
+
+#undef IR_CASE
+#undef IR_CASE_E
+#undef IR_NEXT
+#undef IR_EACH_ERRORS
+#undef IR_BIOP_E
+#undef IR_BIOP
+#undef IR_REAL
+#undef IR_UNOP_E
+#undef IR_UNOP
+#undef IR_CALL_E
+#undef IR_LABEL
+#undef IR_LABEL_E
+#undef IR_LABELS_E
+
+//=:interpreter:jit
+
+#ifdef X64_JIT
+
+// Jit_Fn - compiled expression with registers in regs, returns what ir_run
+// would.
+typedef IR_ERR (*Jit_Fn)(Value *regs, Interpreter *ir);
+
+static_assert(sizeof(Value) == 24 && offsetof(Value, rel_err) == 16 &&
+                  offsetof(Value, type) == 20,
+              "compiled code addresses fields of Value directly");
+static_assert(NT_PRIM_CMX <= INT8_MAX, "type is compared as 8 bit immediate");
+
+// Jit_Stub - out of line call of helper, taken when inline code of
+// instruction cannot produce result itself.
+typedef struct {
+  size_t jump; // offset of jump to stub
+  size_t done; // where stub returns
+  const Instr *in;
+} Jit_Stub;
+
+// Jit - state of code generation. Registers of machine are addressed from
+// rbx, interpreter is kept in r12 and r13 holds relative error and type of
+// exact complex number, to store both at once.
+typedef struct {
+  X64_Code *c;
+  Errors errors;
+  size_t epilogue;  // returns eax
+  size_t fail_type; // returns IR_ERR_NOT_DEFINED_FOR_TYPE
+  size_t fail_sym;  // returns IR_ERR_NOT_DEFINED_SYMBOL
+
+  Jit_Stub *stubs;
+  size_t stubs_len;
+  size_t stubs_cap;
+} Jit;
+
+static inline int32_t jit_reg(Reg r) { return (int32_t)(r * sizeof(Value)); }
+
+static inline void jit_emit_call(Jit *j, uint64_t fn) {
+  x64_mov_ri64(j->c, X64_RAX, fn);
+  x64_call_r(j->c, X64_RAX);
+}
+
+// jit_helper_call - calls fn with interpreter and registers dst, a and b of
+// in, failing with error it returns.
+static inline void jit_helper_call(Jit *j, const Instr *in, uint64_t fn) {
+  X64_Code *c = j->c;
+
+  x64_mov_rr(c, X64_RDI, X64_R12);
+  x64_lea(c, X64_RSI, X64_RBX, jit_reg(in->dst));
+  x64_lea(c, X64_RDX, X64_RBX, jit_reg(in->a));
+  x64_lea(c, X64_RCX, X64_RBX, jit_reg(in->b));
+  if (in->op == OP_FN)
+    x64_mov_ri32(c, X64_R8, in->n);
+  jit_emit_call(j, fn);
+  x64_test32_rr(c, X64_RAX, X64_RAX);
+  x64_bind_to(c, x64_jcc(c, X64_CC_NE), j->epilogue);
+}
+
+static inline void jit_helper(Jit *j, const Instr *in) {
+  jit_helper_call(j, in, (uintptr_t)IR_OPS[in->op]);
+}
+
+// jit_stub - defers helper call of in, jumped to from jumps at positions in
+// slow, until after all instructions, so inline code stays dense.
+void jit_stub(Jit *j, const Instr *in, const size_t *slow, size_t slow_len) {
+  X64_Code *c = j->c;
+
+  if (j->stubs_len + slow_len > j->stubs_cap) {
+    size_t cap = j->stubs_cap == 0 ? 256 : j->stubs_cap * 2;
+    Jit_Stub *stubs = realloc(j->stubs, cap * sizeof(Jit_Stub));
+    if (stubs == NULL) {
+      c->ok = false;
+      return;
+    }
+
+    j->stubs = stubs;
+    j->stubs_cap = cap;
+  }
+
+  for (size_t i = 0; i < slow_len; ++i)
+    j->stubs[j->stubs_len++] = (Jit_Stub){slow[i], c->len, in};
+}
+
+void jit_stubs_emit(Jit *j) {
+  X64_Code *c = j->c;
+  size_t start = 0;
+
+  for (size_t i = 0; i < j->stubs_len && c->ok; ++i) {
+    Jit_Stub *s = &j->stubs[i];
+
+    // stubs of one instruction are adjacent and share its call
+    if (i == 0 || s->in != s[-1].in) {
+      start = c->len;
+      jit_helper(j, s->in);
+      x64_bind_to(c, x64_jmp(c), s->done);
+    }
+
+    x64_bind_to(c, s->jump, start);
+  }
+}
+
+// jit_add - adds in SSE2 pairs. Relative error of sum of exact operands is
+// exactly zero unless result is zero or not finite, any other case is left to
+// helper. Without errors, sum is all there is.
+void jit_add(Jit *j, const Instr *in) {
+  X64_Code *c = j->c;
+  size_t slow[2];
+
+  x64_sse_mem(c, X64_MOVUPD_LOAD, 0, X64_RBX, jit_reg(in->a));
+  x64_sse_mem(c, X64_MOVUPD_LOAD, 1, X64_RBX, jit_reg(in->b));
+  x64_sse_rr(c, in->op == OP_SUB || in->op == OP_RSUB ? X64_SUBPD : X64_ADDPD,
+             0, 1);
+
+  // adding (-0, +0) keeps sum but zero imaginary part of sum of reals, which
+  // interpreter leaves +0 as real arithmetic does
+  x64_mov_ri64(c, X64_RAX, UINT64_C(1) << 63);
+  x64_sse_rr(c, X64_MOVQ_TO_XMM, 1, X64_RAX);
+  x64_sse_rr(c, X64_ADDPD, 0, 1);
+
+  if (j->errors == ERRORS_OFF) {
+    x64_sse_mem(c, X64_MOVUPD_STORE, 0, X64_RBX, jit_reg(in->dst));
+    x64_store64(c, X64_RBX, jit_reg(in->dst) + 16, X64_R13);
+    return;
+  }
+
+  // both relative errors are +-0 and result is finite, so are operands
+  x64_load32(c, X64_RAX, X64_RBX, jit_reg(in->a) + 16);
+  x64_or32(c, X64_RAX, X64_RBX, jit_reg(in->b) + 16);
+  x64_add32_rr(c, X64_RAX, X64_RAX);
+  x64_sse_rr(c, X64_MOVAPD, 1, 0);
+  x64_sse_rr(c, X64_SUBPD, 1, 0);
+  x64_cmppd(c, 1, 1, X64_CMP_UNORD);
+  x64_sse_rr(c, X64_MOVMSKPD, X64_RCX, 1);
+  x64_or32_rr(c, X64_RAX, X64_RCX);
+  slow[0] = x64_jcc(c, X64_CC_NE);
+
+  // result is not zero
+  x64_sse_rr(c, X64_XORPD, 1, 1);
+  x64_cmppd(c, 1, 0, X64_CMP_NEQ);
+  x64_sse_rr(c, X64_MOVMSKPD, X64_RAX, 1);
+  x64_test32_rr(c, X64_RAX, X64_RAX);
+  slow[1] = x64_jcc(c, X64_CC_E);
+
+  x64_sse_mem(c, X64_MOVUPD_STORE, 0, X64_RBX, jit_reg(in->dst));
+  x64_store64(c, X64_RBX, jit_reg(in->dst) + 16, X64_R13);
+  jit_stub(j, in, slow, 2);
+}
+
+// jit_mul - multiplies as compiler does for complex numbers, leaving to helper
+// only results which need recovery of infinities.
+void jit_mul(Jit *j, const Instr *in) {
+  X64_Code *c = j->c;
+  int32_t a = jit_reg(in->a), b = jit_reg(in->b), d = jit_reg(in->dst);
+
+  x64_sse_mem(c, X64_MOVSD_LOAD, 0, X64_RBX, a);
+  x64_sse_mem(c, X64_MOVSD_LOAD, 1, X64_RBX, a + 8);
+  x64_sse_mem(c, X64_MOVSD_LOAD, 2, X64_RBX, b);
+  x64_sse_mem(c, X64_MOVSD_LOAD, 3, X64_RBX, b + 8);
+
+  // interpreter multiplies reals, both imaginary parts zero, as reals: xmm6
+  // masks out terms of imaginary parts then, so zeros keep their signs
+  x64_sse_rr(c, X64_XORPD, 7, 7);
+  x64_sse_rr(c, X64_MOVAPD, 6, 1);
+  x64_cmppd(c, 6, 7, X64_CMP_EQ);
+  x64_cmppd(c, 7, 3, X64_CMP_EQ);
+  x64_sse_rr(c, X64_ANDPD, 6, 7);
+
+  // real part
+  x64_sse_rr(c, X64_MOVAPD, 4, 0);
+  x64_sse_rr(c, X64_MULSD, 4, 2);
+  x64_sse_rr(c, X64_MOVAPD, 5, 1);
+  x64_sse_rr(c, X64_MULSD, 5, 3);
+  x64_sse_rr(c, X64_MOVAPD, 7, 6);
+  x64_sse_rr(c, X64_ANDNPD, 7, 5);
+  x64_sse_rr(c, X64_SUBSD, 4, 7);
+
+  // imaginary part
+  x64_sse_rr(c, X64_MULSD, 1, 2);
+  x64_sse_rr(c, X64_MULSD, 0, 3);
+  x64_sse_rr(c, X64_ADDSD, 1, 0);
+  x64_sse_rr(c, X64_ANDNPD, 6, 1);
+  x64_sse_rr(c, X64_MOVAPD, 1, 6);
+
+  x64_sse_rr(c, X64_UCOMISD, 4, 1);
+  size_t slow = x64_jcc(c, X64_CC_P);
+
+  if (j->errors == ERRORS_OFF) {
+    x64_sse_rr(c, X64_UNPCKLPD, 4, 1);
+    x64_sse_mem(c, X64_MOVUPD_STORE, 4, X64_RBX, d);
+    x64_store64(c, X64_RBX, d + 16, X64_R13);
+    jit_stub(j, in, &slow, 1);
+    return;
+  }
+
+  // relative error is hypot of operands' ones
+  x64_sse_mem(c, X64_CVTSS2SD, 2, X64_RBX, a + 16);
+  x64_sse_mem(c, X64_CVTSS2SD, 3, X64_RBX, b + 16);
+  x64_sse_rr(c, X64_MULSD, 2, 2);
+  x64_sse_rr(c, X64_MULSD, 3, 3);
+  x64_sse_rr(c, X64_ADDSD, 2, 3);
+  x64_sse_rr(c, X64_SQRTSD, 2, 2);
+  x64_sse_rr(c, X64_CVTSD2SS, 2, 2);
+
+  x64_sse_rr(c, X64_UNPCKLPD, 4, 1);
+  x64_sse_mem(c, X64_MOVUPD_STORE, 4, X64_RBX, d);
+  x64_sse_mem(c, X64_MOVSS_STORE, 2, X64_RBX, d + 16);
+  x64_store32_imm(c, X64_RBX, d + 20, NT_PRIM_CMX);
+  jit_stub(j, in, &slow, 1);
+}
+
+void jit_neg(Jit *j, const Instr *in) {
+  X64_Code *c = j->c;
+
+  x64_mov_ri64(c, X64_RAX, UINT64_C(1) << 63);
+  x64_sse_rr(c, X64_MOVQ_TO_XMM, 1, X64_RAX);
+  x64_sse_rr(c, X64_PUNPCKLQDQ, 1, 1);
+
+  x64_sse_mem(c, X64_MOVUPD_LOAD, 0, X64_RBX, jit_reg(in->a));
+  x64_sse_rr(c, X64_XORPD, 0, 1);
+  x64_sse_mem(c, X64_MOVUPD_STORE, 0, X64_RBX, jit_reg(in->dst));
+
+  // relative error and type are kept
+  x64_load64(c, X64_RAX, X64_RBX, jit_reg(in->a) + 16);
+  x64_store64(c, X64_RBX, jit_reg(in->dst) + 16, X64_RAX);
+}
+
+// jit_call_builtin - calls builtin known at compile time right away, complex
+// argument and result are passed in xmm0 and xmm1.
+void jit_call_builtin(Jit *j, const Instr *in, Builtin_Fn fn) {
+  X64_Code *c = j->c;
+
+  x64_sse_mem(c, X64_MOVSD_LOAD, 0, X64_RBX, jit_reg(in->b));
+  x64_sse_mem(c, X64_MOVSD_LOAD, 1, X64_RBX, jit_reg(in->b) + 8);
+  jit_emit_call(j, (uintptr_t)fn);
+  x64_sse_mem(c, X64_MOVSD_STORE, 0, X64_RBX, jit_reg(in->dst));
+  x64_sse_mem(c, X64_MOVSD_STORE, 1, X64_RBX, jit_reg(in->dst) + 8);
+  x64_store64(c, X64_RBX, jit_reg(in->dst) + 16, X64_R13);
+}
+
+// jit_mov - copies register a to dst, 8 bytes at a time through rax.
+void jit_mov(Jit *j, const Instr *in) {
+  for (int32_t k = 0; k < (int32_t)sizeof(Value); k += 8) {
+    x64_load64(j->c, X64_RAX, X64_RBX, jit_reg(in->a) + k);
+    x64_store64(j->c, X64_RBX, jit_reg(in->dst) + k, X64_RAX);
+  }
+}
+
+// jit_global - loads address of global slots into rcx, from interpreter in
+// r12, as they move when new symbols are bound. Returns offset of slot, or -1
+// if it does not fit into displacement.
+static inline int32_t jit_global(Jit *j, uint32_t slot) {
+  if ((size_t)slot * sizeof(Value) > INT32_MAX - sizeof(Value)) {
+    j->c->ok = false;
+    return -1;
+  }
+
+  x64_load64(j->c, X64_RCX, X64_R12, offsetof(Interpreter, globals.vals));
+  return (int32_t)(slot * sizeof(Value));
+}
+
+// jit_ldsym - copies global slot a to dst unless symbol has no value.
+void jit_ldsym(Jit *j, const Instr *in) {
+  int32_t g = jit_global(j, in->a);
+  if (g < 0)
+    return;
+
+  x64_cmp32_imm8(j->c, X64_RCX, g + 20, NT_PRIM_SYM);
+  x64_bind_to(j->c, x64_jcc(j->c, X64_CC_E), j->fail_sym);
+  for (int32_t k = 0; k < (int32_t)sizeof(Value); k += 8) {
+    x64_load64(j->c, X64_RAX, X64_RCX, g + k);
+    x64_store64(j->c, X64_RBX, jit_reg(in->dst) + k, X64_RAX);
+  }
+}
+
+void jit_let(Jit *j, const Instr *in) {
+  int32_t g = jit_global(j, in->a);
+  if (g < 0)
+    return;
+
+  for (int32_t k = 0; k < (int32_t)sizeof(Value); k += 8) {
+    x64_load64(j->c, X64_RAX, X64_RBX, jit_reg(in->b) + k);
+    x64_store64(j->c, X64_RCX, g + k, X64_RAX);
+  }
+}
+
+void jit_instr(Jit *j, const Bytecode *bc, const Instr *in) {
+  X64_Code *c = j->c;
+  const Builtin *bi;
+
+  // bounds of intervals are left to helpers
+  bool interval = j->errors == ERRORS_INTERVAL;
+
+  switch ((Opcode)in->op) {
+  case OP_HALT:
+  case OP_RET:
+    x64_xor32_rr(c, X64_RAX, X64_RAX);
+    x64_bind_to(c, x64_jmp(c), j->epilogue);
+    break;
+  case OP_FAIL:
+    x64_mov_ri32(c, X64_RAX, in->a);
+    x64_bind_to(c, x64_jmp(c), j->epilogue);
+    break;
+  case OP_LDSYM:
+    jit_ldsym(j, in);
+    break;
+  case OP_LET:
+    jit_let(j, in);
+    break;
+  case OP_CHKCMX:
+    x64_cmp32_imm8(c, X64_RBX, jit_reg(in->a) + 20, NT_PRIM_CMX);
+    x64_bind_to(c, x64_jcc(c, X64_CC_NE), j->fail_type);
+    break;
+  case OP_ADD:
+  case OP_SUB:
+  case OP_RADD:
+  case OP_RSUB:
+    if (interval)
+      jit_helper(j, in);
+    else
+      jit_add(j, in);
+    break;
+  case OP_MUL:
+  case OP_RMUL:
+    if (interval)
+      jit_helper(j, in);
+    else
+      jit_mul(j, in);
+    break;
+  case OP_NEG:
+    jit_neg(j, in);
+    break;
+  case OP_CALL:
+    bi = in->a < bc->consts_len ? builtin_of(bc->regs[in->a].pm.s) : NULL;
+    if (bi != NULL && bi->arity == 1 && !interval)
+      jit_call_builtin(j, in, bi->fn);
+    else
+      jit_helper(j, in);
+    break;
+  case OP_MOV:
+    jit_mov(j, in);
+    break;
+  case OP_FN:
+    jit_helper_call(j, in, (uintptr_t)ir_fn_call);
+    break;
+  default:
+    jit_helper(j, in);
+    break;
+  }
+}
+
+// jit_compile - translates compiled code of expression into machine code.
+// Returns NULL if it is too long or does not fit, so caller falls back to
+// ir_run.
+Jit_Fn jit_compile(Interpreter *ir) {
+  const Bytecode *bc = &ir->bc;
+  X64_Code *c = &ir->jit_code;
+  Jit j = {.c = c, .errors = ir->errors};
+
+  size_t regs_len = (size_t)bc->consts_len + bc->temps_max;
+  if (bc->code_len > JIT_MAX_INSTRS || regs_len * sizeof(Value) > INT32_MAX)
+    return NULL;
+
+  if (!x64_begin(c, NODE_ARENA_RETAIN))
+    return NULL;
+
+  // three pushes keep stack aligned for calls
+  x64_push(c, X64_RBX);
+  x64_push(c, X64_R12);
+  x64_push(c, X64_R13);
+  x64_mov_rr(c, X64_RBX, X64_RDI);
+  x64_mov_rr(c, X64_R12, X64_RSI);
+  x64_mov_ri64(c, X64_R13, (uint64_t)NT_PRIM_CMX << 32);
+  size_t body = x64_jmp(c);
+
+  // exits precede code, so every jump to them is resolved right away
+  j.epilogue = c->len;
+  x64_pop(c, X64_R13);
+  x64_pop(c, X64_R12);
+  x64_pop(c, X64_RBX);
+  x64_ret(c);
+
+  j.fail_type = c->len;
+  x64_mov_ri32(c, X64_RAX, IR_ERR_NOT_DEFINED_FOR_TYPE);
+  x64_bind_to(c, x64_jmp(c), j.epilogue);
+
+  j.fail_sym = c->len;
+  x64_mov_ri32(c, X64_RAX, IR_ERR_NOT_DEFINED_SYMBOL);
+  x64_bind_to(c, x64_jmp(c), j.epilogue);
+
+  x64_bind(c, body);
+  for (uint32_t i = 0; i < bc->code_len && c->ok; ++i)
+    jit_instr(&j, bc, &bc->code[i]);
+
+  jit_stubs_emit(&j);
+  free(j.stubs);
+
+  void *entry = x64_finish(c);
+  Jit_Fn fn;
+  memcpy(&fn, &entry, sizeof(fn));
+  return fn;
+}
+
+// jit_run - runs machine code of expression, setting ir->result as ir_run.
+IR_ERR jit_run(Interpreter *ir, Jit_Fn fn) {
+  ir->result = NULL;
+  TRY(IR_ERR, fn(ir->bc.regs, ir));
+
+  const Instr *last = &ir->bc.code[ir->bc.code_len - 1];
+  if (last->op == OP_RET)
+    ir->result = &ir->bc.regs[last->a];
+
+  ir_result_canon(ir);
+  return IR_ERR_NOERROR;
+}
+
+#endif
+
+// ir_compile - compiles expression at source of tree pr, taking errors of its
+// constants as errors mode of ir does.
+IR_ERR ir_compile(Interpreter *ir, const Parser *pr, Node_Index source) {
+  return bc_compile(&ir->bc, pr, source, ir->errors, &ir->globals);
+}
+
+// ir_exec_bc - runs compiled expression ir->runs times, as machine code if
+// enabled and possible.
+IR_ERR ir_exec_bc(Interpreter *ir) {
+#ifdef X64_JIT
+  Jit_Fn fn = ir->jit ? jit_compile(ir) : NULL;
+  if (fn != NULL) {
+    for (size_t i = 0; i < ir->runs; ++i)
+      TRY(IR_ERR, jit_run(ir, fn));
+
+    return IR_ERR_NOERROR;
+  }
+#endif
+
+  for (size_t i = 0; i < ir->runs; ++i)
+    TRY(IR_ERR, ir_run(ir));
+
+  return IR_ERR_NOERROR;
+}
+
+// ir_exec - compiles expression at source of tree pr and runs it ir->runs
+// times.
+IR_ERR ir_exec(Interpreter *ir, const Parser *pr, Node_Index source) {
+  TRY(IR_ERR, ir_compile(ir, pr, source));
+  return ir_exec_bc(ir);
+}
+
+// ir_fork - initializes ir as interpreter with own parser and bytecode,
+// running expressions as src does. It has no globals until it views snapshot
+// of those of src. User functions of src are shared, as they are defined only
+// while forks are idle.
+void ir_fork(Interpreter *ir, const Interpreter *src) {
+  *ir = (Interpreter){
+      .pr = pr_new(),
+      .runs = src->runs,
+      .errors = src->errors,
+      .fns = src->fns,
+      .fork = true,
+  };
+
+  if (!bc_init(&ir->bc))
+    FATAL("cannot reserve memory for bytecode\n");
+
+#ifdef X64_JIT
+  ir->jit = src->jit;
+  if (ir->jit && !x64_init(&ir->jit_code, JIT_CODE_RESERVE))
+    FATAL("cannot reserve memory for machine code\n");
+#endif
+}
+
+void ir_free(Interpreter *ir) {
+  pr_free(ir->pr);
+  bc_free(&ir->bc);
+  gl_free(&ir->globals);
+  arena_free(&ir->frames);
+  if (!ir->fork) {
+    fn_table_free(ir->fns);
+    free(ir->fns);
+  }
+#ifdef X64_JIT
+  x64_free(&ir->jit_code);
+#endif
+}
+
+//=:interpreter:lanes
+
+// LN_BLANK - error of lane whose row is blank, it is printed as empty line.
+#define LN_BLANK UINT8_MAX
+
+#define LN_ALIGN(size) (((size) + 63) & ~(size_t)63)
+
+// Lanes - registers of compiled expression across width lanes, so a single
+// pass over bytecode evaluates it for width bindings of its free symbols.
+// Registers of bytecode come first, then one per column, then scratch one
+// which receives results of lane kernels.
+typedef struct {
+  Arena arena;
+  size_t width;
+
+  Lane_Reg *regs;
+  bool *cmx; // whether every live lane of register is complex
+  Reg regs_len;
+  Reg scratch;
+
+  sym_t *cols; // global slots of symbols naming columns
+  Reg cols_len;
+
+  uint8_t *err; // IR_ERR of every lane, failed lanes are skipped
+  uint64_t *slow;
+
+  Reg result;
+  bool valued; // false if expression has no value
+
+  Lanes_Kernels kernels; // NULL ones are left to scalar executor
+} Lanes;
+
+static inline void *ln_take(char **p, size_t size) {
+  void *q = *p;
+  *p += LN_ALIGN(size);
+  return q;
+}
+
+static inline Value ln_lane(const Lane_Reg *r, size_t i) {
+  return (Value){
+      .pm.c = CMPLX(r->re[i], r->im[i]),
+      .rel_err = r->rel_err[i],
+      .type = r->type[i],
+  };
+}
+
+static inline void ln_store(Lane_Reg *r, size_t i, Value v) {
+  r->re[i] = creal(v.pm.c);
+  r->im[i] = cimag(v.pm.c);
+  r->rel_err[i] = v.rel_err;
+  r->type[i] = v.type;
+}
+
+// ln_value - returns value of register r in lane i. Constants are taken from
+// bytecode, as symbol names do not survive as lanes of doubles.
+static inline Value ln_value(const Lanes *ln, const Bytecode *bc, Reg r,
+                             size_t i) {
+  return r < bc->consts_len ? bc->regs[r] : ln_lane(&ln->regs[r], i);
+}
+
+// ln_init - lays out lanes for compiled bc with cols_len columns, halving
+// width while registers do not fit into LANES_MEMORY. Kernels are picked by
+// errors mode; interval bounds are computed by scalar executor.
+bool ln_init(Lanes *ln, const Bytecode *bc, Reg cols_len, Errors errors) {
+  *ln = (Lanes){0};
+
+  ln->kernels = errors == ERRORS_OFF ? lanes.plain : lanes.errors;
+  if (errors == ERRORS_INTERVAL)
+    ln->kernels.add = ln->kernels.sub = ln->kernels.mul = NULL;
+
+  size_t regs_len = (size_t)bc->consts_len + bc->temps_max + cols_len + 1;
+  if (regs_len > UINT32_MAX)
+    return false;
+
+  ln->width = LANES_WIDTH;
+  while (ln->width > 8 && regs_len * ln->width * 24 > LANES_MEMORY)
+    ln->width /= 2;
+
+  size_t w = ln->width;
+  size_t size = LN_ALIGN(regs_len * sizeof(Lane_Reg)) + LN_ALIGN(regs_len) +
+                LN_ALIGN(cols_len * sizeof(sym_t)) + LN_ALIGN(w) +
+                LN_ALIGN((w + 63) / 64 * sizeof(uint64_t)) +
+                regs_len * (2 * LN_ALIGN(w * sizeof(double)) +
+                            LN_ALIGN(w * sizeof(float)) +
+                            LN_ALIGN(w * sizeof(int32_t)));
+
+  if (!arena_init(&ln->arena, NODE_ARENA_RESERVE, NODE_ARENA_HUGEPAGES) ||
+      !arena_commit(&ln->arena, size))
+    return false;
+
+  char *p = ln->arena.base;
+  ln->regs = ln_take(&p, regs_len * sizeof(Lane_Reg));
+  ln->cmx = ln_take(&p, regs_len);
+  ln->cols = ln_take(&p, cols_len * sizeof(sym_t));
+  ln->err = ln_take(&p, w);
+  ln->slow = ln_take(&p, (w + 63) / 64 * sizeof(uint64_t));
+
+  for (size_t r = 0; r < regs_len; ++r) {
+    ln->regs[r].re = ln_take(&p, w * sizeof(double));
+    ln->regs[r].im = ln_take(&p, w * sizeof(double));
+    ln->regs[r].rel_err = ln_take(&p, w * sizeof(float));
+    ln->regs[r].type = ln_take(&p, w * sizeof(int32_t));
+  }
+
+  ln->regs_len = regs_len;
+  ln->cols_len = cols_len;
+  ln->scratch = regs_len - 1;
+
+  // constants are same in every lane, so they are broadcast once
+  for (Reg r = 0; r < bc->consts_len; ++r) {
+    for (size_t i = 0; i < w; ++i)
+      ln_store(&ln->regs[r], i, bc->regs[r]);
+    ln->cmx[r] = bc->regs[r].type == NT_PRIM_CMX;
+  }
+
+  for (Reg k = 0; k < cols_len; ++k)
+    ln->cmx[ln->scratch - cols_len + k] = true;
+
+  return true;
+}
+
+void ln_free(Lanes *ln) {
+  arena_free(&ln->arena);
+  *ln = (Lanes){0};
+}
+
+static inline Lane_Reg *ln_col(Lanes *ln, Reg k) {
+  return &ln->regs[ln->scratch - ln->cols_len + k];
+}
+
+static inline void ln_fail(Lanes *ln, size_t n, IR_ERR err) {
+  for (size_t i = 0; i < n; ++i)
+    if (ln->err[i] == IR_ERR_NOERROR)
+      ln->err[i] = err;
+}
+
+// ln_exec - executes instruction in lane i by scalar executor, storing result
+// to d.
+static inline void ln_exec(Lanes *ln, Interpreter *ir, const Instr *in,
+                           Lane_Reg *d, size_t i) {
+  Value a = ln_value(ln, &ir->bc, in->a, i);
+  Value b = ln_value(ln, &ir->bc, in->b, i);
+  Value v;
+
+  IR_ERR err = IR_OPS[in->op](ir, &v, &a, &b);
+  if (err != IR_ERR_NOERROR) {
+    ln->err[i] = err;
+    return;
+  }
+
+  ln_store(d, i, v);
+}
+
+void ln_scalar(Lanes *ln, Interpreter *ir, const Instr *in, size_t n) {
+  Lane_Reg *d = &ln->regs[in->dst];
+  bool cmx = true;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (ln->err[i] != IR_ERR_NOERROR)
+      continue;
+
+    ln_exec(ln, ir, in, d, i);
+    cmx &= ln->err[i] != IR_ERR_NOERROR || d->type[i] == NT_PRIM_CMX;
+  }
+
+  ln->cmx[in->dst] = cmx;
+}
+
+// ln_call - calls builtin in every lane, on arguments gathered from registers
+// from b on.
+void ln_call(Lanes *ln, Interpreter *ir, const Instr *in, size_t n) {
+  const Builtin *bi = &BUILTINS[BUILTIN_SLOT(ir->bc.regs[in->a].pm.s)];
+  Lane_Reg *d = &ln->regs[in->dst];
+  Value args[BUILTIN_ARITY_MAX], v;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (ln->err[i] != IR_ERR_NOERROR)
+      continue;
+
+    for (unsigned k = 0; k < bi->arity; ++k)
+      args[k] = ln_value(ln, &ir->bc, in->b + k, i);
+
+    builtin_exec(bi, ir->errors, args, &v);
+    ln_store(d, i, v);
+  }
+
+  ln->cmx[in->dst] = true;
+}
+
+// ln_fn - calls user function in every lane, on arguments gathered from
+// registers from b on.
+void ln_fn(Lanes *ln, Interpreter *ir, const Instr *in, size_t n) {
+  const Value *name = &ir->bc.regs[in->a];
+  Lane_Reg *d = &ln->regs[in->dst];
+  Value args[FN_ARITY_MAX], v;
+  bool cmx = true;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (ln->err[i] != IR_ERR_NOERROR)
+      continue;
+
+    for (unsigned k = 0; k < in->n; ++k)
+      args[k] = ln_value(ln, &ir->bc, in->b + k, i);
+
+    IR_ERR err = ir_fn_call(ir, &v, name, args, in->n);
+    if (err != IR_ERR_NOERROR) {
+      ln->err[i] = err;
+      continue;
+    }
+
+    ln_store(d, i, v);
+    cmx &= v.type == NT_PRIM_CMX;
+  }
+
+  ln->cmx[in->dst] = cmx;
+}
+
+// ln_kernel - executes arithmetic instruction by lane kernel, then recomputes
+// lanes it left to scalar executor, which executes all of them if fn is NULL.
+// Result is swapped in from scratch register, as destination may alias an
+// operand.
+void ln_kernel(Lanes *ln, Interpreter *ir, const Instr *in, Lane_Fn fn,
+               size_t n) {
+  if (fn == NULL || !ln->cmx[in->a] ||
+      (in->op != OP_NEG && !ln->cmx[in->b])) {
+    ln_scalar(ln, ir, in, n);
+    return;
+  }
+
+  Lane_Reg *d = &ln->regs[ln->scratch];
+
+  size_t slow_len = fn(*d, ln->regs[in->a], ln->regs[in->b], ln->slow, n);
+  for (size_t i = 0; i < n; ++i)
+    d->type[i] = NT_PRIM_CMX;
+
+  for (size_t w = 0; slow_len != 0; ++w) {
+    for (uint64_t bits = ln->slow[w]; bits != 0; bits &= bits - 1) {
+      size_t i = w * 64 + __builtin_ctzll(bits);
+      if (ln->err[i] == IR_ERR_NOERROR)
+        ln_exec(ln, ir, in, d, i);
+      --slow_len;
+    }
+    ln->slow[w] = 0;
+  }
+
+  Lane_Reg t = ln->regs[in->dst];
+  ln->regs[in->dst] = *d;
+  *d = t;
+  ln->cmx[in->dst] = true;
+}
+
+// ln_ldsym - loads symbol from column of same slot, or else from global scope
+// into every lane. Returns false if it is not defined.
+bool ln_ldsym(Lanes *ln, Interpreter *ir, const Instr *in, size_t n) {
+  Lane_Reg *d = &ln->regs[in->dst];
+
+  for (Reg k = 0; k < ln->cols_len; ++k) {
+    if (ln->cols[k] != in->a)
+      continue;
+
+    Lane_Reg *c = ln_col(ln, k);
+    memcpy(d->re, c->re, n * sizeof(double));
+    memcpy(d->im, c->im, n * sizeof(double));
+    memcpy(d->rel_err, c->rel_err, n * sizeof(float));
+    memcpy(d->type, c->type, n * sizeof(int32_t));
+    ln->cmx[in->dst] = true;
+    return true;
+  }
+
+  Value v = ir->globals.vals[in->a];
+  if (v.type == NT_PRIM_SYM)
+    return false;
+
+  for (size_t i = 0; i < n; ++i)
+    ln_store(d, i, v);
+  ln->cmx[in->dst] = v.type == NT_PRIM_CMX;
+  return true;
+}
+
+// ln_run - runs compiled code of expression on n first lanes. Lanes which
+// fail keep their IR_ERR in ln->err instead of stopping the others.
+void ln_run(Lanes *ln, Interpreter *ir, size_t n) {
+  ln->valued = false;
+
+  for (const Instr *in = ir->bc.code;; ++in) {
+    switch ((Opcode)in->op) {
+    case OP_HALT:
+      return;
+    case OP_RET:
+      ln->result = in->a;
+      ln->valued = true;
+      return;
+    case OP_FAIL:
+      ln_fail(ln, n, (IR_ERR)in->a);
+      return;
+    case OP_LDSYM:
+      if (!ln_ldsym(ln, ir, in, n)) {
+        ln_fail(ln, n, IR_ERR_NOT_DEFINED_SYMBOL);
+        return;
+      }
+      break;
+    case OP_CHKCMX:
+      if (!ln->cmx[in->a]) {
+        for (size_t i = 0; i < n; ++i)
+          if (ln->err[i] == IR_ERR_NOERROR &&
+              ln->regs[in->a].type[i] != NT_PRIM_CMX)
+            ln->err[i] = IR_ERR_NOT_DEFINED_FOR_TYPE;
+        ln->cmx[in->a] = true;
+      }
+      break;
+    case OP_ADD:
+    case OP_RADD: ln_kernel(ln, ir, in, ln->kernels.add, n); break;
+    case OP_SUB:
+    case OP_RSUB: ln_kernel(ln, ir, in, ln->kernels.sub, n); break;
+    case OP_MUL:
+    case OP_RMUL: ln_kernel(ln, ir, in, ln->kernels.mul, n); break;
+    case OP_NEG: ln_kernel(ln, ir, in, ln->kernels.neg, n); break;
+    case OP_CALL: ln_call(ln, ir, in, n); break;
+    case OP_FN: ln_fn(ln, ir, in, n); break;
+    default:
+      ln_scalar(ln, ir, in, n);
+      break;
+    }
+  }
+}
+
+// ln_run_rows - runs compiled code once per lane with columns bound in global
+// scope, for expressions which assign and so depend on order of rows.
+void ln_run_rows(Lanes *ln, Interpreter *ir, size_t n) {
+  Lane_Reg *d = &ln->regs[ln->scratch];
+
+  ln->result = ln->scratch;
+  ln->valued = false;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (ln->err[i] != IR_ERR_NOERROR)
+      continue;
+
+    for (Reg k = 0; k < ln->cols_len; ++k)
+      ir->globals.vals[ln->cols[k]] = ln_lane(ln_col(ln, k), i);
+
+    IR_ERR err = ir_run(ir);
+    if (err != IR_ERR_NOERROR) {
+      ln->err[i] = err;
+      continue;
+    }
+
+    ln->valued = ir->result != NULL;
+    if (ln->valued)
+      ln_store(d, i, *ir->result);
+  }
+}
+
+//=:user:compiled
+
+// Mwc_Record - tree of one expression, followed by its constants, their errors
+// and its nodes as parser left them; symbols are encoded into constants, so
+// nothing is left to resolve. Line which is blank or fails to parse is kept
+// as text, parsed again only to report it.
+// Records are mapped and compiled in place, so they keep layout of Const_Pool
+// and 12 bytes of Node: 20 bytes for every constant and 12 for every operand
+// and operator. Line like x * 12 + y / 3 - sin(5) takes 272 bytes instead of
+// 24, which is the price of loading nothing but pages touched.
+typedef struct {
+  uint32_t size;       // bytes of record, multiple of MWC_ALIGN
+  uint32_t source;     // root node
+  uint32_t nodes_len;  // 0 for text
+  uint32_t consts_len; // bytes of text if it has no nodes
+} Mwc_Record;
+
+// Mwc_Header - start of compiled script, with records of its lines, or of its
+// only expression, after it. Trees are compiled to bytecode only when run, as
+// globals and errors mode are known only then.
+typedef struct {
+  char magic[4];       // MWC_MAGIC
+  uint32_t version;    // MWC_VERSION
+  uint32_t layout;     // MWC_LAYOUT of machine which wrote it
+  uint32_t flags;      // MWC_BATCH if lines are separate expressions
+  uint64_t source;     // hash of source text, 0 if it was not mapped
+  uint64_t source_len; // bytes of source text
+  uint64_t len;        // bytes of records
+  uint64_t sum;        // hash of records
+} Mwc_Header;
+
+#define MWC_MAGIC "\177MWC"
+
+// bumped whenever nodes or records change meaning
+#define MWC_VERSION (2)
+
+// sizes of stored types; top byte keeps it no palindrome, so scripts written
+// on machine of other byte order do not match
+#define MWC_LAYOUT                                                          \
+  ((uint32_t)sizeof(Node) | (uint32_t)sizeof(Primitive) << 8 |              \
+   (uint32_t)sizeof(Mwc_Record) << 16 | (uint32_t)'M' << 24)
+
+#define MWC_BATCH (1u << 0)
+
+#define MWC_ALIGN (sizeof(uint64_t))
+
+_Static_assert(sizeof(Mwc_Header) % MWC_ALIGN == 0 &&
+                   _Alignof(Primitive) <= MWC_ALIGN,
+               "records must stay aligned for constants");
+
+// Mwc - compiled script in memory, mapped from file or built in buffer.
+typedef struct {
+  char *data; // header and records, NULL if none
+  size_t len;
+  size_t cap;
+  size_t map_len; // 0 if data is buffer
+} Mwc;
+
+// mwc_hash - hashes len bytes at p word by word. Every step is bijective in
+// word, so change of any one word changes hash.
+static uint64_t mwc_hash(const char *p, size_t len, uint64_t seed) {
+  uint64_t h = seed ^ len;
+  uint64_t w;
+
+  for (; len >= sizeof w; p += sizeof w, len -= sizeof w) {
+    memcpy(&w, p, sizeof w);
+    h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 32;
+  }
+
+  w = 0;
+  memcpy(&w, p, len);
+  return map_hash((h ^ w) * 0x9E3779B97F4A7C15ull);
+}
+
+// mwc_source - hash of source text of rd as script of batch_mode or not,
+// keying its compiled script. Returns 0 if text is not mapped.
+static uint64_t mwc_source(const Reader *rd, bool batch_mode) {
+  if (rd->map_len == 0)
+    return 0;
+
+  return mwc_hash(rd->page.data, rd->map_len, MWC_VERSION << 1 | batch_mode);
+}
+
+static inline uint64_t mwc_size(uint32_t nodes_len, uint32_t consts_len) {
+  uint64_t n = (uint64_t)consts_len * (sizeof(Primitive) + sizeof(float)) +
+               (uint64_t)nodes_len * sizeof(Node);
+
+  if (nodes_len == 0)
+    n = consts_len;
+
+  return (sizeof(Mwc_Record) + n + MWC_ALIGN - 1) & ~(uint64_t)(MWC_ALIGN - 1);
+}
+
+static void mwc_put(Mwc *mwc, const void *p, size_t len) {
+  if (mwc->len + len > mwc->cap) {
+    mwc->cap = MAX(mwc->len + len, mwc->cap * 2);
+    mwc->data = (char *)realloc(mwc->data, mwc->cap);
+    assert(mwc->data != NULL && "allocation failed");
+  }
+
+  memcpy(&mwc->data[mwc->len], p, len);
+  mwc->len += len;
+}
+
+// mwc_pad - zeroes bytes up to end of record started at.
+static void mwc_pad(Mwc *mwc, size_t at) {
+  static const char zero[MWC_ALIGN];
+  const Mwc_Record *rec = (const Mwc_Record *)&mwc->data[at];
+  mwc_put(mwc, zero, at + rec->size - mwc->len);
+}
+
+// mwc_put_text - appends record of line kept as text.
+static void mwc_put_text(Mwc *mwc, const char *line, size_t len) {
+  if (len > UINT32_MAX - 2 * MWC_ALIGN)
+    FATAL("line too long to compile\n");
+
+  size_t at = mwc->len;
+  mwc_put(mwc, &(Mwc_Record){.size = mwc_size(0, len), .consts_len = len},
+          sizeof(Mwc_Record));
+  mwc_put(mwc, line, len);
+  mwc_pad(mwc, at);
+}
+
+// mwc_put_tree - appends record of tree of pr at source. Bytes of nodes the
+// parser left unused are zeroed, so same source compiles to same bytes.
+static void mwc_put_tree(Mwc *mwc, const Parser *pr, Node_Index source) {
+  uint64_t size = mwc_size(pr->nodes_len, pr->consts.len);
+  if (size > UINT32_MAX)
+    FATAL("expression too big to compile\n");
+
+  size_t at = mwc->len;
+  mwc_put(mwc,
+          &(Mwc_Record){
+              .size = size,
+              .source = source,
+              .nodes_len = pr->nodes_len,
+              .consts_len = pr->consts.len,
+          },
+          sizeof(Mwc_Record));
+  mwc_put(mwc, pr->consts.pms, pr->consts.len * sizeof(Primitive));
+  mwc_put(mwc, pr->consts.rel_errs, pr->consts.len * sizeof(float));
+
+  for (Node_Index i = 0; i < pr->nodes_len; ++i) {
+    Node nd;
+    memset(&nd, 0, sizeof nd);
+
+    nd.type = pr->nodes[i].type;
+    if (is_prim(nd.type))
+      nd.as.pm = pr->nodes[i].as.pm;
+    else if (is_unop(nd.type))
+      nd.as.up = pr->nodes[i].as.up;
+    else
+      nd.as.bp = pr->nodes[i].as.bp;
+
+    mwc_put(mwc, &nd, sizeof nd);
+  }
+
+  mwc_pad(mwc, at);
+}
+
+// mwc_tree - points tree at nodes and constants of record rec, so it can be
+// compiled as parsed one.
+static inline void mwc_tree(const Mwc_Record *rec, Parser *tree) {
+  const char *p = (const char *)(rec + 1);
+
+  tree->consts.pms = (Primitive *)p;
+  tree->consts.rel_errs = (float *)(p + rec->consts_len * sizeof(Primitive));
+  tree->consts.len = rec->consts_len;
+  tree->nodes =
+      (Node *)(p + rec->consts_len * (sizeof(Primitive) + sizeof(float)));
+  tree->nodes_len = rec->nodes_len;
+}
+
+// mwc_begin - starts compiled script in empty buffer of mwc.
+static void mwc_begin(Mwc *mwc) {
+  mwc_put(mwc, &(Mwc_Header){0}, sizeof(Mwc_Header));
+}
+
+// mwc_end - fills header of script compiled into mwc from text of rd.
+static void mwc_end(Mwc *mwc, const Reader *rd, bool batch_mode) {
+  Mwc_Header *hd = (Mwc_Header *)mwc->data;
+
+  *hd = (Mwc_Header){
+      .magic = MWC_MAGIC,
+      .version = MWC_VERSION,
+      .layout = MWC_LAYOUT,
+      .flags = batch_mode ? MWC_BATCH : 0,
+      .source = mwc_source(rd, batch_mode),
+      .source_len = rd->map_len,
+      .len = mwc->len - sizeof *hd,
+  };
+  hd->sum = mwc_hash(mwc->data + sizeof *hd, hd->len, MWC_VERSION);
+}
+
+// mwc_compile_lines - compiles every line of in into separate record, as
+// batch evaluates them.
+static void mwc_compile_lines(Parser *pr, Reader *in, Mwc *mwc) {
+  String_Buffer buf = {.data = NULL, .len = 0, .cap = 0};
+
+  char *line;
+  size_t len;
+
+  while (rd_next_line(in, &buf, &line, &len)) {
+    Node_Index source = 0;
+
+    pr_reset_line(pr, line, len);
+
+    if (scan.whitespaces(line, line + len) != line + len &&
+        pr_next_node(pr, &source) == PR_ERR_NOERROR && pr_tt(pr) == TT_EOS)
+      mwc_put_tree(mwc, pr, source);
+    else
+      mwc_put_text(mwc, line, len);
+  }
+
+  free(buf.data);
+}
+
+// mwc_check_tree - whether nodes of tree record rec are what parser leaves:
+// of known types, with operands among nodes and constants in the pool, every
+// node operand of one node at most and root of none. Reachable nodes then
+// form tree, which compiler walks to the end. parents has room for nodes.
+static bool mwc_check_tree(const Mwc_Record *rec, uint8_t *parents) {
+  Parser tree;
+  mwc_tree(rec, &tree);
+  memset(parents, 0, tree.nodes_len);
+
+  for (Node_Index i = 0; i < tree.nodes_len; ++i) {
+    const Node *nd = &tree.nodes[i];
+
+    if ((unsigned)nd->type > NT_BIOP_ARG)
+      return false;
+
+    if (is_prim(nd->type)) {
+      if (nd->as.pm >= tree.consts.len ||
+          (nd->type == NT_PRIM_SYM && tree.consts.pms[nd->as.pm].s == 0))
+        return false;
+    } else if (is_unop(nd->type)) {
+      if (nd->as.up.nhs >= tree.nodes_len || parents[nd->as.up.nhs]++ != 0)
+        return false;
+    } else if (nd->as.bp.lhs >= tree.nodes_len ||
+               nd->as.bp.rhs >= tree.nodes_len ||
+               parents[nd->as.bp.lhs]++ != 0 ||
+               parents[nd->as.bp.rhs]++ != 0) {
+      return false;
+    }
+  }
+
+  return parents[rec->source] == 0;
+}
+
+// mwc_check - returns why data of len bytes is not valid compiled script, or
+// NULL. Every record is checked to lie within data, and trees to be sound, as
+// checksum only catches damage, not edits.
+static const char *mwc_check(const char *data, size_t len) {
+  const Mwc_Header *hd = (const Mwc_Header *)data;
+
+  if (len < sizeof *hd || memcmp(hd->magic, MWC_MAGIC, sizeof hd->magic) != 0)
+    return "not compiled script";
+  if (hd->version != MWC_VERSION)
+    return "compiled by other version";
+  if (hd->layout != MWC_LAYOUT)
+    return "compiled on other machine";
+  if (hd->len != len - sizeof *hd)
+    return "truncated";
+  if (mwc_hash(data + sizeof *hd, hd->len, MWC_VERSION) != hd->sum)
+    return "checksum mismatch";
+
+  size_t recs = 0;
+  uint8_t *parents = NULL;
+  size_t parents_cap = 0;
+  const char *why = NULL;
+
+  for (size_t at = sizeof *hd; at < len; ++recs) {
+    const Mwc_Record *rec = (const Mwc_Record *)&data[at];
+
+    if (len - at < sizeof *rec || rec->size > len - at ||
+        rec->size != mwc_size(rec->nodes_len, rec->consts_len) ||
+        (rec->nodes_len != 0 && rec->source >= rec->nodes_len)) {
+      why = "corrupt record";
+      break;
+    }
+
+    if (rec->nodes_len > parents_cap) {
+      parents_cap = MAX(rec->nodes_len, 2 * parents_cap);
+      parents = (uint8_t *)realloc(parents, parents_cap);
+      if (parents == NULL)
+        FATAL("cannot allocate memory to check compiled script\n");
+    }
+
+    if (rec->nodes_len != 0 && !mwc_check_tree(rec, parents)) {
+      why = "corrupt record";
+      break;
+    }
+
+    at += rec->size;
+  }
+
+  free(parents);
+
+  if (why == NULL && !(hd->flags & MWC_BATCH) &&
+      (recs != 1 || ((const Mwc_Record *)(hd + 1))->nodes_len == 0))
+    why = "corrupt record";
+
+  return why;
+}
+
+// mwc_records - records of compiled script mwc.
+static inline char *mwc_records(const Mwc *mwc, size_t *len) {
+  *len = ((const Mwc_Header *)mwc->data)->len;
+  return mwc->data + sizeof(Mwc_Header);
+}
+
+// mwc_next_records - sets recs to the next records of rd over records of
+// compiled script, as rd_next_lines does lines.
+static bool mwc_next_records(Reader *rd, size_t size, char **recs,
+                             size_t *len) {
+  size_t at = rd->ptr;
+
+  while (at < rd->page.len && at - rd->ptr < size) {
+    at += ((const Mwc_Record *)&rd->page.data[at])->size;
+    ++rd->row;
+  }
+
+  *recs = &rd->page.data[rd->ptr];
+  *len = at - rd->ptr;
+  rd->ptr = at;
+  return *len != 0;
+}
+
+// mwc_count - number of records in first len bytes of recs.
+static size_t mwc_count(const char *recs, size_t len) {
+  size_t n = 0;
+
+  for (size_t at = 0; at < len; ++n)
+    at += ((const Mwc_Record *)&recs[at])->size;
+
+  return n;
+}
+
+// mwc_write - writes compiled script mwc to file at path. Returns false with
+// errno set on failure.
+static bool mwc_write(const Mwc *mwc, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+
+  bool ok = fwrite(mwc->data, sizeof(char), mwc->len, f) == mwc->len;
+  return fclose(f) == 0 && ok;
+}
+
+void mwc_free(Mwc *mwc) {
+#ifdef HAVE_MMAP
+  if (mwc->map_len != 0) {
+    munmap(mwc->data, mwc->map_len);
+    *mwc = (Mwc){0};
+    return;
+  }
+#endif
+
+  free(mwc->data);
+  *mwc = (Mwc){0};
+}
+
+#ifdef HAVE_MMAP
+
+// mwc_map - maps compiled script at path into mwc. Returns false if it cannot.
+static bool mwc_map(Mwc *mwc, const char *path) {
+  size_t len;
+  char *map = rd_map(path, &len);
+  if (map == NULL)
+    return false;
+
+  *mwc = (Mwc){.data = map, .len = len, .map_len = len};
+  return true;
+}
+
+// mwc_load - takes over script at path mapped by rd if it is compiled one,
+// failing on invalid one. Otherwise, if directory named by MWC_CACHE_ENV is
+// set and cached, looks there for script compiled from text of rd, returning
+// path to cache it at if there is none.
+char *mwc_load(Mwc *mwc, Reader *rd, const char *path, bool batch_mode,
+               bool cached) {
+  if (rd->map_len >= sizeof(Mwc_Header) &&
+      memcmp(rd->page.data, MWC_MAGIC, sizeof MWC_MAGIC - 1) == 0) {
+    *mwc = (Mwc){
+        .data = rd->page.data,
+        .len = rd->map_len,
+        .map_len = rd->map_len,
+    };
+    rd->page.data = NULL;
+    rd->map_len = 0;
+
+    const char *why = mwc_check(mwc->data, mwc->len);
+    if (why != NULL)
+      FATAL("%s: %s\n", path, why);
+
+    if (!(((const Mwc_Header *)mwc->data)->flags & MWC_BATCH) != !batch_mode)
+      FATAL("%s: compiled %s -b, run it so too\n", path,
+            batch_mode ? "without" : "with");
+
+    return NULL;
+  }
+
+  const char *dir = cached ? getenv(MWC_CACHE_ENV) : NULL;
+  if (dir == NULL || *dir == '\0' || rd->map_len == 0)
+    return NULL;
+
+  uint64_t source = mwc_source(rd, batch_mode);
+  size_t len = strlen(dir) + 1 + 16 + sizeof ".mwc";
+
+  char *cache = (char *)malloc(len);
+  assert(cache != NULL && "allocation failed");
+  snprintf(cache, len, "%s/%016llx.mwc", dir, (unsigned long long)source);
+
+  if (mwc_map(mwc, cache)) {
+    const Mwc_Header *hd = (const Mwc_Header *)mwc->data;
+
+    if (mwc_check(mwc->data, mwc->len) == NULL && hd->source == source &&
+        hd->source_len == rd->map_len &&
+        !(hd->flags & MWC_BATCH) == !batch_mode) {
+      free(cache);
+      return NULL;
+    }
+
+    mwc_free(mwc);
+  }
+
+  return cache;
+}
+
+// mwc_store - writes compiled script mwc to cache file, replacing it at once so
+// concurrent runs never see it partially written.
+void mwc_store(const Mwc *mwc, const char *cache) {
+  size_t len = strlen(cache) + 24;
+  char *tmp = (char *)malloc(len);
+  assert(tmp != NULL && "allocation failed");
+  snprintf(tmp, len, "%s.%ld", cache, (long)getpid());
+
+  const char *dir = getenv(MWC_CACHE_ENV);
+  if (mkdir(dir, 0777) == -1 && errno != EEXIST) {
+    WARNING("%s: cannot create cache directory\n", dir);
+  } else if (!mwc_write(mwc, tmp) || rename(tmp, cache) == -1) {
+    WARNING("%s: cannot write cached script\n", cache);
+    remove(tmp);
+  }
+
+  free(tmp);
+}
+
+#endif
+
+//=:user:session
+
+#ifdef HAVE_MMAP
+
+// Gl_Session - start of session file, with names of bound globals after it,
+// then their values in the same order, so they are restored by copying.
+typedef struct {
+  char magic[4];    // GL_SESSION_MAGIC
+  uint32_t version; // GL_SESSION_VERSION
+  uint32_t layout;  // GL_SESSION_LAYOUT of machine which wrote it
+  uint32_t len;     // bound globals
+  uint64_t sum;     // hash of names and values
+} Gl_Session;
+
+#define GL_SESSION_MAGIC "\177MWS"
+
+// bumped whenever values change meaning
+#define GL_SESSION_VERSION (1)
+
+// sizes of stored types, no palindrome as MWC_LAYOUT
+#define GL_SESSION_LAYOUT                                                   \
+  ((uint32_t)sizeof(Value) | (uint32_t)sizeof(sym_t) << 8 |                 \
+   (uint32_t)'S' << 24)
+
+_Static_assert(sizeof(Gl_Session) % _Alignof(Value) == 0 &&
+                   sizeof(sym_t) % _Alignof(Value) == 0,
+               "values of session must stay aligned");
+
+static inline uint64_t gl_session_sum(const sym_t *syms, const Value *vals,
+                                      uint32_t len) {
+  return mwc_hash((const char *)vals, len * sizeof(Value),
+                  mwc_hash((const char *)syms, len * sizeof(sym_t),
+                           GL_SESSION_VERSION));
+}
+
+// gl_save - writes bound globals of gl to session file at path, replacing it
+// at once. Returns why it failed, or NULL.
+const char *gl_save(const Globals *gl, const char *path) {
+  sym_t *syms = malloc(gl->len * sizeof(sym_t) + 1);
+  Value *vals = malloc(gl->len * sizeof(Value) + 1);
+  assert(syms != NULL && vals != NULL && "allocation failed");
+
+  Gl_Session hd = {
+      .magic = GL_SESSION_MAGIC,
+      .version = GL_SESSION_VERSION,
+      .layout = GL_SESSION_LAYOUT,
+  };
+
+  for (uint32_t i = 0; i < gl->len; ++i) {
+    if (gl->vals[i].type == NT_PRIM_SYM)
+      continue;
+
+    syms[hd.len] = gl->syms[i];
+    vals[hd.len++] = gl->vals[i];
+  }
+
+  hd.sum = gl_session_sum(syms, vals, hd.len);
+
+  size_t len = strlen(path) + 24;
+  char *tmp = malloc(len);
+  assert(tmp != NULL && "allocation failed");
+  snprintf(tmp, len, "%s.%ld", path, (long)getpid());
+
+  const char *why = NULL;
+  FILE *f = fopen(tmp, "wb");
+
+  if (f == NULL) {
+    why = strerror(errno);
+  } else {
+    bool ok = fwrite(&hd, sizeof hd, 1, f) == 1 &&
+              fwrite(syms, sizeof(sym_t), hd.len, f) == hd.len &&
+              fwrite(vals, sizeof(Value), hd.len, f) == hd.len;
+
+    if (fclose(f) != 0 || !ok || rename(tmp, path) == -1) {
+      why = strerror(errno);
+      remove(tmp);
+    }
+  }
+
+  free(tmp);
+  free(vals);
+  free(syms);
+  return why;
+}
+
+// gl_load - binds globals of gl to values of session file at path, mapping it
+// and binding them in one pass. Returns why it failed, or NULL.
+const char *gl_load(Globals *gl, const char *path) {
+  size_t len;
+  char *map = rd_map(path, &len);
+  if (map == NULL)
+    return strerror(errno);
+
+  const Gl_Session *hd = (const Gl_Session *)map;
+  const sym_t *syms = (const sym_t *)(hd + 1);
+  const Value *vals = (const Value *)(syms + (len >= sizeof *hd ? hd->len : 0));
+  const char *why = NULL;
+
+  if (len < sizeof *hd || memcmp(hd->magic, GL_SESSION_MAGIC, 4) != 0)
+    why = "not session file";
+  else if (hd->version != GL_SESSION_VERSION)
+    why = "saved by other version";
+  else if (hd->layout != GL_SESSION_LAYOUT)
+    why = "saved on other machine";
+  else if (len != sizeof *hd + (uint64_t)hd->len * (sizeof(sym_t) + sizeof(Value)))
+    why = "truncated";
+  else if (gl_session_sum(syms, vals, hd->len) != hd->sum)
+    why = "checksum mismatch";
+  else if (hd->len > UINT32_MAX / 2 - gl->len ||
+           !map_reserve(&gl->slots, hd->len, sizeof(uint32_t)) ||
+           (gl->cap < gl->len + hd->len && !gl_grow(gl, gl->len + hd->len)))
+    why = "cannot allocate global scope";
+
+  for (uint32_t i = 0; why == NULL && i < hd->len; ++i)
+    if (syms[i] == 0 || !gl_set(gl, syms[i], &vals[i]))
+      why = "corrupt symbol";
+
+  munmap(map, len);
+  return why;
+}
+
+#endif
+
+// is_command - whether line is command of REPL or batch mode, starting by ':'.
+static inline bool is_command(const char *line, size_t len) {
+  const char *p = scan.whitespaces(line, line + len);
+  return p < line + len && *p == ':';
+}
+
+// ir_command - runs command of line, ':save' or ':load' of session file named
+// after it or of ir->session, reporting errors at row.
+void ir_command(Interpreter *ir, const char *line, size_t len, size_t row) {
+  const char *end = line + len;
+  const char *cmd = scan.whitespaces(line, end) + 1;
+  const char *p = cmd;
+
+  while (p < end && !is_whitespace(*p))
+    ++p;
+
+  int cmd_len = p - cmd;
+  bool save = cmd_len == 4 && memcmp(cmd, "save", 4) == 0;
+  bool load = cmd_len == 4 && memcmp(cmd, "load", 4) == 0;
+
+  if (!save && !load) {
+    ERROR("%zu: unknown command " CLR_INTERNAL ":%.*s" CLR_RESET "\n", row,
+          cmd_len, cmd);
+    return;
+  }
+
+  p = scan.whitespaces(p, end);
+  while (end > p && is_whitespace(end[-1]))
+    --end;
+
+  char *path = p < end ? strndup(p, end - p) : NULL;
+  const char *file = path != NULL ? path : ir->session;
+
+  if (file == NULL) {
+    ERROR("%zu: :%.*s: file name expected\n", row, cmd_len, cmd);
+    return;
+  }
+
+#ifdef HAVE_MMAP
+  const char *why = save ? gl_save(&ir->globals, file)
+                         : gl_load(&ir->globals, file);
+#else
+  const char *why = "not supported on this platform";
+#endif
+
+  if (why != NULL)
+    ERROR("%zu: %s: " CLR_INTERNAL "%s" CLR_RESET "\n", row, file, why);
+
+  free(path);
+}
+
+//=:user:repl
+
+_Noreturn void repl(Interpreter *ir) {
   Node_Index source;
 
 #ifdef _READLINE_H_
@@ -1076,16 +5970,14 @@ _Noreturn void repl(Interpreter *ir) {
 
     source = 0;
     rd_reset_counters(&ir->pr->lx.rd);
-    ir->st->len = 0;
-    ir->pr->p0c = 0;
-    ir->pr->abs = false;
-    ir->pr->nodes_len = 1;
+    bc_reset(&ir->bc);
+    pr_reset(ir->pr);
 
 #ifdef _READLINE_H_
     if ((ir->pr->lx.rd.page.data = readline(REPL_PROMPT)) == NULL)
       PFATAL("cannot read line\n");
 
-    ir->pr->lx.rd.page.len = SIZE_MAX;
+    ir->pr->lx.rd.page.len = strlen(ir->pr->lx.rd.page.data);
     if (ir->pr->lx.rd.page.data[0] == '\0')
       continue;
 
@@ -1102,37 +5994,44 @@ _Noreturn void repl(Interpreter *ir) {
     ir->pr->lx.rd.page.len = (size_t)line_len;
 #endif
 
+    if (is_command(ir->pr->lx.rd.page.data, ir->pr->lx.rd.page.len)) {
+      ir_command(ir, ir->pr->lx.rd.page.data, ir->pr->lx.rd.page.len, 1);
+      continue;
+    }
+
     PR_ERR perr = pr_next_node(ir->pr, &source);
     if (perr != PR_ERR_NOERROR && perr != PR_ERR_PAREN_NOT_CLOSED) {
-      ERROR("%zu:%zu: " CLR_INTERNAL "%s" CLR_RESET
+      ERROR("%u:%u: " CLR_INTERNAL "%s" CLR_RESET
             " (%d) [token: " CLR_INTERNAL "%s" CLR_RESET " (%d)]\n",
-            ir->pr->lx.rd.row, ir->pr->lx.rd.col, pr_err_stringify(perr), perr,
-            tt_stringify(ir->pr->lx.tt), ir->pr->lx.tt);
+            pr_row(ir->pr), pr_col(ir->pr), pr_err_stringify(perr), perr,
+            tt_stringify(pr_tt(ir->pr)), pr_tt(ir->pr));
       rd_skip_line(&ir->pr->lx.rd);
       continue;
     }
 
-    if (ir->pr->lx.tt != TT_EOS) {
-      ERROR("%zu:%zu: " CLR_INTERNAL "PR_ERR_UNEXPECTED_EXPRESSION" CLR_RESET
+    if (pr_tt(ir->pr) != TT_EOS) {
+      ERROR("%u:%u: " CLR_INTERNAL "PR_ERR_UNEXPECTED_EXPRESSION" CLR_RESET
             "\n",
-            ir->pr->lx.rd.row, ir->pr->lx.rd.col);
+            pr_row(ir->pr), pr_col(ir->pr));
       ERROR(CLR_INF_MSG "consider adding ';' between expressions\n" CLR_RESET);
       continue;
     }
 
 #ifndef NDEBUG
-    nd_tree_print(ir->pr->nodes, source, SOURCE_INDENTATION,
+    nd_tree_print(ir->pr->nodes, &ir->pr->consts, source, SOURCE_INDENTATION,
                   SOURCE_INDENTATION + SOURCE_MAX_DEPTH);
 #endif
 
     for (Node_Index i = 0; i < ir->pr->nodes_len; ++i) {
       DBG_PRINT("ir->pr->nodes[%d] = %s, ", i, nt_stringify(ir->pr->nodes[i].type));
-      if (ir->pr->nodes[i].type == NT_PRIM_CMX)
-        nd_tree_print_cmx(ir->pr->nodes[i].as.pm.c, ir->pr->nodes[i].rel_err);
+      if (ir->pr->nodes[i].type == NT_PRIM_CMX) {
+        Value v = cp_value(&ir->pr->consts, ir->pr->nodes[i]);
+        nd_tree_print_cmx(v.pm.c, v.rel_err);
+      }
       printf("\n");
     }
 
-    IR_ERR ierr = ir_exec(ir);
+    IR_ERR ierr = ir_exec(ir, ir->pr, source);
     if (ierr != IR_ERR_NOERROR) {
       ERROR(CLR_INTERNAL "%s" CLR_RESET " (%d)\n", ir_err_stringify(ierr),
             ierr);
@@ -1140,114 +6039,959 @@ _Noreturn void repl(Interpreter *ir) {
     }
 
     printf(REPL_RESULT_PREFIX);
-    if (ir->st->len != 0)
+    if (ir->result != NULL)
       printf("\n");
 
-    if (ir->st->len != 0) {
-      nd_tree_print(ir->st->data, 0, SOURCE_INDENTATION,
-                    SOURCE_INDENTATION + SOURCE_MAX_DEPTH);
-    }
+    if (ir->result != NULL)
+      nd_tree_print_result(*ir->result, SOURCE_INDENTATION);
 
     printf(REPL_RESULT_SUFFIX);
   }
 }
 
+//=:user:batch
+
+void batch_print_result(const Value *result) {
+  if (result == NULL) {
+    fprintf(STREAM_OUT, "\n");
+    return;
+  }
+
+  switch (result->type) {
+  case NT_PRIM_CMX: nd_tree_print_cmx(result->pm.c, result->rel_err); break;
+  case NT_PRIM_PRB: nd_tree_print_prb(result->pm.c); break;
+  default:          fprintf(STREAM_OUT, "\n"); break;
+  }
+}
+
+// batch_tree - evaluates expression at source of tree pr as batch_line does.
+static bool batch_tree(Interpreter *ir, const Parser *pr, Node_Index source,
+                       size_t row, bool lets) {
+  IR_ERR ierr = ir_compile(ir, pr, source);
+  if (ierr == IR_ERR_NOERROR) {
+    if (!lets && bc_assigns(&ir->bc))
+      return false;
+
+    ierr = ir_exec_bc(ir);
+  }
+
+  if (ierr != IR_ERR_NOERROR) {
+    ERROR("%zu: " CLR_INTERNAL "%s" CLR_RESET " (%d)\n", row,
+          ir_err_stringify(ierr), ierr);
+    fprintf(STREAM_OUT, "\n");
+    return true;
+  }
+
+  batch_print_result(ir->result);
+  return true;
+}
+
+// batch_line - evaluates line at row as separate expression or command,
+// printing its result. Errors are reported keeping an empty result line, so
+// output stays aligned with input. Returns false without evaluating line that
+// assigns symbols or command unless lets is set.
+bool batch_line(Interpreter *ir, char *line, size_t len, size_t row,
+                bool lets) {
+  Node_Index source = 0;
+
+  bc_reset(&ir->bc);
+  pr_reset_line(ir->pr, line, len);
+
+  if (scan.whitespaces(line, line + len) == line + len) {
+    fprintf(STREAM_OUT, "\n");
+    return true;
+  }
+
+  // commands may bind anything, so they run in order as assignments do
+  if (is_command(line, len)) {
+    if (!lets)
+      return false;
+
+    ir_command(ir, line, len, row);
+    fprintf(STREAM_OUT, "\n");
+    return true;
+  }
+
+  PR_ERR perr = pr_next_node(ir->pr, &source);
+  if (perr != PR_ERR_NOERROR) {
+    ERROR("%zu:%u: " CLR_INTERNAL "%s" CLR_RESET
+          " (%d) [token: " CLR_INTERNAL "%s" CLR_RESET " (%d)]\n",
+          row, pr_col(ir->pr), pr_err_stringify(perr), perr,
+          tt_stringify(pr_tt(ir->pr)), pr_tt(ir->pr));
+    fprintf(STREAM_OUT, "\n");
+    return true;
+  }
+
+  if (pr_tt(ir->pr) != TT_EOS) {
+    ERROR("%zu:%u: " CLR_INTERNAL "PR_ERR_UNEXPECTED_EXPRESSION" CLR_RESET
+          "\n",
+          row, pr_col(ir->pr));
+    fprintf(STREAM_OUT, "\n");
+    return true;
+  }
+
+  return batch_tree(ir, ir->pr, source, row, lets);
+}
+
+// batch_record - evaluates compiled line rec at row as batch_line does, with
+// tree pointed at its nodes.
+bool batch_record(Interpreter *ir, Parser *tree, const Mwc_Record *rec,
+                  size_t row, bool lets) {
+  if (rec->nodes_len == 0)
+    return batch_line(ir, (char *)(rec + 1), rec->consts_len, row, lets);
+
+  bc_reset(&ir->bc);
+  mwc_tree(rec, tree);
+  return batch_tree(ir, tree, rec->source, row, lets);
+}
+
+// batch_records - evaluates records of compiled lines in first len bytes of
+// recs, first of them at row, as batch does lines.
+void batch_records(Interpreter *ir, char *recs, size_t len, size_t row) {
+  Parser tree = {0};
+
+  for (size_t at = 0; at < len; ++row) {
+    const Mwc_Record *rec = (const Mwc_Record *)&recs[at];
+    batch_record(ir, &tree, rec, row, true);
+    at += rec->size;
+  }
+}
+
+// batch - evaluates every line of in as separate expression, printing one
+// result per line.
+void batch(Interpreter *ir, Reader *in) {
+  String_Buffer buf = {.data = NULL, .len = 0, .cap = 0};
+
+  char *line;
+  size_t line_len;
+
+  while (rd_next_line(in, &buf, &line, &line_len))
+    batch_line(ir, line, line_len, in->row, true);
+
+  free(buf.data);
+}
+
+#ifdef HAVE_THREADS
+
+// Batch_Chunk - whole lines of input, or their records in compiled script,
+// evaluated by one worker. Its results and
+// messages are kept until chunks before it are printed.
+typedef struct {
+  char *lines;
+  size_t len;
+  size_t row;         // row of first line
+  String_Buffer copy; // lines copied from streamed input
+
+  char *out;
+  char *err;
+  size_t out_len;
+  size_t err_len;
+
+  size_t stop; // offset of first line assigning symbols, len if none
+  bool done;
+} Batch_Chunk;
+
+typedef struct Batch Batch;
+
+typedef struct {
+  Batch *b;
+  Interpreter ir;
+  String_Buffer buf;
+  pthread_t thread;
+
+  // chunks left to worker as lo | hi << 32: worker takes them from lo, idle
+  // workers steal them from hi
+  _Alignas(64) _Atomic uint64_t range;
+} Batch_Worker;
+
+struct Batch {
+  Interpreter *ir; // evaluates lines assigning symbols, owns global scope
+  Batch_Worker *workers;
+  size_t workers_len;
+  bool compiled; // chunks hold records of compiled script
+
+  // snapshot of globals of ir, replaced by ir only between rounds, under mu
+  // as round starts, and viewed by workers from round on
+  Gl_Snapshot *snap;
+
+  Batch_Chunk *chunks;
+  size_t chunks_len;
+  size_t chunks_cap;
+
+  // first chunk stopped before assignment in round, SIZE_MAX if none
+  _Atomic size_t stop;
+
+  pthread_mutex_t mu;
+  pthread_cond_t wake; // round started or batch finished
+  pthread_cond_t done; // chunk or round done
+  size_t round;
+  size_t busy; // workers still in round
+  bool quit;
+};
+
+// batch_take - sets c to next chunk of worker w, stealing it from the back of
+// other worker once w has none. Returns false when round has no chunks left.
+static bool batch_take(Batch *b, size_t w, size_t *c) {
+  for (size_t k = 0; k < b->workers_len; ++k) {
+    Batch_Worker *v = &b->workers[(w + k) % b->workers_len];
+    uint64_t r = atomic_load(&v->range);
+
+    while ((uint32_t)r < r >> 32) {
+      uint64_t lo = (uint32_t)r;
+      uint64_t hi = r >> 32;
+      uint64_t next = k == 0 ? (lo + 1) | hi << 32 : lo | (hi - 1) << 32;
+
+      if (atomic_compare_exchange_weak(&v->range, &r, next)) {
+        *c = k == 0 ? lo : hi - 1;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// batch_chunk - evaluates lines of chunk c into its buffers. Stops before
+// first line assigning symbols, or once chunk before c did so.
+static void batch_chunk(Batch_Worker *w, size_t c) {
+  Batch *b = w->b;
+  Batch_Chunk *ch = &b->chunks[c];
+  Reader rd = {.page = {.data = ch->lines, .len = ch->len, .cap = ch->len}};
+  Parser tree = {0};
+
+  char *line;
+  size_t len;
+
+  stream_out = open_memstream(&ch->out, &ch->out_len);
+  stream_err = open_memstream(&ch->err, &ch->err_len);
+  if (stream_out == NULL || stream_err == NULL)
+    PFATAL("cannot open buffers for results");
+
+  rd_reset_counters(&rd);
+
+  for (size_t at = 0;
+       c <= atomic_load_explicit(&b->stop, memory_order_relaxed) &&
+       (b->compiled ? at < ch->len : rd_next_line(&rd, &w->buf, &line, &len));
+       at = rd.ptr) {
+    if (b->compiled) {
+      const Mwc_Record *rec = (const Mwc_Record *)&ch->lines[at];
+      rd.ptr = at + rec->size;
+
+      if (batch_record(&w->ir, &tree, rec, ch->row + rd.row++, false))
+        continue;
+    } else if (batch_line(&w->ir, line, len, ch->row + rd.row - 1, false)) {
+      continue;
+    }
+
+    ch->stop = at;
+
+    size_t stop = atomic_load(&b->stop);
+    while (c < stop && !atomic_compare_exchange_weak(&b->stop, &stop, c))
+      ;
+    break;
+  }
+
+  fclose(stream_out);
+  fclose(stream_err);
+  stream_out = stream_err = NULL;
+}
+
+static void *batch_worker(void *arg) {
+  Batch_Worker *w = arg;
+  Batch *b = w->b;
+  size_t round = 0;
+  size_t c;
+
+  pthread_mutex_lock(&b->mu);
+
+  while (true) {
+    while (b->round == round && !b->quit)
+      pthread_cond_wait(&b->wake, &b->mu);
+    if (b->quit)
+      break;
+
+    round = b->round;
+    Gl_Snapshot *s = b->snap;
+    pthread_mutex_unlock(&b->mu);
+
+    // reference of b keeps s until next round, which waits for this one
+    if (w->ir.globals.snap != s)
+      gl_view(&w->ir.globals, s);
+
+    while (batch_take(b, w - b->workers, &c)) {
+      if (c <= atomic_load(&b->stop))
+        batch_chunk(w, c);
+
+      pthread_mutex_lock(&b->mu);
+      b->chunks[c].done = true;
+      pthread_cond_broadcast(&b->done);
+      pthread_mutex_unlock(&b->mu);
+    }
+
+    pthread_mutex_lock(&b->mu);
+    if (--b->busy == 0)
+      pthread_cond_broadcast(&b->done);
+  }
+
+  pthread_mutex_unlock(&b->mu);
+  return NULL;
+}
+
+// batch_publish - replaces snapshot of globals of ir by new one, releasing
+// previous one, which is freed once no worker views it. It runs only while
+// workers are idle between rounds; they take snapshot as round starts.
+static void batch_publish(Batch *b) {
+  Gl_Snapshot *s = gl_snapshot(&b->ir->globals);
+  if (s == NULL)
+    FATAL("cannot copy global scope\n");
+
+  if (b->snap != NULL)
+    gl_snap_release(b->snap);
+  b->snap = s;
+}
+
+static void batch_print_chunk(Batch_Chunk *ch) {
+  fwrite(ch->out, sizeof(char), ch->out_len, stdout);
+  fwrite(ch->err, sizeof(char), ch->err_len, stderr);
+  free(ch->out);
+  free(ch->err);
+  ch->out = ch->err = NULL;
+}
+
+// batch_parallel - evaluates every line of in as batch does, on workers_len
+// threads, or every record of compiled script in if compiled is set. Input
+// is read in rounds of chunks of whole lines, spread evenly between workers;
+// idle workers steal chunks of busy ones, and results of every chunk are
+// printed as soon as chunks before it are. Assignments make
+// later lines depend on them, so workers stop before them: ir evaluates lines
+// in order while they keep assigning, publishes globals, and the rest of the
+// chunk and later chunks of round are evaluated again in next round.
+void batch_parallel(Interpreter *ir, Reader *in, size_t workers_len,
+                    bool compiled) {
+  Batch b = {
+      .ir = ir,
+      .workers_len = workers_len,
+      .compiled = compiled,
+  };
+  String_Buffer buf = {.data = NULL, .len = 0, .cap = 0};
+  Parser tree = {0};
+
+  char *line;
+  size_t line_len;
+
+  if (__builtin_mul_overflow(workers_len, BATCH_CHUNKS_PER_WORKER,
+                             &b.chunks_cap) ||
+      b.chunks_cap > UINT32_MAX)
+    FATAL("too many batch workers\n");
+
+  b.workers = (Batch_Worker *)calloc(b.workers_len, sizeof(Batch_Worker));
+  b.chunks = (Batch_Chunk *)calloc(b.chunks_cap, sizeof(Batch_Chunk));
+  if (b.workers == NULL || b.chunks == NULL)
+    FATAL("cannot allocate batch workers\n");
+
+  pthread_mutex_init(&b.mu, NULL);
+  pthread_cond_init(&b.wake, NULL);
+  pthread_cond_init(&b.done, NULL);
+
+  batch_publish(&b);
+
+  for (size_t w = 0; w < b.workers_len; ++w) {
+    b.workers[w].b = &b;
+    ir_fork(&b.workers[w].ir, ir);
+
+    if (pthread_create(&b.workers[w].thread, NULL, batch_worker,
+                       &b.workers[w]) != 0)
+      FATAL("cannot start batch workers\n");
+  }
+
+  bool more = true;
+
+  while (true) {
+    while (more && b.chunks_len < b.chunks_cap) {
+      Batch_Chunk *ch = &b.chunks[b.chunks_len];
+      ch->row = in->row + 1;
+
+      more = compiled ? mwc_next_records(in, BATCH_CHUNK_SIZE, &ch->lines,
+                                         &ch->len)
+                      : rd_next_lines(in, &ch->copy, BATCH_CHUNK_SIZE,
+                                      &ch->lines, &ch->len);
+      b.chunks_len += more;
+    }
+
+    if (b.chunks_len == 0)
+      break;
+
+    for (size_t c = 0; c < b.chunks_len; ++c) {
+      b.chunks[c].stop = b.chunks[c].len;
+      b.chunks[c].done = false;
+    }
+
+    for (size_t w = 0; w < b.workers_len; ++w)
+      atomic_store(&b.workers[w].range,
+                   (uint64_t)(w * b.chunks_len / b.workers_len) |
+                       (uint64_t)((w + 1) * b.chunks_len / b.workers_len)
+                           << 32);
+
+    atomic_store(&b.stop, SIZE_MAX);
+
+    pthread_mutex_lock(&b.mu);
+    ++b.round;
+    b.busy = b.workers_len;
+    pthread_cond_broadcast(&b.wake);
+
+    size_t c = 0;
+    for (; c < b.chunks_len; ++c) {
+      while (!b.chunks[c].done)
+        pthread_cond_wait(&b.done, &b.mu);
+
+      pthread_mutex_unlock(&b.mu);
+      batch_print_chunk(&b.chunks[c]);
+      pthread_mutex_lock(&b.mu);
+
+      if (b.chunks[c].stop != b.chunks[c].len)
+        break;
+    }
+
+    while (b.busy != 0)
+      pthread_cond_wait(&b.done, &b.mu);
+    pthread_mutex_unlock(&b.mu);
+
+    if (c == b.chunks_len) {
+      b.chunks_len = 0;
+      continue;
+    }
+
+    for (size_t k = c + 1; k < b.chunks_len; ++k) {
+      free(b.chunks[k].out);
+      free(b.chunks[k].err);
+      b.chunks[k].out = b.chunks[k].err = NULL;
+    }
+
+    // ir runs lines in order until BATCH_SERIAL_LINES of them in a row do not
+    // assign symbols; workers take the rest of chunk once they see globals
+    Batch_Chunk *ch = &b.chunks[c];
+    size_t at = ch->stop;
+    size_t quiet = 0;
+
+    if (compiled) {
+      size_t row = ch->row + mwc_count(ch->lines, at);
+
+      for (; quiet < BATCH_SERIAL_LINES && at < ch->len; ++row) {
+        const Mwc_Record *rec = (const Mwc_Record *)&ch->lines[at];
+        if (batch_record(ir, &tree, rec, row, false)) {
+          ++quiet;
+        } else {
+          batch_record(ir, &tree, rec, row, true);
+          quiet = 0;
+        }
+        at += rec->size;
+      }
+
+      ch->row = row;
+    } else {
+      Reader rd = {.page = {.data = &ch->lines[at],
+                            .len = ch->len - at,
+                            .cap = ch->len - at}};
+      size_t row = ch->row + rd_count_lines(ch->lines, at);
+
+      rd_reset_counters(&rd);
+      while (quiet < BATCH_SERIAL_LINES &&
+             rd_next_line(&rd, &buf, &line, &line_len)) {
+        if (batch_line(ir, line, line_len, row + rd.row - 1, false)) {
+          ++quiet;
+        } else {
+          batch_line(ir, line, line_len, row + rd.row - 1, true);
+          quiet = 0;
+        }
+      }
+
+      at += rd.ptr;
+      ch->row = row + rd.row;
+    }
+
+    batch_publish(&b);
+
+    ch->lines += at;
+    ch->len -= at;
+    c += ch->len == 0;
+
+    // chunks after it are evaluated again in next round
+    for (size_t k = c; k < b.chunks_len; ++k) {
+      Batch_Chunk t = b.chunks[k - c];
+      b.chunks[k - c] = b.chunks[k];
+      b.chunks[k] = t;
+    }
+    b.chunks_len -= c;
+  }
+
+  pthread_mutex_lock(&b.mu);
+  b.quit = true;
+  pthread_cond_broadcast(&b.wake);
+  pthread_mutex_unlock(&b.mu);
+
+  for (size_t w = 0; w < b.workers_len; ++w) {
+    pthread_join(b.workers[w].thread, NULL);
+    ir_free(&b.workers[w].ir);
+    free(b.workers[w].buf.data);
+  }
+
+  for (size_t c = 0; c < b.chunks_cap; ++c)
+    free(b.chunks[c].copy.data);
+
+  gl_snap_release(b.snap);
+  pthread_cond_destroy(&b.done);
+  pthread_cond_destroy(&b.wake);
+  pthread_mutex_destroy(&b.mu);
+
+  free(b.chunks);
+  free(b.workers);
+  free(buf.data);
+}
+
+#endif
+
+//=:user:columns
+
+// columns_header - reads symbols naming columns from line.
+Reg columns_header(Lexer *lx, char *line, size_t len, sym_t *cols, Reg cap) {
+  Reg cols_len = 0;
+
+  lx->rd.src = NULL;
+  lx->rd.page.data = line;
+  lx->rd.page.len = lx->rd.page.cap = len;
+  rd_reset_counters(&lx->rd);
+
+  for (lx_next_token(lx); lx->tt != TT_EOS; lx_next_token(lx)) {
+    if (lx->tt != TT_SYM)
+      FATAL("1:%zu: symbol naming column expected\n", lx->col);
+    if (cols != NULL && cols_len < cap)
+      cols[cols_len] = lx->pm.s;
+    ++cols_len;
+  }
+
+  return cols_len;
+}
+
+// columns_row - reads line of whitespace separated real or imaginary numbers
+// into lane i of columns. Lane fails if line is not such row.
+void columns_row(Lanes *ln, Lexer *lx, Errors errors, char *line, size_t len,
+                 size_t i) {
+  if (scan.whitespaces(line, line + len) == line + len) {
+    ln->err[i] = LN_BLANK;
+    return;
+  }
+
+  lx->rd.src = NULL;
+  lx->rd.page.data = line;
+  lx->rd.page.len = lx->rd.page.cap = len;
+  rd_reset_counters(&lx->rd);
+
+  ln->err[i] = IR_ERR_NUM_ARG_EXPECTED;
+
+  for (Reg k = 0; k < ln->cols_len; ++k) {
+    lx->rel_err = 0;
+    lx_next_token(lx);
+
+    bool neg = lx->tt == TT_NEG;
+    if (neg || lx->tt == TT_NOP)
+      lx_next_token(lx);
+
+    if (lx->tt != TT_CMX)
+      return;
+
+    ln_store(ln_col(ln, k), i,
+             (Value){
+                 .pm.c = neg ? -lx->pm.c : lx->pm.c,
+                 .rel_err = errors_const(errors, lx->rel_err),
+                 .type = NT_PRIM_CMX,
+             });
+  }
+
+  lx_next_token(lx);
+  if (lx->tt == TT_EOS)
+    ln->err[i] = IR_ERR_NOERROR;
+}
+
+// columns - evaluates expr for every row of in, whose first line names its
+// columns by symbols. Rows are evaluated in blocks of SIMD lanes, printing one
+// result per row as batch does; errors are reported per row too.
+void columns(Interpreter *ir, Reader *in, const char *expr) {
+  Reader *rd = &ir->pr->lx.rd;
+  String_Buffer buf = {.data = NULL, .len = 0, .cap = 0};
+  Lexer lx = {0};
+  Lanes ln;
+
+  char *line;
+  size_t line_len;
+
+  rd->src = NULL;
+  rd->page.data = (char *)expr;
+  rd->page.len = rd->page.cap = strlen(expr);
+  rd_reset_counters(rd);
+
+  Node_Index source = 0;
+
+  PR_ERR perr = pr_next_node(ir->pr, &source);
+  if (perr != PR_ERR_NOERROR)
+    FATAL("%u:%u: %s (%d) [token: %s (%d)]\n", pr_row(ir->pr),
+          pr_col(ir->pr), pr_err_stringify(perr), perr,
+          tt_stringify(pr_tt(ir->pr)), pr_tt(ir->pr));
+
+  if (pr_tt(ir->pr) != TT_EOS)
+    FATAL("%u:%u: PR_ERR_UNEXPECTED_EXPRESSION\n", pr_row(ir->pr),
+          pr_col(ir->pr));
+
+  IR_ERR ierr = ir_compile(ir, ir->pr, source);
+  if (ierr != IR_ERR_NOERROR)
+    FATAL("%s (%d)\n", ir_err_stringify(ierr), ierr);
+
+  if (!rd_next_line(in, &buf, &line, &line_len))
+    FATAL("header with symbols naming columns expected\n");
+
+  Reg cols_len = columns_header(&lx, line, line_len, NULL, 0);
+  if (cols_len == 0)
+    FATAL("header with symbols naming columns expected\n");
+
+  if (!ln_init(&ln, &ir->bc, cols_len, ir->errors))
+    FATAL("cannot reserve memory for lanes\n");
+  columns_header(&lx, line, line_len, ln.cols, cols_len);
+
+  for (Reg k = 0; k < cols_len; ++k) {
+    uint32_t slot;
+    if (!gl_slot(&ir->globals, ln.cols[k], &slot))
+      FATAL("cannot bind symbols naming columns\n");
+    ln.cols[k] = slot;
+  }
+
+  // assignments make rows depend on each other, so they run one by one
+  bool rows = bc_assigns(&ir->bc);
+
+  size_t row = in->row + 1;
+  bool more = true;
+
+  while (more) {
+    size_t n = 0;
+    while (n < ln.width && (more = rd_next_line(in, &buf, &line, &line_len)))
+      columns_row(&ln, &lx, ir->errors, line, line_len, n++);
+
+    if (rows) {
+      ln_run_rows(&ln, ir, n);
+    } else {
+      ln_run(&ln, ir, n);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      if (ln.err[i] == LN_BLANK) {
+        fprintf(STREAM_OUT, "\n");
+      } else if (ln.err[i] != IR_ERR_NOERROR) {
+        ERROR("%zu: " CLR_INTERNAL "%s" CLR_RESET " (%d)\n", row + i,
+              ir_err_stringify(ln.err[i]), ln.err[i]);
+        fprintf(STREAM_OUT, "\n");
+      } else if (!ln.valued) {
+        fprintf(STREAM_OUT, "\n");
+      } else {
+        Value v = ln_value(&ln, &ir->bc, ln.result, i);
+        batch_print_result(&v);
+      }
+    }
+
+    row += n;
+  }
+
+  ln_free(&ln);
+  free(buf.data);
+}
+
 //=:user:main
 
 int main(int argc, char *argv[]) {
   Interpreter ir;
 
-  ir.st = malloc(sizeof(Stack_Node) + NODE_BUF_SIZE * sizeof(Node));
-  assert(ir.st != NULL && "allocation failed");
-
-  ir.st->cap = NODE_BUF_SIZE;
-  ir.st->len = 0;
-
-  ir.pr = malloc(sizeof(Parser) + NODE_BUF_SIZE * sizeof(Node));
-  assert(ir.pr != NULL && "allocation failed");
-
-  ir.gscope_cap = GLOBAL_SCOPE_CAPACITY;
-  ir.gscope =
-      (Map_Entry *)calloc(ir.gscope_cap, sizeof(Map_Entry) + sizeof(Node));
-  assert(ir.pr != NULL && "allocation failed");
-
-  MAP_SET(ir.gscope,
-          ir.gscope_cap,
-          BUILTIN_CONST_PI,
-          (&(Node){
-              .type = NT_PRIM_CMX,
-              .as.pm.c = M_PI,
-              .rel_err = (nextafter((double)M_PI, INFINITY) - M_PI) / M_PI,
-          }));
-  MAP_SET(ir.gscope,
-          ir.gscope_cap,
-          BUILTIN_CONST_E,
-          (&(Node){
-              .type = NT_PRIM_CMX,
-              .as.pm.c = M_E,
-              .rel_err = (nextafter((double)M_E, INFINITY) - M_E) / M_E,
-          }));
-
-  *ir.pr = ((Parser){
-      .lx.rd =
-          {
-              .src = NULL,
-              .page =
-                  {
-                      .data = NULL,
-                      .len = 0,
-                      .cap = 0,
-                  },
-          },
-      .p0c = 0,
-      .abs = false,
-      .nodes_len = 1,
-      .nodes_cap = NODE_BUF_SIZE,
-  });
+  scan_init();
+  lanes_init();
+
+  ir.result = NULL;
+  ir.runs = 1;
+  ir.errors = ERRORS_DEFAULT;
+#ifdef X64_JIT
+  ir.jit_code = (X64_Code){0};
+  ir.jit = false;
+#endif
+
+  if (!bc_init(&ir.bc))
+    FATAL("cannot reserve memory for bytecode\n");
+
+  ir.pr = pr_new();
+
+  if (!gl_init(&ir.globals))
+    FATAL("cannot allocate global scope\n");
+
+  ir.fns = (Fn_Table *)calloc(1, sizeof(Fn_Table));
+  assert(ir.fns != NULL && "allocation failed");
+  ir.fork = false;
+  ir.frames = (Arena){0};
+  ir.frames_len = 0;
+  ir.depth = 0;
+  ir.stack = 0;
+  ir.session = NULL;
+
+  bool batch_mode = false;
+  bool columns_mode = false;
+  size_t workers = 1;
+  const char *path = NULL;
+  const char *expr = NULL;
+  const char *out = NULL; // file to compile script of path into
+  bool compile = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-b") == 0) {
+      batch_mode = true;
+    } else if (strcmp(argv[i], "--columns") == 0) {
+      columns_mode = true;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      if (++i == argc)
+        FATAL("-n: number of runs expected\n");
+
+      char *end;
+      ir.runs = strtoull(argv[i], &end, 10);
+      if (*end != '\0' || ir.runs == 0)
+        FATAL("-n: positive number of runs expected\n");
+    } else if (strcmp(argv[i], "-j") == 0) {
+      if (++i == argc)
+        FATAL("-j: number of threads expected\n");
+
+      // strtoull takes signs and leading spaces, wrapping negative numbers
+      char *end;
+      errno = 0;
+      workers = strtoull(argv[i], &end, 10);
+      if (argv[i][0] < '0' || argv[i][0] > '9' || *end != '\0' || errno != 0)
+        FATAL("-j: non-negative number of threads expected\n");
+#ifdef HAVE_THREADS
+      size_t cpus = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+      if (workers == 0)
+        workers = cpus;
+      if (workers > cpus * BATCH_WORKERS_PER_CPU) {
+        WARNING("-j: %zu threads at most on %zu CPUs\n",
+                cpus * BATCH_WORKERS_PER_CPU, cpus);
+        workers = cpus * BATCH_WORKERS_PER_CPU;
+      }
+#else
+      WARNING("-j: not supported on this platform, running one thread\n");
+      workers = 1;
+#endif
+    } else if (strncmp(argv[i], "--errors=", 9) == 0) {
+      if (!errors_parse(argv[i] + 9, &ir.errors))
+        FATAL("--errors: off, linear or interval expected\n");
+    } else if (strcmp(argv[i], "--jit") == 0) {
+#ifdef X64_JIT
+      ir.jit = true;
+#else
+      WARNING("--jit: not supported on this platform, interpreting\n");
+#endif
+    } else if (strcmp(argv[i], "-f") == 0) {
+      if (++i == argc)
+        FATAL("-f: file name expected\n");
+      path = argv[i];
+    } else if (strcmp(argv[i], "--compile") == 0) {
+      if (++i == argc)
+        FATAL("--compile: file name expected\n");
+      path = argv[i];
+      compile = true;
+    } else if (strcmp(argv[i], "-o") == 0) {
+      if (++i == argc)
+        FATAL("-o: file name expected\n");
+      out = argv[i];
+    } else if (strcmp(argv[i], "--session") == 0) {
+      if (++i == argc)
+        FATAL("--session: file name expected\n");
+      ir.session = argv[i];
+    } else if (expr == NULL) {
+      expr = argv[i];
+    } else {
+      FATAL("too many arguments\n");
+    }
+  }
+
+  // one result per line is read by programs, written in large blocks unless
+  // someone watches it
+  if (batch_mode || columns_mode) {
+    stream_colors = false;
+    if (!isatty(STDOUT_FILENO))
+      setvbuf(stdout, NULL, _IOFBF, RESULT_BUFFER_SIZE);
+  }
+
+#ifdef X64_JIT
+  if (ir.jit && !x64_init(&ir.jit_code, JIT_CODE_RESERVE))
+    FATAL("cannot reserve memory for machine code\n");
+#endif
+
+  // saved session resumes, yet constants' errors follow errors mode
+#ifdef HAVE_MMAP
+  if (ir.session != NULL && access(ir.session, F_OK) == 0) {
+    const char *why = gl_load(&ir.globals, ir.session);
+    if (why != NULL)
+      FATAL("--session: %s: %s\n", ir.session, why);
+  }
+#else
+  if (ir.session != NULL)
+    WARNING("--session: not supported on this platform, not loaded\n");
+#endif
 
-  if (isatty(STDIN_FILENO) && argc == 1)
+  gl_set(&ir.globals, BUILTIN_CONST_PI,
+         &(Value){
+             .type = NT_PRIM_CMX,
+             .pm.c = M_PI,
+             .rel_err = errors_const(
+                 ir.errors, (nextafter((double)M_PI, INFINITY) - M_PI) / M_PI),
+         });
+  gl_set(&ir.globals, BUILTIN_CONST_E,
+         &(Value){
+             .type = NT_PRIM_CMX,
+             .pm.c = M_E,
+             .rel_err = errors_const(
+                 ir.errors, (nextafter((double)M_E, INFINITY) - M_E) / M_E),
+         });
+
+  if (isatty(STDIN_FILENO) && path == NULL && expr == NULL && !batch_mode &&
+      !columns_mode && out == NULL)
     repl(&ir);
 
-  if (argc > 3)
-    FATAL("too many arguments\n");
-
-  if (argc == 3 && strcmp(argv[1], "-f") == 0) {
-    ir.pr->lx.rd.src = fopen(argv[2], "r");
-    if (ir.pr->lx.rd.src == NULL)
-      PFATAL("failed to open file");
-
-    ir.pr->lx.rd.page.cap = INTERNAL_READING_BUF_SIZE;
-    ir.pr->lx.rd.page.data =
-        (char *)malloc(ir.pr->lx.rd.page.cap * sizeof(char));
-    assert(ir.pr->lx.rd.page.data != NULL && "allocation failed");
-  } else if (argc == 2) {
-    ir.pr->lx.rd.page.len = ir.pr->lx.rd.page.cap = strlen(argv[1]);
-    ir.pr->lx.rd.page.data = argv[1];
+  if (columns_mode && expr == NULL)
+    FATAL("--columns: expression expected\n");
+
+  if (compile && out == NULL)
+    FATAL("--compile: -o file name expected\n");
+  if (!compile && out != NULL)
+    FATAL("-o: used only with --compile\n");
+
+  if (compile && columns_mode)
+    FATAL("--compile: not supported with --columns\n");
+
+  if (path != NULL) {
+    rd_open(&ir.pr->lx.rd, path);
+  } else if (expr != NULL && !columns_mode) {
+    ir.pr->lx.rd.page.len = ir.pr->lx.rd.page.cap = strlen(expr);
+    ir.pr->lx.rd.page.data = (char *)expr;
   } else {
-    ir.pr->lx.rd.src = stdin;
+    rd_open_fd(&ir.pr->lx.rd, STDIN_FILENO);
+  }
+
+  Mwc mwc = {0};      // compiled script run instead of text, none if no data
+  char *cache = NULL; // cache file to compile text into, NULL if none
+
+#ifdef HAVE_MMAP
+  if (path != NULL && !columns_mode)
+    cache = mwc_load(&mwc, &ir.pr->lx.rd, path, batch_mode, !compile);
+#endif
 
-    ir.pr->lx.rd.page.cap = INTERNAL_READING_BUF_SIZE;
-    ir.pr->lx.rd.page.data =
-        (char *)malloc(ir.pr->lx.rd.page.cap * sizeof(char));
-    assert(ir.pr->lx.rd.page.data != NULL && "allocation failed");
+  if (compile && mwc.data != NULL)
+    FATAL("--compile: %s is compiled already\n", path);
+
+  if (batch_mode || columns_mode) {
+    Reader in = ir.pr->lx.rd;
+    rd_reset_counters(&in);
+
+    if (compile || cache != NULL) {
+      mwc_begin(&mwc);
+      mwc_compile_lines(ir.pr, &in, &mwc);
+      mwc_end(&mwc, &in, batch_mode);
+    }
+
+    if (compile) {
+      if (!mwc_write(&mwc, out))
+        PFATAL("--compile: cannot write compiled script");
+
+      rd_close(&in);
+      mwc_free(&mwc);
+      ir_free(&ir);
+      return EXIT_SUCCESS;
+    }
+
+#ifdef HAVE_MMAP
+    if (cache != NULL)
+      mwc_store(&mwc, cache);
+#endif
+
+    if (columns_mode) {
+      columns(&ir, &in, expr);
+    } else if (mwc.data != NULL) {
+      size_t len;
+      char *recs = mwc_records(&mwc, &len);
+
+#ifdef HAVE_THREADS
+      if (workers > 1) {
+        Reader rd = {.page = {.data = recs, .len = len, .cap = len}};
+        rd_reset_counters(&rd);
+        batch_parallel(&ir, &rd, workers, true);
+      } else {
+        batch_records(&ir, recs, len, 1);
+      }
+#else
+      batch_records(&ir, recs, len, 1);
+#endif
+#ifdef HAVE_THREADS
+    } else if (workers > 1) {
+      batch_parallel(&ir, &in, workers, false);
+#endif
+    } else {
+      batch(&ir, &in);
+    }
+
+    rd_close(&in);
+    mwc_free(&mwc);
+    free(cache);
+    ir_free(&ir);
+    return EXIT_SUCCESS;
   }
 
   rd_reset_counters(&ir.pr->lx.rd);
 
+  const Parser *pr = ir.pr;
+  Parser tree = {0};
   Node_Index source = 0;
 
-  PR_ERR perr = pr_next_node(ir.pr, &source);
-  if (perr != PR_ERR_NOERROR)
-    FATAL("%zu:%zu: %s (%d) [token: %s (%d)]\n", ir.pr->lx.rd.row,
-          ir.pr->lx.rd.col, pr_err_stringify(perr), perr,
-          tt_stringify(ir.pr->lx.tt), ir.pr->lx.tt);
+  if (mwc.data != NULL) {
+    size_t len;
+    const Mwc_Record *rec = (const Mwc_Record *)mwc_records(&mwc, &len);
 
-  if (ir.pr->lx.tt != TT_EOS) {
-    ERROR("%zu:%zu: " CLR_INTERNAL "PR_ERR_UNEXPECTED_EXPRESSION" CLR_RESET
-          "\n",
-          ir.pr->lx.rd.row, ir.pr->lx.rd.col);
-    ERROR(CLR_INF_MSG "consider adding ';' between expressions\n" CLR_RESET);
-    exit(1);
+    mwc_tree(rec, &tree);
+    pr = &tree;
+    source = rec->source;
+  } else {
+    PR_ERR perr = pr_next_node(ir.pr, &source);
+    if (perr != PR_ERR_NOERROR)
+      FATAL("%u:%u: %s (%d) [token: %s (%d)]\n", pr_row(ir.pr),
+            pr_col(ir.pr), pr_err_stringify(perr), perr,
+            tt_stringify(pr_tt(ir.pr)), pr_tt(ir.pr));
+
+    if (pr_tt(ir.pr) != TT_EOS) {
+      ERROR("%u:%u: " CLR_INTERNAL "PR_ERR_UNEXPECTED_EXPRESSION" CLR_RESET
+            "\n",
+            pr_row(ir.pr), pr_col(ir.pr));
+      ERROR(CLR_INF_MSG "consider adding ';' between expressions\n" CLR_RESET);
+      exit(1);
+    }
+
+    if (compile || cache != NULL) {
+      mwc_begin(&mwc);
+      mwc_put_tree(&mwc, ir.pr, source);
+      mwc_end(&mwc, &ir.pr->lx.rd, batch_mode);
+    }
+
+    if (compile) {
+      if (!mwc_write(&mwc, out))
+        PFATAL("--compile: cannot write compiled script");
+
+      rd_close(&ir.pr->lx.rd);
+      mwc_free(&mwc);
+      ir_free(&ir);
+      return EXIT_SUCCESS;
+    }
+
+#ifdef HAVE_MMAP
+    if (cache != NULL)
+      mwc_store(&mwc, cache);
+#endif
   }
 
   /* for (Node_Index i = 0; i < ir.pr->nodes_len; ++i) { */
@@ -1258,28 +7002,24 @@ int main(int argc, char *argv[]) {
   /* } */
 
 #ifndef NDEBUG
-  nd_tree_print(ir.pr->nodes, source, SOURCE_INDENTATION,
+  nd_tree_print(pr->nodes, &pr->consts, source, SOURCE_INDENTATION,
                 SOURCE_INDENTATION + SOURCE_MAX_DEPTH);
 #endif
 
-  IR_ERR ierr = ir_exec(&ir);
+  IR_ERR ierr = ir_exec(&ir, pr, source);
   if (ierr != IR_ERR_NOERROR)
     FATAL("%s (%d)\n", ir_err_stringify(ierr), ierr);
 
   printf(REPL_RESULT_PREFIX);
-  if (ir.st->len != 0) {
-    nd_tree_print(ir.st->data, 0, SOURCE_INDENTATION,
-                  SOURCE_INDENTATION + SOURCE_MAX_DEPTH);
-  }
+  if (ir.result != NULL)
+    nd_tree_print_result(*ir.result, SOURCE_INDENTATION);
 
   printf(REPL_RESULT_SUFFIX);
 
-  if (ir.pr->lx.rd.src != NULL)
-    free(ir.pr->lx.rd.page.data);
-  free(ir.pr);
-
-  if (argc == 3)
-    fclose(ir.pr->lx.rd.src);
+  rd_close(&ir.pr->lx.rd);
+  mwc_free(&mwc);
+  free(cache);
+  ir_free(&ir);
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,176 @@
+/******************************************************************************\
+*                                                                              *
+*    Mewa. Math EWAluator.                                                     *
+*    Copyright (C) 2024 Mark Mandriota                                         *
+*                                                                              *
+*    This program is free software: you can redistribute it and/or modify      *
+*    it under the terms of the GNU General Public License as published by      *
+*    the Free Software Foundation, either version 3 of the License, or         *
+*    (at your option) any later version.                                       *
+*                                                                              *
+*    This program is distributed in the hope that it will be useful,           *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*    GNU General Public License for more details.                              *
+*                                                                              *
+*    You should have received a copy of the GNU General Public License         *
+*    along with this program.  If not, see <https://www.gnu.org/licenses/>.    *
+*                                                                              *
+\******************************************************************************/
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "util.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+// Scan_Fn - returns pointer to the first character in [p, end) which is out
+// of scanned class, or end.
+typedef const char *(*Scan_Fn)(const char *p, const char *end);
+
+//=:scan:scalar
+
+static inline const char *scan_scalar(const char *p, const char *end,
+                                      uint8_t cc) {
+  while (p < end && is_class(*p, cc))
+    ++p;
+
+  return p;
+}
+
+static const char *scan_whitespaces_scalar(const char *p, const char *end) {
+  return scan_scalar(p, end, CC_WHITESPACE);
+}
+
+static const char *scan_digits_scalar(const char *p, const char *end) {
+  return scan_scalar(p, end, CC_DIGIT);
+}
+
+static const char *scan_symbol_scalar(const char *p, const char *end) {
+  return scan_scalar(p, end, CC_SYMBOL);
+}
+
+#ifdef SCAN_X86
+
+//=:scan:sse2
+
+#define SCAN_SSE2 __attribute__((target("sse2")))
+
+SCAN_SSE2 static inline __m128i scan_whitespaces_16(__m128i v) {
+  __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\v')));
+  return _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+// unsigned v - lo <= len
+SCAN_SSE2 static inline __m128i scan_range_16(__m128i v, char lo, char len) {
+  __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(len)), d);
+}
+
+SCAN_SSE2 static inline __m128i scan_digits_16(__m128i v) {
+  return scan_range_16(v, '0', 9);
+}
+
+SCAN_SSE2 static inline __m128i scan_symbol_16(__m128i v) {
+  __m128i m = scan_range_16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25);
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+  return _mm_or_si128(m, scan_digits_16(v));
+}
+
+#define SCAN_DEFINE_SSE2(name, cc)                                          \
+  SCAN_SSE2 static const char *name##_sse2(const char *p, const char *end) { \
+    for (; end - p >= 16; p += 16) {                                         \
+      __m128i v = _mm_loadu_si128((const __m128i *)p);                       \
+      unsigned m = ~_mm_movemask_epi8(name##_16(v)) & 0xFFFF;                \
+      if (m != 0)                                                            \
+        return p + __builtin_ctz(m);                                         \
+    }                                                                        \
+    return scan_scalar(p, end, cc);                                          \
+  }
+
+SCAN_DEFINE_SSE2(scan_whitespaces, CC_WHITESPACE)
+SCAN_DEFINE_SSE2(scan_digits, CC_DIGIT)
+SCAN_DEFINE_SSE2(scan_symbol, CC_SYMBOL)
+
+//=:scan:avx2
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 static inline __m256i scan_whitespaces_32(__m256i v) {
+  __m256i m = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\v')));
+  return _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+}
+
+SCAN_AVX2 static inline __m256i scan_range_32(__m256i v, char lo, char len) {
+  __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(len)), d);
+}
+
+SCAN_AVX2 static inline __m256i scan_digits_32(__m256i v) {
+  return scan_range_32(v, '0', 9);
+}
+
+SCAN_AVX2 static inline __m256i scan_symbol_32(__m256i v) {
+  __m256i m =
+      scan_range_32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25);
+  m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+  return _mm256_or_si256(m, scan_digits_32(v));
+}
+
+#define SCAN_DEFINE_AVX2(name)                                               \
+  SCAN_AVX2 static const char *name##_avx2(const char *p, const char *end) { \
+    for (; end - p >= 32; p += 32) {                                         \
+      __m256i v = _mm256_loadu_si256((const __m256i *)p);                    \
+      unsigned m = ~(unsigned)_mm256_movemask_epi8(name##_32(v));            \
+      if (m != 0)                                                            \
+        return p + __builtin_ctz(m);                                         \
+    }                                                                        \
+    return name##_sse2(p, end);                                              \
+  }
+
+SCAN_DEFINE_AVX2(scan_whitespaces)
+SCAN_DEFINE_AVX2(scan_digits)
+SCAN_DEFINE_AVX2(scan_symbol)
+
+#endif
+
+//=:scan:dispatch
+
+static struct {
+  Scan_Fn whitespaces;
+  Scan_Fn digits;
+  Scan_Fn symbol;
+} scan = {
+    .whitespaces = scan_whitespaces_scalar,
+    .digits = scan_digits_scalar,
+    .symbol = scan_symbol_scalar,
+};
+
+// scan_init - selects the widest scanning kernels supported by running CPU.
+static inline void scan_init(void) {
+#ifdef SCAN_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    scan.whitespaces = scan_whitespaces_avx2;
+    scan.digits = scan_digits_avx2;
+    scan.symbol = scan_symbol_avx2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    scan.whitespaces = scan_whitespaces_sse2;
+    scan.digits = scan_digits_sse2;
+    scan.symbol = scan_symbol_sse2;
+  }
+#endif
+}
+
+#endif
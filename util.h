@@ -23,7 +23,9 @@
 
 #include "config.h"
 
+#include <assert.h>
 #include <complex.h>
+#include <stdarg.h>
 #include <stdbool.h> // IWYU pragma: keep
 #include <stdint.h>
 #include <stdio.h>
@@ -35,11 +37,68 @@
 #define M_PI 3.14159265358979323846264338327950288
 #endif
 
+//=:util:streams
+
+// stream_out, stream_err - streams of results and messages of current thread,
+// NULL standing for stdout and stderr. Batch workers set them to buffers.
+static _Thread_local FILE *stream_out, *stream_err;
+
+#define STREAM_OUT (stream_out != NULL ? stream_out : stdout)
+#define STREAM_ERR (stream_err != NULL ? stream_err : stderr)
+
+// stream_colors - whether results are colored; machine-readable modes clear
+// it before any result is printed.
+static bool stream_colors = true;
+
+// stream_printf - fprintf to f, dropping escapes of colors when stream_colors
+// is cleared, so that messages of machine-readable modes are plain too.
+__attribute__((format(printf, 2, 3))) static void
+stream_printf(FILE *f, const char *fmt, ...) {
+  char buf[512], *s = buf;
+  va_list ap, aq;
+
+  va_start(ap, fmt);
+  if (stream_colors) {
+    vfprintf(f, fmt, ap);
+    va_end(ap);
+    return;
+  }
+
+  va_copy(aq, ap);
+  int len = vsnprintf(buf, sizeof buf, fmt, ap);
+  va_end(ap);
+  if (len >= (int)sizeof buf) {
+    // message is cut short if it does not fit memory
+    s = malloc(len + 1);
+    if (s != NULL) {
+      vsnprintf(s, len + 1, fmt, aq);
+    } else {
+      s = buf;
+      len = sizeof buf - 1;
+    }
+  }
+  va_end(aq);
+
+  // escapes of colors are ESC [ parameters m
+  for (int i = 0, run = 0; i <= len; ++i) {
+    if (i < len && !(s[i] == '\x1b' && i + 1 < len && s[i + 1] == '['))
+      continue;
+
+    fwrite(&s[run], 1, i - run, f);
+    while (i < len && s[i] != 'm')
+      ++i;
+    run = i + 1;
+  }
+
+  if (s != buf)
+    free(s);
+}
+
 //=:util:error_handling
 
 #define FATAL(...)                                                   \
   {                                                                  \
-    fprintf(stderr, CLR_ERR_MSG "FATAL" CLR_RESET ": " __VA_ARGS__); \
+    stream_printf(stderr, CLR_ERR_MSG "FATAL" CLR_RESET ": " __VA_ARGS__); \
     exit(EXIT_FAILURE);                                              \
   }
 
@@ -49,16 +108,16 @@
     exit(EXIT_FAILURE); \
   }
 
-#define ERROR(...)                                                   \
-  {                                                                  \
-    fprintf(stderr, CLR_ERR_MSG "ERROR" CLR_RESET ": " __VA_ARGS__); \
-    fflush(stderr);                                                  \
+#define ERROR(...)                                                       \
+  {                                                                      \
+    stream_printf(STREAM_ERR, CLR_ERR_MSG "ERROR" CLR_RESET ": " __VA_ARGS__); \
+    fflush(STREAM_ERR);                                                  \
   }
 
-#define WARNING(...)                                                   \
-  {                                                                    \
-    fprintf(stderr, CLR_WRN_MSG "WARNING" CLR_RESET ": " __VA_ARGS__); \
-    fflush(stderr);                                                    \
+#define WARNING(...)                                                       \
+  {                                                                        \
+    stream_printf(STREAM_ERR, CLR_WRN_MSG "WARNING" CLR_RESET ": " __VA_ARGS__); \
+    fflush(STREAM_ERR);                                                    \
   }
 
 #define TRY(type, expr)        \
@@ -77,7 +136,7 @@
 #else
 #define DBG_PRINT(...)                                              \
   {                                                                 \
-    fprintf(stderr, CLR_INF_MSG "INFO" CLR_RESET ": " __VA_ARGS__); \
+    stream_printf(stderr, CLR_INF_MSG "INFO" CLR_RESET ": " __VA_ARGS__); \
     fflush(stderr);                                                 \
   }
 #define DBG_FATAL(...) FATAL(__VA_ARGS__)
@@ -127,19 +186,61 @@ ssize_t getline(char **restrict lineptr, size_t *restrict n,
 
 #define MAX(a, b) (a >= b ? a : b)
 
+#define MIN(a, b) (a <= b ? a : b)
+
 #define ABS(a) (a >= 0 ? a : -a)
 
 //=:util:ascii
 
-static inline bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\v' || c == '\r' || c == '\n'; }
+enum {
+  CC_WHITESPACE = 1 << 0,
+  CC_LOWER = 1 << 1,
+  CC_UPPER = 1 << 2,
+  CC_UNDERSCORE = 1 << 3,
+  CC_DIGIT = 1 << 4,
+
+  CC_LETTER = CC_LOWER | CC_UPPER | CC_UNDERSCORE,
+  CC_SYMBOL = CC_LETTER | CC_DIGIT,
+};
+
+// character classes indexed by unsigned char
+static const uint8_t CHAR_CLASS[256] = {
+    [' '] = CC_WHITESPACE,
+    ['\t'] = CC_WHITESPACE,
+    ['\v'] = CC_WHITESPACE,
+    ['\r'] = CC_WHITESPACE,
+    ['\n'] = CC_WHITESPACE,
+    ['a'] = CC_LOWER, ['b'] = CC_LOWER, ['c'] = CC_LOWER, ['d'] = CC_LOWER,
+    ['e'] = CC_LOWER, ['f'] = CC_LOWER, ['g'] = CC_LOWER, ['h'] = CC_LOWER,
+    ['i'] = CC_LOWER, ['j'] = CC_LOWER, ['k'] = CC_LOWER, ['l'] = CC_LOWER,
+    ['m'] = CC_LOWER, ['n'] = CC_LOWER, ['o'] = CC_LOWER, ['p'] = CC_LOWER,
+    ['q'] = CC_LOWER, ['r'] = CC_LOWER, ['s'] = CC_LOWER, ['t'] = CC_LOWER,
+    ['u'] = CC_LOWER, ['v'] = CC_LOWER, ['w'] = CC_LOWER, ['x'] = CC_LOWER,
+    ['y'] = CC_LOWER, ['z'] = CC_LOWER,
+    ['A'] = CC_UPPER, ['B'] = CC_UPPER, ['C'] = CC_UPPER, ['D'] = CC_UPPER,
+    ['E'] = CC_UPPER, ['F'] = CC_UPPER, ['G'] = CC_UPPER, ['H'] = CC_UPPER,
+    ['I'] = CC_UPPER, ['J'] = CC_UPPER, ['K'] = CC_UPPER, ['L'] = CC_UPPER,
+    ['M'] = CC_UPPER, ['N'] = CC_UPPER, ['O'] = CC_UPPER, ['P'] = CC_UPPER,
+    ['Q'] = CC_UPPER, ['R'] = CC_UPPER, ['S'] = CC_UPPER, ['T'] = CC_UPPER,
+    ['U'] = CC_UPPER, ['V'] = CC_UPPER, ['W'] = CC_UPPER, ['X'] = CC_UPPER,
+    ['Y'] = CC_UPPER, ['Z'] = CC_UPPER,
+    ['_'] = CC_UNDERSCORE,
+    ['0'] = CC_DIGIT, ['1'] = CC_DIGIT, ['2'] = CC_DIGIT, ['3'] = CC_DIGIT,
+    ['4'] = CC_DIGIT, ['5'] = CC_DIGIT, ['6'] = CC_DIGIT, ['7'] = CC_DIGIT,
+    ['8'] = CC_DIGIT, ['9'] = CC_DIGIT,
+};
+
+static inline bool is_class(char c, uint8_t cc) { return CHAR_CLASS[(unsigned char)c] & cc; }
 
-static inline bool is_lower(char c) { return c >= 'a' && c <= 'z'; }
+static inline bool is_whitespace(char c) { return is_class(c, CC_WHITESPACE); }
 
-static inline bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+static inline bool is_lower(char c) { return is_class(c, CC_LOWER); }
 
-static inline bool is_letter(char c) { return is_lower(c) || is_upper(c) || c == '_'; }
+static inline bool is_upper(char c) { return is_class(c, CC_UPPER); }
 
-static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline bool is_letter(char c) { return is_class(c, CC_LETTER); }
+
+static inline bool is_digit(char c) { return is_class(c, CC_DIGIT); }
 
 //=:util:data_structures
 
@@ -246,6 +347,8 @@ typedef enum {
   TT_RP0,
 
   TT_ABS,
+
+  TT_ARG,
 } Token_Type;
 
 //=:lexer:tokens:stringify
@@ -279,6 +382,7 @@ static inline const char *tt_stringify(Token_Type tt) {
     STRINGIFY_CASE(TT_LP0)
     STRINGIFY_CASE(TT_RP0)
     STRINGIFY_CASE(TT_ABS)
+    STRINGIFY_CASE(TT_ARG)
   }
 
   return STRINGIFY(INVALID_TT);
@@ -322,6 +426,7 @@ typedef enum {
   NT_UNOP_NEG,
 
   NT_CALL,
+  NT_BIOP_ARG,
 } Node_Type;
 
 //=:parser:nodes:stringify
@@ -353,6 +458,7 @@ static inline const char *nt_stringify(Node_Type nt) {
     STRINGIFY_CASE(NT_UNOP_NOP)
     STRINGIFY_CASE(NT_UNOP_NEG)
     STRINGIFY_CASE(NT_CALL)
+    STRINGIFY_CASE(NT_BIOP_ARG)
   }
 
   return STRINGIFY(INVALID_NT);
@@ -379,6 +485,7 @@ Node_Type tt_to_biop_nd(Token_Type tt) {
   case TT_MOD: return NT_BIOP_MOD;
   case TT_POW: return NT_BIOP_POW;
   case TT_XPC: return NT_BIOP_XPC;
+  case TT_ARG: return NT_BIOP_ARG;
   case TT_SPZ: return NT_BIOP_SPZ;
   case TT_FAC: return NT_BIOP_FAC;
   case TT_LP0: return NT_CALL;
@@ -394,6 +501,12 @@ bool is_unop(Node_Type nt) {
          nt == NT_UNOP_NOP;
 }
 
+bool is_prim(Node_Type nt) {
+  return nt == NT_PRIM_SYM ||
+         nt == NT_PRIM_CMX ||
+         nt == NT_PRIM_PRB;
+}
+
 //=:runtime
 
 typedef union {
@@ -401,6 +514,13 @@ typedef union {
   sym_t s;
 } Primitive;
 
+// Value - evaluated primitive with its relative error.
+typedef struct {
+  Primitive pm;
+  float rel_err;
+  Node_Type type;
+} Value;
+
 //=:runtime:assertions
 #define ASSERT_NON_NEG_INT(x, fn, what, rt)        \
   if (x < 0 && fmod(-x, 1) <= MAX_DIFF_ABS) {      \
@@ -438,11 +558,30 @@ double contains_interval(double a, double a_re, double b, double b_re) {
   return intersection / bs;
 }
 
-cmx_t fac_cmx_helper(cmx_t i, uint64_t step) {
+enum {
+  // greatest n whose factorial is exact in double, so product of steps is
+  FAC_CMX_EXACT_MAX = 22,
+  // longest step of multifactorial whose angles fit on stack
+  FAC_CMX_ANGLES_STACK = 1 << 6,
+};
+
+// fac_int - multifactorial of non-negative integer n with integer step s >= 1
+// as product of its steps, exact while it is below 2^53.
+static inline double fac_int(double n, double s) {
+  double rt = 1;
+
+  for (double i = n; i > 0 && rt < INFINITY; i -= s)
+    rt *= i;
+
+  return rt;
+}
+
+// fac_cmx_helper - mean of cos(a * i) over angles a of step roots of unity.
+cmx_t fac_cmx_helper(cmx_t i, const double *angles, uint64_t step) {
   cmx_t rt = 0;
 
-  for (uint64_t j = 1; j <= step; ++j)
-    rt += cos(acos(cos(2 * j * M_PI / step)) * i);
+  for (uint64_t j = 0; j < step; ++j)
+    rt += cos(angles[j] * i);
 
   return rt / step;
 }
@@ -456,11 +595,29 @@ cmx_t fac_cmx(cmx_t base, cmx_t step) {
 
   ASSERT_NON_NEG_INT(rbase, "factorial", "is equal to infinity", INFINITY);
 
+  // beyond exact factorials gamma function rounds less than product does
+  if (rbase >= 0 && rbase == trunc(rbase) && rstep == ustep && ustep >= 1)
+    return ustep == 1 && rbase > FAC_CMX_EXACT_MAX ? tgamma(rbase + 1)
+                                                   : fac_int(rbase, rstep);
+
   cmx_t rt = pow(rstep, rbase / rstep) * tgamma(1 + rbase / rstep);
+  if (ustep < 2)
+    return rt;
+
+  double stack[FAC_CMX_ANGLES_STACK];
+  double *angles =
+      ustep <= FAC_CMX_ANGLES_STACK ? stack : malloc(ustep * sizeof(double));
+  assert(angles != NULL && "allocation failed");
+
+  for (uint64_t j = 1; j <= ustep; ++j)
+    angles[j - 1] = acos(cos(2 * j * M_PI / ustep));
 
   for (uint64_t i = 1; i < ustep; ++i)
     rt *= pow(pow(rstep, (rstep - i) / rstep) / tgamma(i / rstep),
-              fac_cmx_helper(rbase - i, ustep));
+              fac_cmx_helper(rbase - i, angles, ustep));
+
+  if (angles != stack)
+    free(angles);
 
   return rt;
 }
@@ -469,15 +626,34 @@ enum {
   GAMMA_LOWER_QUO_E_ITER = 1 << 6,
 };
 
+// gamma_lower_quo_e - (-1)^s * sum of (-1)^i * gamma(s) / gamma(s + i + 1),
+// whose terms are got from previous ones dividing them by s + i.
 cmx_t gamma_lower_quo_e(double s) {
-  cmx_t rt = 0;
+  double rt = 0;
+  double term = 1 / s;
 
-  for (int i = 0; i <= GAMMA_LOWER_QUO_E_ITER; ++i)
-    rt += (i % 2 == 0 ? 1 : -1) * tgamma(s) / (tgamma(s + i + 1));
+  for (int i = 0; i <= GAMMA_LOWER_QUO_E_ITER; ++i) {
+    rt += i % 2 == 0 ? term : -term;
+    term /= s + i + 1;
+  }
 
   return cpow((cmx_t)-1, (cmx_t)s) * rt;
 }
 
+// subfac_int - subfactorial of non-negative integer n by recurrence, exact
+// while it is below 2^53, or n! / e rounded once otherwise.
+static inline double subfac_int(double n) {
+  double rt = 1;
+
+  for (double i = 1; i <= n; ++i) {
+    if (!(rt * i < 0x1p53))
+      return tgamma(n + 1) / M_E;
+    rt = rt * i + (fmod(i, 2) == 0 ? 1 : -1);
+  }
+
+  return rt;
+}
+
 cmx_t subfac_cmx(cmx_t base) {
   ASSERT_IMG_ZER(base, "subfactorial");
 
@@ -485,6 +661,9 @@ cmx_t subfac_cmx(cmx_t base) {
 
   ASSERT_NON_NEG_INT(rbase, "subfactorial", "currently is not implemented", NAN);
 
+  if (rbase >= 0 && rbase == trunc(rbase))
+    return subfac_int(rbase);
+
   if (rbase >= 0 && fmod(rbase, 1) <= MAX_DIFF_ABS)
     return creal(tgamma(rbase + 1) / M_E - gamma_lower_quo_e(rbase + 1));
 
@@ -0,0 +1,336 @@
+/******************************************************************************\
+*                                                                              *
+*    Mewa. Math EWAluator.                                                     *
+*    Copyright (C) 2024 Mark Mandriota                                         *
+*                                                                              *
+*    This program is free software: you can redistribute it and/or modify      *
+*    it under the terms of the GNU General Public License as published by      *
+*    the Free Software Foundation, either version 3 of the License, or         *
+*    (at your option) any later version.                                       *
+*                                                                              *
+*    This program is distributed in the hope that it will be useful,           *
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+*    GNU General Public License for more details.                              *
+*                                                                              *
+*    You should have received a copy of the GNU General Public License         *
+*    along with this program.  If not, see <https://www.gnu.org/licenses/>.    *
+*                                                                              *
+\******************************************************************************/
+
+#ifndef X64_H
+#define X64_H
+
+#include "arena.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__) && defined(ARENA_MMAP)
+#define X64_JIT
+#endif
+
+#ifdef X64_JIT
+
+// X64_Code - buffer of machine code in arena. It is writable while code is
+// emitted and executable after x64_finish, never both.
+typedef struct {
+  Arena arena;
+  size_t len;
+  bool ok; // false once code did not fit into arena
+} X64_Code;
+
+typedef enum {
+  X64_RAX,
+  X64_RCX,
+  X64_RDX,
+  X64_RBX,
+  X64_RSP,
+  X64_RBP,
+  X64_RSI,
+  X64_RDI,
+  X64_R8,
+  X64_R9,
+  X64_R10,
+  X64_R11,
+  X64_R12,
+  X64_R13,
+  X64_R14,
+  X64_R15,
+} X64_Reg;
+
+typedef enum {
+  X64_CC_P = 0xA,
+  X64_CC_E = 0x4,
+  X64_CC_NE = 0x5,
+} X64_Cond;
+
+// SSE instructions as mandatory prefix in high byte and opcode after 0x0F in
+// low one.
+typedef enum {
+  X64_MOVUPD_LOAD = 0x6610,
+  X64_MOVUPD_STORE = 0x6611,
+  X64_MOVSD_LOAD = 0xF210,
+  X64_MOVSD_STORE = 0xF211,
+  X64_MOVSS_STORE = 0xF311,
+  X64_UNPCKLPD = 0x6614,
+  X64_MOVAPD = 0x6628,
+  X64_UCOMISD = 0x662E,
+  X64_MOVMSKPD = 0x6650,
+  X64_SQRTSD = 0xF251,
+  X64_ANDPD = 0x6654,
+  X64_ANDNPD = 0x6655,
+  X64_XORPD = 0x6657,
+  X64_ADDPD = 0x6658,
+  X64_ADDSD = 0xF258,
+  X64_MULSD = 0xF259,
+  X64_CVTSS2SD = 0xF35A,
+  X64_CVTSD2SS = 0xF25A,
+  X64_SUBPD = 0x665C,
+  X64_SUBSD = 0xF25C,
+  X64_PUNPCKLQDQ = 0x666C,
+  X64_MOVQ_TO_XMM = 0x666E,
+  X64_CMPPD = 0x66C2,
+} X64_Sse;
+
+typedef enum {
+  X64_CMP_EQ = 0,
+  X64_CMP_UNORD = 3,
+  X64_CMP_NEQ = 4,
+} X64_Cmp;
+
+//=:x64:buffer
+
+static inline bool x64_init(X64_Code *c, size_t reserve) {
+  *c = (X64_Code){0};
+  return arena_init(&c->arena, reserve, true);
+}
+
+// x64_begin - makes buffer writable for new code, releasing memory of big
+// previous one above keep bytes.
+static inline bool x64_begin(X64_Code *c, size_t keep) {
+  c->len = 0;
+  c->ok = true;
+
+  if (c->arena.committed != 0 &&
+      mprotect(c->arena.base, c->arena.committed, PROT_READ | PROT_WRITE) != 0)
+    return false;
+
+  arena_reset(&c->arena, keep);
+  return true;
+}
+
+// x64_finish - makes emitted code executable. Returns its entry, or NULL if
+// code did not fit.
+static inline void *x64_finish(X64_Code *c) {
+  if (!c->ok ||
+      mprotect(c->arena.base, c->arena.committed, PROT_READ | PROT_EXEC) != 0)
+    return NULL;
+
+  return c->arena.base;
+}
+
+static inline void x64_free(X64_Code *c) {
+  arena_free(&c->arena);
+  *c = (X64_Code){0};
+}
+
+static inline void x64_byte(X64_Code *c, uint8_t b) {
+  if (c->len == c->arena.committed && !arena_commit(&c->arena, c->len + 1)) {
+    c->ok = false;
+    return;
+  }
+
+  c->arena.base[c->len++] = b;
+}
+
+static inline void x64_u32(X64_Code *c, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    x64_byte(c, v >> (8 * i));
+}
+
+static inline void x64_u64(X64_Code *c, uint64_t v) {
+  for (int i = 0; i < 8; ++i)
+    x64_byte(c, v >> (8 * i));
+}
+
+//=:x64:encoding
+
+static inline void x64_rex(X64_Code *c, bool w, int reg, int rm) {
+  uint8_t rex = 0x40 | w << 3 | (reg >> 3 & 1) << 2 | (rm >> 3 & 1);
+  if (rex != 0x40)
+    x64_byte(c, rex);
+}
+
+static inline void x64_modrm_rr(X64_Code *c, int reg, int rm) {
+  x64_byte(c, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// x64_modrm_mem - encodes [base + disp] operand, always with 32 bit disp.
+static inline void x64_modrm_mem(X64_Code *c, int reg, X64_Reg base,
+                                 int32_t disp) {
+  x64_byte(c, 0x80 | (reg & 7) << 3 | (base & 7));
+  if ((base & 7) == X64_RSP)
+    x64_byte(c, 0x24);
+  x64_u32(c, disp);
+}
+
+static inline void x64_op_rr(X64_Code *c, bool w, uint8_t op, int reg, int rm) {
+  x64_rex(c, w, reg, rm);
+  x64_byte(c, op);
+  x64_modrm_rr(c, reg, rm);
+}
+
+static inline void x64_op_mem(X64_Code *c, bool w, uint8_t op, int reg,
+                              X64_Reg base, int32_t disp) {
+  x64_rex(c, w, reg, base);
+  x64_byte(c, op);
+  x64_modrm_mem(c, reg, base, disp);
+}
+
+static inline void x64_sse_prefix(X64_Code *c, X64_Sse op, bool w, int reg,
+                                  int rm) {
+  x64_byte(c, op >> 8);
+  x64_rex(c, w, reg, rm);
+  x64_byte(c, 0x0F);
+  x64_byte(c, op & 0xFF);
+}
+
+static inline void x64_sse_rr(X64_Code *c, X64_Sse op, int dst, int src) {
+  x64_sse_prefix(c, op, op == X64_MOVQ_TO_XMM, dst, src);
+  x64_modrm_rr(c, dst, src);
+}
+
+static inline void x64_sse_mem(X64_Code *c, X64_Sse op, int xmm, X64_Reg base,
+                               int32_t disp) {
+  x64_sse_prefix(c, op, false, xmm, base);
+  x64_modrm_mem(c, xmm, base, disp);
+}
+
+static inline void x64_cmppd(X64_Code *c, int dst, int src, X64_Cmp pred) {
+  x64_sse_rr(c, X64_CMPPD, dst, src);
+  x64_byte(c, pred);
+}
+
+//=:x64:general
+
+static inline void x64_push(X64_Code *c, X64_Reg r) {
+  x64_rex(c, false, 0, r);
+  x64_byte(c, 0x50 | (r & 7));
+}
+
+static inline void x64_pop(X64_Code *c, X64_Reg r) {
+  x64_rex(c, false, 0, r);
+  x64_byte(c, 0x58 | (r & 7));
+}
+
+static inline void x64_ret(X64_Code *c) { x64_byte(c, 0xC3); }
+
+static inline void x64_mov_rr(X64_Code *c, X64_Reg dst, X64_Reg src) {
+  x64_op_rr(c, true, 0x89, src, dst);
+}
+
+static inline void x64_mov_ri32(X64_Code *c, X64_Reg r, uint32_t imm) {
+  x64_rex(c, false, 0, r);
+  x64_byte(c, 0xB8 | (r & 7));
+  x64_u32(c, imm);
+}
+
+static inline void x64_mov_ri64(X64_Code *c, X64_Reg r, uint64_t imm) {
+  x64_rex(c, true, 0, r);
+  x64_byte(c, 0xB8 | (r & 7));
+  x64_u64(c, imm);
+}
+
+static inline void x64_lea(X64_Code *c, X64_Reg r, X64_Reg base, int32_t disp) {
+  x64_op_mem(c, true, 0x8D, r, base, disp);
+}
+
+static inline void x64_load32(X64_Code *c, X64_Reg r, X64_Reg base,
+                              int32_t disp) {
+  x64_op_mem(c, false, 0x8B, r, base, disp);
+}
+
+static inline void x64_or32(X64_Code *c, X64_Reg r, X64_Reg base,
+                            int32_t disp) {
+  x64_op_mem(c, false, 0x0B, r, base, disp);
+}
+
+static inline void x64_load64(X64_Code *c, X64_Reg r, X64_Reg base,
+                              int32_t disp) {
+  x64_op_mem(c, true, 0x8B, r, base, disp);
+}
+
+static inline void x64_store64(X64_Code *c, X64_Reg base, int32_t disp,
+                               X64_Reg r) {
+  x64_op_mem(c, true, 0x89, r, base, disp);
+}
+
+static inline void x64_store32_imm(X64_Code *c, X64_Reg base, int32_t disp,
+                                   uint32_t imm) {
+  x64_op_mem(c, false, 0xC7, 0, base, disp);
+  x64_u32(c, imm);
+}
+
+static inline void x64_cmp32_imm8(X64_Code *c, X64_Reg base, int32_t disp,
+                                  int8_t imm) {
+  x64_op_mem(c, false, 0x83, 7, base, disp);
+  x64_byte(c, imm);
+}
+
+static inline void x64_add32_rr(X64_Code *c, X64_Reg dst, X64_Reg src) {
+  x64_op_rr(c, false, 0x01, src, dst);
+}
+
+static inline void x64_or32_rr(X64_Code *c, X64_Reg dst, X64_Reg src) {
+  x64_op_rr(c, false, 0x09, src, dst);
+}
+
+static inline void x64_test32_rr(X64_Code *c, X64_Reg dst, X64_Reg src) {
+  x64_op_rr(c, false, 0x85, src, dst);
+}
+
+static inline void x64_xor32_rr(X64_Code *c, X64_Reg dst, X64_Reg src) {
+  x64_op_rr(c, false, 0x31, src, dst);
+}
+
+static inline void x64_call_r(X64_Code *c, X64_Reg r) {
+  x64_op_rr(c, false, 0xFF, 2, r);
+}
+
+//=:x64:jumps
+
+// x64_jmp - emits jump with 32 bit offset. Returns position of offset, to
+// patch it later with x64_bind if target is ahead.
+static inline size_t x64_jmp(X64_Code *c) {
+  x64_byte(c, 0xE9);
+  x64_u32(c, 0);
+  return c->len - 4;
+}
+
+static inline size_t x64_jcc(X64_Code *c, X64_Cond cc) {
+  x64_byte(c, 0x0F);
+  x64_byte(c, 0x80 | cc);
+  x64_u32(c, 0);
+  return c->len - 4;
+}
+
+// x64_bind_to - points jump with offset at pos to target.
+static inline void x64_bind_to(X64_Code *c, size_t pos, size_t target) {
+  if (!c->ok)
+    return;
+
+  uint32_t rel = (uint32_t)(target - (pos + 4));
+  for (int i = 0; i < 4; ++i)
+    c->arena.base[pos + i] = rel >> (8 * i);
+}
+
+// x64_bind - points jump with offset at pos to current position.
+static inline void x64_bind(X64_Code *c, size_t pos) {
+  x64_bind_to(c, pos, c->len);
+}
+
+#endif
+
+#endif